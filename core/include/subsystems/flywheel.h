@@ -1,11 +1,14 @@
 #pragma once
 
 #include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/feedforward_estimator.h"
+#include "../core/include/utils/controls/flywheel_observer.h"
 #include "vex.h"
 #include "../core/include/robot_specs.h"
 #include "../core/include/utils/controls/pid.h"
 #include "../core/include/utils/command_structure/auto_command.h"
 #include "../core/include/subsystems/screen.h"
+#include "../core/include/utils/periodic_task.h"
 #include <atomic>
 
 /**
@@ -75,6 +78,32 @@ public:
     return fb.is_on_target();
   }
 
+  /**
+   * @brief scale the flywheel's motor voltages for the battery (see
+   * BatteryCompensation) so the feedforward gives the same speed all match
+   * @param enabled true to compensate, false to send voltages as they are
+   */
+  void set_battery_compensation(bool enabled) { compensate_battery = enabled; }
+
+  /**
+   * @brief estimate the speed with an observer instead of the filter, and
+   * add the observer's boost to the output after each shot it detects
+   * @param obs the observer to use, or nullptr to go back to the filter
+   */
+  void set_observer(FlywheelObserver *obs);
+
+  /**
+   * @brief learn the feedforward while the flywheel spins at an rpm. Every
+   * update feeds the output and the measured speed to est, and once est has
+   * converged its estimate is copied into cfg, so the helper FeedForward
+   * (which should be using cfg) picks it up on its next update
+   * @param est the estimator to use, or nullptr to stop learning.
+   * FeedForwardEstimator::kS | FeedForwardEstimator::kV is a good choice for
+   * a flywheel
+   * @param cfg the config the helper FeedForward was made with
+   */
+  void set_ff_estimator(FeedForwardEstimator *est, FeedForward::ff_config_t *cfg);
+
   /**
    *  @brief Creates a page displaying info about the flywheel
    *  @return the page should be used for `screen::start_screen(screen, {fw.Page()});
@@ -115,7 +144,18 @@ private:
   vex::mutex fb_mut;              ///< guard for talking to the runner thread
   double ratio;                   ///< ratio between motor and flywheel. For accurate RPM calcualation
   std::atomic<double> target_rpm; ///< Desired RPM of the flywheel.
-  task rpm_task;                  ///< task that handles spinning the wheel at a given target_rpm
+  bool compensate_battery = false; ///< scale voltages for the battery
+  FlywheelObserver *observer = nullptr; ///< estimates rpm if set, instead of avger
+  double last_output = 0;          ///< the last output sent by spin_raw, for the observer
+  vex::timer obs_tmr;              ///< time between observer updates
+  FeedForwardEstimator *ff_est = nullptr; ///< learns the feedforward if set
+  FeedForward::ff_config_t *ff_cfg = nullptr; ///< where ff_est's estimate goes
+  double est_last_rpm = 0;         ///< speed at the last estimator sample
+  vex::timer est_tmr;              ///< time between estimator samples
+  PeriodicTask rpm_task;          ///< task that handles spinning the wheel at a given target_rpm
+
+  static constexpr uint32_t flywheel_period_ms = 5;   ///< how often rpm_task updates the controller
+  static constexpr uint32_t flywheel_budget_us = 1000; ///< how long one update should take
   Filter &avger;            ///< Moving average to smooth out noise from
 
   // Functions for internal use only
@@ -2,10 +2,27 @@
 #include "pl_mpeg.h"
 #include <string>
 
-/// @brief Only one video file can be open at a time due to memory constraints
+/**
+ * @brief Only one video file can be open at a time due to memory constraints.
+ * The file is streamed from the SD card as it plays, so it can be any length
+ */
 void set_video(const std::string &filename);
 /// @brief  restart the global video
 void video_restart();
+
+/// @brief how the video has been keeping up
+struct video_stats_t {
+    uint32_t decoded; ///< frames decoded
+    uint32_t dropped; ///< frames decoded but replaced before they were shown
+    uint32_t skipped; ///< frames decoded but not converted, to catch up
+    uint32_t shown;   ///< frames drawn to the screen
+    uint32_t underruns; ///< times the decoder had to give up waiting on the SD card
+    double last_decode_ms; ///< time to decode and convert the last frame
+    double avg_decode_ms;  ///< moving average of that
+};
+/// @return stats for the global video
+video_stats_t video_stats();
+
 // plays the video set by set_video()
 // because of memory constraints we're limited to one video at a time
 class VideoPlayer : public screen::Page {
@@ -13,6 +30,19 @@ class VideoPlayer : public screen::Page {
     VideoPlayer();
     void update(bool was_pressed, int x, int y) override;
 
-    void draw(vex::brain::lcd &screen, bool first_draw,
+    void draw(screen::Canvas &screen, bool first_draw,
               unsigned int frame_number) override;
+    /// @brief only drawn when a new frame is ready
+    bool retained() const override { return true; }
+    /// @brief frames keep decoding while hidden, there's just no need to
+    /// redraw
+    bool updates_in_background() const override { return false; }
+    /// @brief open the video again (from the start) if it was unloaded. This
+    /// happens on its own task, the page shows "loading" meanwhile
+    void on_enter() override;
+    /// @brief about how much the decoder and frame buffers hold
+    size_t heavy_bytes() const override;
+    /// @brief stop the decoder, then close the video and free its buffers.
+    /// Skipped if a video is being opened right then
+    void unload() override;
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#include "pl_mpeg.h"
+#include <cstdint>
+
+/**
+ * The parts of the video player that don't touch the SD card or the screen:
+ * turning a decoded frame into pixels, and deciding when frames are due. Kept
+ * apart from video.cpp so tools/host can build and benchmark them
+ */
+
+/// @brief fill the lookup tables frame_to_bgra_fast uses. Call once before
+/// converting anything
+void init_convert_tables();
+
+/**
+ * @brief convert a decoded frame to BGRA words (alpha 0). Gives the same
+ * pixels as pl_mpeg's plm_frame_to_bgra, using lookup tables instead of per
+ * pixel multiplies and clamps
+ * @param frame the frame from pl_mpeg
+ * @param dest at least frame->height rows of stride bytes
+ * @param stride bytes from one row of dest to the next
+ */
+void frame_to_bgra_fast(plm_frame_t *frame, uint8_t *dest, int stride);
+
+/**
+ * FramePacer
+ * Decides when a video's frames should be decoded and shown. Frame n is due
+ * at start + n * frame_us, so a slow frame doesn't push every later one
+ * back. When decoding falls behind, frames are still decoded (later frames
+ * depend on them) but not shown until it catches up, at most max_skips in a
+ * row. If it falls more than max_lag_us behind (a long SD stall) the clock
+ * starts over instead.
+ *
+ * Usage, every few ms:
+ * if (pacer.due(now)) {
+ *     decode the next frame
+ *     if (pacer.decoded(now)) { convert and show it }
+ * }
+ */
+class FramePacer {
+  public:
+    /**
+     * @param frame_us how long each frame is shown for
+     * @param max_skips frames in a row that may be skipped to catch up
+     * @param max_lag_us further behind than this and the clock starts over
+     */
+    FramePacer(uint64_t frame_us, uint32_t max_skips, uint64_t max_lag_us);
+
+    /// @brief change the frame rate, for a newly opened video
+    void set_frame_us(uint64_t frame_us) { this->frame_us = frame_us; }
+
+    /// @brief time frames from now_us, starting again at frame 0
+    void restart(uint64_t now_us);
+
+    /**
+     * @param now_us the time now
+     * @return true if the next frame should be decoded
+     */
+    bool due(uint64_t now_us);
+
+    /**
+     * @brief the frame due() asked for has been decoded
+     * @param now_us the time now, after decoding
+     * @return true to show it, false to skip it because the next one is
+     * already due
+     */
+    bool decoded(uint64_t now_us);
+
+  private:
+    uint64_t frame_us;
+    uint32_t max_skips;
+    uint64_t max_lag_us;
+
+    uint64_t start_us = 0;
+    uint64_t due_us = 0; ///< when the frame being decoded was due
+    uint32_t frame_index = 0;
+    uint32_t skips_in_row = 0;
+};
@@ -2,6 +2,10 @@
 
 #include "vex.h"
 #include "../core/include/utils/controls/pid.h"
+#include "../core/include/utils/controls/pidff.h"
+#include "../core/include/utils/controls/trapezoid_profile.h"
+#include "../core/include/utils/battery_compensation.h"
+#include "../core/include/utils/periodic_task.h"
 #include <iostream>
 #include <map>
 #include <atomic>
@@ -15,6 +19,13 @@ using namespace std;
  * A general class for lifts (e.g. 4bar, dr4bar, linear, etc)
  * Uses a PID to hold the lift at a certain height under load, and to move the lift to different heights
  *
+ * Moves started with set_position() or set_setpoint() follow a trapezoid motion profile (when max_v and accel
+ * are set) so the lift speeds up and slows down smoothly instead of the PID slamming it toward the new height.
+ * The feedforward in lift_ff_cfg (kG especially) holds the lift up against gravity and drives it along the
+ * profile, leaving only the small corrections to the PID.
+ *
+ * All the state for the control functions belongs to the Lift, so several lifts can run side by side.
+ *
  * @author Ryan McGee
  */
 template <typename T>
@@ -27,6 +38,7 @@ class Lift
    * includes:
    * - maximum speeds for the system
    * - softstops to stop the lift from hitting the hard stops too hard 
+   * - feedforward, motion profile and update rate for the holding loop
    */
   struct lift_cfg_t
   {
@@ -34,6 +46,13 @@ class Lift
     double softstop_up, softstop_down;
 
     PID::pid_config_t lift_pid_cfg;
+
+    /// Feedforward for the lift. kG is the voltage that holds it still against gravity. All 0 for none
+    FeedForward::ff_config_t lift_ff_cfg;
+    /// Motion profile max velocity and acceleration, in sensor units per second. 0 to jump straight to setpoints
+    double max_v, accel;
+    /// How often the holding loop runs, in milliseconds. 0 for the default of 20
+    uint32_t period_ms;
   };
 
   /**
@@ -58,27 +77,21 @@ class Lift
     *   A map of enum type T, in which each enum entry corresponds to a different lift height
     */
   Lift(motor_group &lift_motors, lift_cfg_t &lift_cfg, map<T, double> &setpoint_map, limit *homing_switch=NULL)
-  : lift_motors(lift_motors), cfg(lift_cfg), lift_pid(cfg.lift_pid_cfg), setpoint_map(setpoint_map), homing_switch(homing_switch)
+  : lift_motors(lift_motors), cfg(lift_cfg), lift_pid(cfg.lift_pid_cfg, cfg.lift_ff_cfg),
+    profile(cfg.max_v, cfg.accel), setpoint_map(setpoint_map), homing_switch(homing_switch),
+    hold_task("lift", cfg.period_ms > 0 ? cfg.period_ms : 20, 2000, [this](){
+      if(get_async())
+        hold();
+    })
   {
 
     is_async = true;
     setpoint = 0;
+    profile_next = false;
     
-    // Create a background task that is constantly updating the lift PID, if requested.
+    // Start the background task that is constantly updating the lift PID, if requested.
     // Set once, and forget.
-    task t([](void* ptr){
-      Lift &lift = *((Lift*) ptr);
-
-      while(true)
-      {
-        if(lift.get_async())
-          lift.hold();
-
-        vexDelay(50);
-      }
-
-      return 0;
-    }, this);
+    hold_task.start();
 
   }
 
@@ -92,19 +105,16 @@ class Lift
     */
   void control_continuous(bool up_ctrl, bool down_ctrl)
   {
-    static timer tmr;
-    
-    double cur_pos = 0;
+    timer &tmr = continuous_tmr;
 
-    // Check if there's a hook for a custom sensor. If not, use the motors.
-    if(get_sensor == NULL)
-      cur_pos = lift_motors.position(rev);
-    else
-      cur_pos = get_sensor();
+    double cur_pos = get_position();
+
+    // The setpoint moves a little every call here, profiling each of those would only slow it down
+    profile_next = false;
 
     if(up_ctrl && cur_pos < cfg.softstop_up)
     {
-      lift_motors.spin(directionType::fwd, cfg.up_speed, volt);
+      lift_motors.spin(directionType::fwd, out_volts(cfg.up_speed), volt);
       setpoint = cur_pos + .3;
 
       // std::cout << "DEBUG OUT: UP " << setpoint << ", " << tmr.time(sec) << ", " << cfg.down_speed << "\n";
@@ -137,13 +147,10 @@ class Lift
    */
   void control_manual(bool up_btn, bool down_btn, int volt_up, int volt_down)
   {
-    static bool down_hold = false;
-    static bool init = true;
-
     // Allow for setting position while still calling this function
-    if(init || up_btn || down_btn)
+    if(manual_init || up_btn || down_btn)
     {
-      init = false;
+      manual_init = false;
       is_async = false;
     }
 
@@ -155,9 +162,9 @@ class Lift
       down_hold = false;
 
     if(up_btn && rev < cfg.softstop_up)
-      lift_motors.spin(directionType::fwd, volt_up, voltageUnits::volt);
+      lift_motors.spin(directionType::fwd, out_volts(volt_up), voltageUnits::volt);
     else if(down_btn && rev > cfg.softstop_down && !down_hold)
-      lift_motors.spin(directionType::rev, volt_down, voltageUnits::volt);
+      lift_motors.spin(directionType::rev, out_volts(volt_down), voltageUnits::volt);
     else
       lift_motors.spin(directionType::fwd, 0, voltageUnits::volt);
   
@@ -177,7 +184,12 @@ class Lift
   void control_setpoints(bool up_step, bool down_step, vector<T> pos_list)
   {
     // Make sure inputs are only processed on the rising edge of the button
-    static bool up_last = up_step, down_last = down_step;
+    if(!steps_init)
+    {
+      up_last = up_step;
+      down_last = down_step;
+      steps_init = true;
+    }
 
     bool up_rising = up_step && !up_last;
     bool down_rising = down_step && !down_last;
@@ -185,8 +197,6 @@ class Lift
     up_last = up_step;
     down_last = down_step;
 
-    static int cur_index = 0;
-
     // Avoid an index overflow. Shouldn't happen unless the user changes pos_list between calls.
     if(cur_index >= pos_list.size())
       cur_index = pos_list.size() - 1;
@@ -205,7 +215,7 @@ class Lift
 
   /**
     * Enable the background task, and send the lift to a position, specified by the
-    * setpoint map from the constructor.
+    * setpoint map from the constructor. The lift follows the motion profile there.
     * 
     * @param pos
     *   A lift position enum type
@@ -213,22 +223,24 @@ class Lift
     */
   bool set_position(T pos)
   {
-    this->setpoint = setpoint_map[pos];
+    set_setpoint(setpoint_map[pos]);
     is_async = true;
 
-    return (lift_pid.get_target() == this->setpoint) && lift_pid.is_on_target();
+    return is_on_setpoint();
   }
 
   /**
-    * Manually set a setpoint value for the lift PID to go to.
+    * Manually set a setpoint value for the lift PID to go to. The lift follows the motion profile there.
     * @param val
     *   Lift setpoint, in motor revolutions or sensor units defined by get_sensor. Cannot be outside the softstops.
     * @return True if the pid has reached the setpoint
     */
   bool set_setpoint(double val)
   {
+    if(val != this->setpoint)
+      profile_next = true;
     this->setpoint = val;
-    return (lift_pid.get_target() == this->setpoint) && lift_pid.is_on_target();
+    return is_on_setpoint();
   }
   
   /**
@@ -240,22 +252,56 @@ class Lift
   }
 
   /**
-    * Target the class's setpoint.
-    * Calculate the PID output and set the lift motors accordingly.
+    * @return true once the motion profile has finished and the PID is on target at the setpoint
+    */
+  bool is_on_setpoint()
+  {
+    return !profiling && (lift_pid.get_target() == this->setpoint) && lift_pid.is_on_target();
+  }
+
+  /**
+    * Target the class's setpoint, following the motion profile if a move is under way.
+    * Calculate the PID + feedforward output and set the lift motors accordingly.
     */
   void hold()
   {
-    lift_pid.set_target(setpoint);
-    // std::cout << "DEBUG OUT: SETPOINT " << setpoint << "\n";
+    double pos = get_position();
+    double sp = setpoint;
 
-    if(get_sensor != NULL)
-      lift_pid.update(get_sensor());
-    else
-      lift_pid.update(lift_motors.position(rev));
+    // A new setpoint. Start a profile to it from wherever the lift (or the last profile) is
+    if(sp != last_setpoint)
+    {
+      last_setpoint = sp;
+      if(profile_next && cfg.max_v > 0 && cfg.accel > 0)
+      {
+        motion_t from = profiling ? ref : motion_t{pos, 0, 0};
+        profile.set_max_v(cfg.max_v);
+        profile.set_accel(cfg.accel);
+        profile.set_endpts(from.pos, sp);
+        profile.set_vel_endpts(from.vel, 0);
+        profile_tmr.reset();
+        profiling = true;
+      } else
+      {
+        profiling = false;
+      }
+    }
 
-    // std::cout << "DEBUG OUT: ROTATION " << lift_motors.rotation(rev) << "\n\n";
+    if(profiling)
+    {
+      double t = profile_tmr.time(sec);
+      ref = profile.calculate_time_based(t);
+      // The movement time is only known once the profile has been calculated
+      if(t >= profile.get_movement_time())
+        profiling = false;
+    }
+    if(!profiling)
+      ref = motion_t{sp, 0, 0};
 
-    lift_motors.spin(fwd, lift_pid.get(), volt);
+    lift_pid.set_target(ref.pos);
+    lift_pid.update(pos, ref.vel, ref.accel);
+
+    lift_motors.spin(fwd, out_volts(lift_pid.get()), volt);
   }
 
   /**
@@ -264,8 +310,7 @@ class Lift
    */
   void home()
   {
-    static timer tmr;
-    tmr.reset();
+    timer tmr;
     
     while(tmr.time(sec) < 3)
     {
@@ -328,19 +373,70 @@ class Lift
     this->reset_sensor = fn_ptr;
   }
 
+  /**
+   * Scale the lift's motor voltages for the battery (see BatteryCompensation)
+   * so the holding voltage means the same thing all match
+   * @param enabled true to compensate, false to send voltages as they are
+   */
+  void set_battery_compensation(bool enabled)
+  {
+    this->compensate_battery = enabled;
+  }
+
   private:
 
+  /**
+   * @return the lift's position from the custom sensor if there is one, otherwise from the motors
+   */
+  double get_position()
+  {
+    if(get_sensor != NULL)
+      return get_sensor();
+    return lift_motors.position(rev);
+  }
+
+  /**
+   * @return volts, compensated for the battery if that's turned on
+   */
+  double out_volts(double volts)
+  {
+    return compensate_battery ? BatteryCompensation::compensate(volts) : volts;
+  }
+
   motor_group &lift_motors;
   lift_cfg_t &cfg;
-  PID lift_pid;
+  PIDFF lift_pid;
+  TrapezoidProfile profile;
   map<T, double> &setpoint_map;
   limit *homing_switch;
   
   atomic<double> setpoint;
   atomic<bool> is_async;
+  atomic<bool> profile_next; ///< true if the next setpoint change should be profiled
+
+  // hold() state
+  double last_setpoint = 0;
+  bool profiling = false;
+  motion_t ref = {0, 0, 0};
+  timer profile_tmr;
+
+  // control_continuous() state
+  timer continuous_tmr;
+
+  // control_manual() state
+  bool down_hold = false;
+  bool manual_init = true;
+
+  // control_setpoints() state
+  bool steps_init = false;
+  bool up_last = false, down_last = false;
+  size_t cur_index = 0;
 
   double (*get_sensor)(void) = NULL;
   void (*reset_sensor)(void) = NULL;
-  
+
+  bool compensate_battery = false;
+
+  PeriodicTask hold_task;
 
 };
\ No newline at end of file
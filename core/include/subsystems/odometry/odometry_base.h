@@ -4,6 +4,7 @@
 #include "../core/include/utils/geometry.h"
 #include "../core/include/robot_specs.h"
 #include "../core/include/utils/command_structure/auto_command.h"
+#include "../core/include/utils/periodic_task.h"
 
 #ifndef PI
 #define PI 3.141592654
@@ -53,14 +54,19 @@ public:
     virtual pose_t update() = 0;
 
     /**
-     * Function that runs in the background task. This function pointer is passed
-     * to the vex::task constructor. 
+     * One background update. Run every odometry_period_ms by the background
+     * PeriodicTask.
      * 
      * @param ptr Pointer to OdometryBase object
      * @return Required integer return code. Unused.
      */
     static int background_task(void* ptr);
 
+    /// @brief how often the background task updates the position
+    static constexpr uint32_t odometry_period_ms = 5;
+    /// @brief how long one background update is expected to take
+    static constexpr uint32_t odometry_budget_us = 1000;
+
     /**
      * End the background task. Cannot be restarted.
      * If the user wants to end the thread but keep the data up to date,
@@ -128,9 +134,9 @@ public:
 
 protected:
     /**
-     * handle to the vex task that is running the odometry code
+     * handle to the periodic task that is running the odometry code
     */
-    vex::task *handle;
+    PeriodicTask *handle = nullptr;
 
     /**
      * Mutex to control multithreading
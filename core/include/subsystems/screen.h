@@ -4,7 +4,9 @@
 #include <functional>
 #include <map>
 #include <cassert>
+#include <memory>
 #include "../core/include/subsystems/odometry/odometry_base.h"
+#include "../core/include/subsystems/screen_mirror.h"
 #include "../core/include/utils/graph_drawer.h"
 #include "../core/include/utils/controls/pid.h"
 #include "../core/include/utils/controls/pidff.h"
@@ -33,7 +35,7 @@ namespace screen
         /// @return true if the button was pressed
         bool update(bool was_pressed, int x, int y);
         /// @brief draws the button to the screen
-        void draw(vex::brain::lcd &, bool first_draw, unsigned int frame_number);
+        void draw(Canvas &, bool first_draw, unsigned int frame_number);
 
     private:
         std::function<void(void)> onpress;
@@ -61,7 +63,7 @@ namespace screen
         /// @return true if the value updated
         bool update(bool was_pressed, int x, int y);
         /// @brief @ref Page::draws the slide to the screen
-        void draw(vex::brain::lcd &, bool first_draw, unsigned int frame_number);
+        void draw(Canvas &, bool first_draw, unsigned int frame_number);
 
     private:
         double &value;
@@ -75,34 +77,56 @@ namespace screen
 
     struct WidgetConfig;
 
+    /// @brief a slider that sets *val between low and high
     struct SliderConfig
     {
-        double &val;
+        double *val;
         double low;
         double high;
+        std::string label;
     };
+    /// @brief a button that calls onclick when tapped
     struct ButtonConfig
     {
         std::function<void()> onclick;
+        std::string label;
     };
+    /// @brief a checkbox that calls onupdate with its new state when tapped
     struct CheckboxConfig
     {
         std::function<void(bool)> onupdate;
+        std::string label;
+        bool initial; ///< starts checked. Left out of an initializer, false
     };
+    /// @brief text that never changes
     struct LabelConfig
     {
         std::string label;
     };
 
+    /// @brief text that is checked for changes a few times a second
     struct TextConfig
     {
         std::function<std::string()> text;
     };
+    /// @brief a child of a Row or Col. size is its share of the space: a
+    /// child of size 2 gets twice the space of a child of size 1
     struct SizedWidget
     {
         int size;
         WidgetConfig &widget;
     };
+    /**
+     * @brief a declarative description of a page. Rows and Cols split their
+     * space between their children, everything else is drawn in the space it
+     * is given. Only the field matching type is used.
+     *
+     * Usage:
+     * WidgetConfig p{.type = WidgetConfig::Slider, .slider = {&cfg.p, 0, 1, "P"}};
+     * WidgetConfig reset{.type = WidgetConfig::Button, .button = {[](){ ... }, "Reset"}};
+     * WidgetConfig page{.type = WidgetConfig::Col, .widgets = {{3, p}, {1, reset}}};
+     * screen::Page *tuning = new screen::WidgetPage(page);
+     */
     struct WidgetConfig
     {
         enum Type
@@ -117,65 +141,197 @@ namespace screen
             Graph,
         };
         Type type;
-        union
+        std::vector<SizedWidget> widgets; ///< for Col and Row
+        SliderConfig slider;
+        ButtonConfig button;
+        CheckboxConfig checkbox;
+        LabelConfig label;
+        TextConfig text;
+        GraphDrawer *graph; ///< fed by whoever owns it. Left out, nullptr
+    };
+
+    struct ScreenRect
+    {
+        uint32_t x1;
+        uint32_t y1;
+        uint32_t x2;
+        uint32_t y2;
+    };
+
+    /// @brief the part of the screen pages draw on (between the navigation bars)
+    static const ScreenRect page_area = {40, 0, 440, 240};
+
+    /// @brief something a finger did on the screen
+    struct TouchEvent
+    {
+        enum Type
         {
-            std::vector<SizedWidget> widgets;
-            SliderConfig slider;
-            ButtonConfig button;
-            CheckboxConfig checkbox;
-            LabelConfig label;
-            TextConfig text;
-            GraphDrawer *graph;
-        } config;
+            Press,   ///< a finger went down
+            Drag,    ///< the finger moved while down
+            Release, ///< the finger came up
+            Cancel,  ///< the touch turned into a swipe between pages, forget it
+        };
+        Type type;
+        int x;
+        int y;
+        uint32_t time_ms; ///< vex::timer::system() when it happened
     };
 
     class Page;
-    /// @brief Page describes one part of the screen slideshow
+    /**
+     * @brief Page describes one part of the screen slideshow
+     *
+     * By default a page is redrawn from scratch every frame. A page that only
+     * changes now and then can be retained instead (override retained() to
+     * return true). A retained page is drawn in full when it comes to the
+     * front, and after that only when it calls invalidate(). Only the
+     * invalidated rectangles are cleared and drawing is clipped to them, so
+     * a page can simply draw everything again and only those pixels change.
+     */
     class Page
     {
     public:
+        virtual ~Page() {}
         /**
-         * @brief collect data, respond to screen input, do fast things (runs at
-         * 50hz even if you're not focused on this Page (only drawn page gets
-         * touch updates))
+         * @brief collect data, respond to screen input, do fast things (runs
+         * every 5ms, also while another page is in front unless
+         * updates_in_background() says not to. Only the front page gets
+         * touch updates)
          * @param was_pressed true if the screen has been pressed
          * @param x x position of screen press (if the screen was pressed)
          * @param y y position of screen press (if the screen was pressed)
          */
         virtual void update(bool was_pressed, int x, int y);
+        /**
+         * @brief respond to a touch. Only the front page gets touches, in the
+         * order they happened and before its update(). Touches on the
+         * navigation bars and swipes between pages are not passed on
+         */
+        virtual void touch(const TouchEvent &e) { (void)e; }
+        /**
+         * @return true (the default) if update() should run while another
+         * page is in front, to collect data. A page that only responds to
+         * touches and draws what it's given can return false
+         */
+        virtual bool updates_in_background() const { return true; }
+
+        /// @brief called when the page comes to the front, before its first
+        /// draw. Load anything unload() freed here
+        virtual void on_enter() {}
+        /// @brief called when another page comes to the front
+        virtual void on_exit() {}
+        /**
+         * @return bytes of memory held by things unload() can free (images,
+         * graph history). Used to keep hidden pages under the memory budget
+         */
+        virtual size_t heavy_bytes() const { return 0; }
+        /**
+         * @brief free what heavy_bytes() counts. Only called on a hidden
+         * page. The page is entered again (on_enter()) before it is drawn
+         */
+        virtual void unload() {}
         /**
          * @brief draw stored data to the screen (runs at 10 hz and only runs if
          * this page is in front)
-         * @param first_draw true if we just switched to this page
+         * @param screen what to draw on. Has the drawing functions of
+         * vex::brain::lcd
+         * @param first_draw true if we just switched to this page (or the
+         * screen was cleared to be mirrored from scratch)
          * @param frame_number frame of drawing we are on (basically an animation
          * tick)
          */
-        virtual void draw(vex::brain::lcd &screen, bool first_draw,
+        virtual void draw(Canvas &screen, bool first_draw,
                           unsigned int frame_number);
-    };
 
-    struct ScreenRect
-    {
-        uint32_t x1;
-        uint32_t y1;
-        uint32_t x2;
-        uint32_t y2;
-    };
-    void draw_widget(WidgetConfig &widget, ScreenRect rect);
+        /**
+         * @return true if this page only needs drawing where it has called
+         * invalidate(). false (the default) to be drawn every frame
+         */
+        virtual bool retained() const { return false; }
 
+        /**
+         * @brief mark part of the page as needing to be drawn again. Call
+         * from update() (the screen thread)
+         * @param rect the area that changed, in screen coordinates
+         */
+        void invalidate(ScreenRect rect);
+        /// @brief mark the whole page as needing to be drawn again
+        void invalidate() { invalidate(page_area); }
+
+        /**
+         * @brief take the areas marked by invalidate(), clearing them. Used
+         * by the screen thread
+         * @param out where to put the rectangles. Must hold max_dirty
+         * @return how many rectangles there were
+         */
+        int take_dirty(ScreenRect *out);
+
+        /// @brief invalidated rectangles kept separately before they're
+        /// merged into one
+        static const int max_dirty = 4;
+
+        /**
+         * @return the area being drawn by the current draw(). Anything outside
+         * it is clipped, so a retained page can skip drawing it at all
+         */
+        ScreenRect draw_area() const { return drawing; }
+        /// @brief set by the screen thread before each draw()
+        void set_draw_area(ScreenRect rect) { drawing = rect; }
+
+    private:
+        ScreenRect dirty[max_dirty];
+        int num_dirty = 0;
+        ScreenRect drawing = page_area;
+    };
+    /**
+     * @brief a page built from a WidgetConfig tree. The tree is laid out once
+     * into rectangles, touches are matched against those, and only widgets
+     * whose value changed are redrawn
+     */
     class WidgetPage : public Page
     {
     public:
-        WidgetPage(WidgetConfig &cfg) : base_widget(cfg) {}
+        /// @brief lay out cfg over the page. cfg must outlive the page
+        WidgetPage(WidgetConfig &cfg);
+        /// @brief @see Page#update
         void update(bool was_pressed, int x, int y) override;
+        /// @brief @see Page#touch
+        void touch(const TouchEvent &e) override;
+        /// @brief @see Page#draw
+        void draw(Canvas &, bool first_draw, unsigned int frame_number) override;
+        /// @brief only changed widgets are redrawn
+        bool retained() const override { return true; }
+        /// @brief widgets are only checked while the page is showing
+        bool updates_in_background() const override { return false; }
 
-        void draw(vex::brain::lcd &, bool first_draw, unsigned int frame_number) override
-        {
-            draw_widget(base_widget, {.x1 = 20, .y1 = 0, .x2 = 440, .y2 = 240});
-        }
+        /// @brief lay the tree out again, after changing its structure
+        void relayout();
 
     private:
+        /// @brief one widget that draws something, with where it goes and
+        /// what it last showed
+        struct Node
+        {
+            WidgetConfig *cfg;
+            ScreenRect rect;
+            std::unique_ptr<SliderWidget> slider;
+            std::unique_ptr<ButtonWidget> button;
+            bool checked = false;
+            double last_val = 0;
+            std::string last_text;
+        };
+
+        void layout(WidgetConfig &widget, ScreenRect rect);
+        void draw_node(Canvas &scr, Node &node);
+
+        /// how often Text and Graph widgets are checked for changes
+        static const int poll_ms = 100;
+
         WidgetConfig &base_widget;
+        std::vector<Node> nodes;
+        vex::timer poll_tmr;
+        /// the node the finger went down on, it gets the whole touch
+        int grabbed = -1;
     };
 
     /**
@@ -186,6 +342,23 @@ namespace screen
      */
     void start_screen(vex::brain::lcd &screen, std::vector<Page *> pages, int first_page = 0);
 
+    /**
+     * @brief limit how often the screen is drawn. Touches are still checked and
+     * every page's update() still runs every 5ms
+     * @param fps frames per second to draw at most (default 30)
+     */
+    void set_max_fps(uint32_t fps);
+
+    /**
+     * @brief limit the memory held by pages that aren't showing. When a page
+     * comes to the front, hidden pages are unloaded (Page::unload()),
+     * least recently shown first, until what they hold (Page::heavy_bytes())
+     * fits. Set it to 0 during autonomous to free everything that isn't on
+     * screen, and back up afterwards. No limit by default
+     * @param bytes the most hidden pages may hold
+     */
+    void set_memory_budget(size_t bytes);
+
 
     void next_page();
     void prev_page();
@@ -198,7 +371,7 @@ namespace screen
     using update_func_t = std::function<void(bool, int, int)>;
 
     /// @brief  type of function needed for draw
-    using draw_func_t = std::function<void(vex::brain::lcd &screen, bool, unsigned int)>;
+    using draw_func_t = std::function<void(Canvas &screen, bool, unsigned int)>;
 
     /// @brief Draws motor stats and battery stats to the screen
     class StatsPage : public Page
@@ -210,12 +383,19 @@ namespace screen
         /// @brief @see Page#update
         void update(bool was_pressed, int x, int y) override;
         /// @brief @see Page#draw
-        void draw(vex::brain::lcd &, bool first_draw, unsigned int frame_number) override;
+        void draw(Canvas &, bool first_draw, unsigned int frame_number) override;
+        /// @brief temperatures and the battery change slowly, so only redraw every refresh_ms
+        bool retained() const override { return true; }
+        /// @brief nothing to collect while hidden, the motors are read when drawn
+        bool updates_in_background() const override { return false; }
 
     private:
-        void draw_motor_stats(const std::string &name, vex::motor &mot, unsigned int frame, int x, int y, vex::brain::lcd &scr);
+        void draw_motor_stats(const std::string &name, vex::motor &mot, unsigned int frame, int x, int y, Canvas &scr);
 
         std::map<std::string, vex::motor &> motors;
+        vex::timer refresh_tmr;
+        unsigned int refreshes = 0;
+        static const int refresh_ms = 500;
         static const int y_start = 0;
         static const int per_column = 4;
         static const int row_height = 20;
@@ -224,6 +404,9 @@ namespace screen
 
     /**
      * @brief a page that shows odometry position and rotation and a map (if an sd card with the file is on)
+     *
+     * The field image is decoded once when the page is made (and again if the memory budget unloaded it). After
+     * that, only the part of the field the robot and its trail moved through is redrawn.
      */
     class OdometryPage : public Page
     {
@@ -234,24 +417,88 @@ namespace screen
         /// @param robot_height the robot_height (front to back) of the robot in inches. Used for visualization
         /// @param do_trail whether or not to calculate and draw the trail. Drawing and storing takes a very *slight* extra amount of processing power
         OdometryPage(OdometryBase &odom, double robot_width, double robot_height, bool do_trail);
+        ~OdometryPage() { delete[] field_px; }
         /// @brief @see Page#update
         void update(bool was_pressed, int x, int y) override;
         /// @brief @see Page#draw
-        void draw(vex::brain::lcd &, bool first_draw, unsigned int frame_number) override;
+        void draw(Canvas &, bool first_draw, unsigned int frame_number) override;
+        /// @brief only the parts that moved are redrawn
+        bool retained() const override { return true; }
+        /// @brief decode the field image again if it was unloaded
+        void on_enter() override;
+        /// @brief the decoded field image
+        size_t heavy_bytes() const override;
+        /// @brief free the decoded field image. The trail keeps going
+        void unload() override;
 
     private:
         static const int path_len = 40;
         static constexpr char const *field_filename = "vex_field_240p.png";
+        /// how often position and speed are sampled
+        static const int sample_ms = 50;
+        /// samples between points on the trail
+        static const int trail_every = 2;
+        /// where the field is drawn, and its size in pixels
+        static const int field_x = 200;
+        static const int field_size = 240;
+
+        /// @brief the pixels the robot outline and the trail cover
+        ScreenRect field_box();
+        /// @brief copy the part of the field image inside area to the screen
+        void blit_field(Canvas &scr, ScreenRect area);
+        /// @brief decode the field image from the SD card into field_px
+        void load_field();
 
         OdometryBase &odom;
         double robot_width;
         double robot_height;
-        uint8_t *buf = nullptr;
-        int buf_size = 0;
+        uint32_t *field_px = nullptr; ///< decoded field image, field_size x field_size
         pose_t path[path_len];
         int path_index = 0;
         bool do_trail;
         GraphDrawer velocity_graph;
+
+        pose_t pose;
+        double speed = 0;
+        int samples = 0;
+        vex::timer sample_tmr;
+        ScreenRect last_box = {0, 0, 0, 0};
+    };
+
+    /**
+     * @brief a page that isn't made until it is first shown. Give it a
+     * function that makes the real page and pass it to start_screen in its
+     * place. If the memory budget has to unload it and the real page doesn't
+     * collect data in the background, the real page is deleted and made
+     * again next time it's shown.
+     *
+     * Usage:
+     * new screen::LazyPage([]() { return new screen::OdometryPage(odom, 12, 12, true); })
+     */
+    class LazyPage : public Page
+    {
+    public:
+        using factory_t = std::function<Page *()>;
+        /// @param make makes the real page. Called from the screen thread
+        LazyPage(factory_t make) : make(make) {}
+        ~LazyPage() { delete page; }
+
+        void update(bool was_pressed, int x, int y) override;
+        void touch(const TouchEvent &e) override;
+        void draw(Canvas &, bool first_draw, unsigned int frame_number) override;
+        bool retained() const override { return page != nullptr && page->retained(); }
+        bool updates_in_background() const override { return page != nullptr && page->updates_in_background(); }
+        void on_enter() override;
+        void on_exit() override;
+        size_t heavy_bytes() const override { return page != nullptr ? page->heavy_bytes() : 0; }
+        void unload() override;
+
+    private:
+        /// @brief pass on what the real page invalidated
+        void take_invalidated();
+
+        factory_t make;
+        Page *page = nullptr;
     };
 
     /// @brief Simple page that stores no internal data. the draw and update functions use only global data rather than storing anything
@@ -265,7 +512,7 @@ namespace screen
         /// @brief @see Page#update
         void update(bool was_pressed, int x, int y) override;
         /// @brief @see Page#draw
-        void draw(vex::brain::lcd &, bool first_draw, unsigned int frame_number) override;
+        void draw(Canvas &, bool first_draw, unsigned int frame_number) override;
 
     private:
         update_func_t update_f;
@@ -288,7 +535,13 @@ namespace screen
         /// @brief @see Page#update
         void update(bool was_pressed, int x, int y) override;
         /// @brief @see Page#draw
-        void draw(vex::brain::lcd &, bool first_draw, unsigned int frame_number) override;
+        void draw(Canvas &, bool first_draw, unsigned int frame_number) override;
+        /// @brief the sliders only need checking while the page is showing
+        bool updates_in_background() const override { return false; }
+        /// @brief the graph's history
+        size_t heavy_bytes() const override { return graph.memory_bytes(); }
+        /// @brief forget the graph's history
+        void unload() override { graph.release(); }
 
     private:
         /// @brief reset d
@@ -0,0 +1,226 @@
+#pragma once
+#include "vex.h"
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+namespace screen
+{
+    /**
+     * @brief MirrorStream records what is drawn on the brain screen and sends
+     * it over the USB serial port, so the screen can be watched from a laptop.
+     *
+     * The brain can't read its screen back, so what is sent is the drawing
+     * itself: every call made on a Canvas is encoded as a few bytes. Calls
+     * are recorded into a buffer allocated once, and the buffer goes out as a
+     * packet at most max_fps times a second. Bytes are written only as fast
+     * as bytes_per_sec allows and only as much as fits in the serial buffer,
+     * so sending never blocks the screen task.
+     *
+     * If more is drawn than can be sent (the buffer fills up), the recording
+     * is thrown away and, once the line is quiet again, the screen asks for a
+     * full redraw so the viewer starts over from a clear screen. Redraws for
+     * this happen at most once every resync_ms.
+     *
+     * Packets share the serial port with printf, so they are framed:
+     *   0xA5 0x5A | length u16 | frame number u32 | commands | fletcher16 u16
+     * length counts the frame number and the commands. Anything between
+     * packets (printf output) should be skipped by the viewer.
+     *
+     * Numbers are little endian, coordinates are i16. Commands are one opcode
+     * byte followed by their arguments:
+     *   Clear       rgb u32
+     *   PenColor    rgb u32 (bit 24 set means transparent)
+     *   FillColor   rgb u32 (bit 24 set means transparent)
+     *   PenWidth    u8
+     *   Font        u8 (vex::fontType)
+     *   Clip        x y w h
+     *   Pixel       x y
+     *   Line        x1 y1 x2 y2
+     *   Rect        x y w h
+     *   Circle      x y r
+     *   Text        x y opaque u8 length u8 chars (not null terminated)
+     *   Image       x y w h step u8, then rgb565 u16 for every step'th pixel
+     *               of every step'th row ((w+step-1)/step per row)
+     * An image is subsampled (step > 1) until it fits in half of what is left
+     * of the recording buffer, so one big image doesn't push everything drawn
+     * after it out of the frame.
+     * Pen, fill, pen width and font carry over from one packet to the next.
+     * After a restart they are sent again before anything else. A packet with
+     * a bad checksum (printf can land in the middle of one) is dropped, and
+     * the viewer is off until the next full redraw.
+     *
+     * tools/mirror/mirror_view.py is a viewer for this stream.
+     */
+    class MirrorStream
+    {
+    public:
+        enum Op : uint8_t
+        {
+            Clear = 1,
+            PenColor,
+            FillColor,
+            PenWidth,
+            Font,
+            Clip,
+            Pixel,
+            Line,
+            Rect,
+            Circle,
+            Text,
+            Image,
+        };
+
+        /**
+         * @brief Create a stream
+         * @param bytes_per_sec most bytes sent in a second, on average
+         * @param max_fps most packets sent in a second
+         * @param max_frame_bytes size of the recording buffer. Drawing more
+         * than this between two packets forces a full redraw
+         */
+        MirrorStream(uint32_t bytes_per_sec, uint32_t max_fps, uint32_t max_frame_bytes = 8192);
+
+        /// @return true if draw calls should be recorded right now
+        bool recording() const { return !overflowed; }
+
+        /// @brief the screen was cleared, nothing recorded before it matters
+        void restart();
+
+        /// @brief drop what was recorded and wait for a full redraw. Safe to
+        /// call from any thread, the screen task picks it up next frame
+        void request_full_frame();
+
+        /**
+         * @return true if the screen should be redrawn from scratch so the
+         * viewer can catch up
+         */
+        bool wants_full_frame();
+
+        /**
+         * @brief start a packet from what was recorded if it's time, then send
+         * as much of the current packet as the budget and the serial port
+         * allow. Called by the screen task after every frame
+         */
+        void flush();
+
+        /// @return bytes written to the serial port so far
+        uint32_t bytes_sent() const { return sent_total; }
+        /// @return how many times the viewer had to be sent a full redraw
+        uint32_t resyncs() const { return resync_count; }
+
+    private:
+        friend class Canvas;
+
+        /**
+         * @brief start recording a command
+         * @param arg_bytes the size of its arguments
+         * @return false if it shouldn't be recorded. If there's no room the
+         * recording is dropped
+         */
+        bool begin(Op o, size_t arg_bytes);
+        void u8(uint8_t v);
+        void u16(uint16_t v);
+        void i16(int32_t v);
+        void u32(uint32_t v);
+        void color(Op o, uint32_t rgb);
+        void image(const uint32_t *argb, int32_t x, int32_t y, int32_t w, int32_t h, int32_t stride);
+        void start_packet(uint32_t now);
+
+        static const uint32_t resync_ms = 1000;
+        static const size_t header_size = 8;
+        static const size_t trailer_size = 2;
+
+        uint32_t bytes_per_sec;
+        uint32_t frame_period_ms;
+        uint32_t max_frame_bytes;
+
+        std::vector<uint8_t> rec;    ///< commands drawn since the last packet
+        std::vector<uint8_t> packet; ///< packet being sent
+        size_t packet_sent = 0;
+
+        bool overflowed = false;
+        std::atomic<bool> full_frame_requested{false}; ///< set by request_full_frame()
+        uint32_t frame = 0;
+        uint32_t last_packet_ms = 0;
+        uint32_t last_resync_ms = 0;
+        uint32_t last_flush_ms = 0;
+        double tokens = 0;
+        uint32_t sent_total = 0;
+        uint32_t resync_count = 0;
+
+        // drawing state, re-sent after a restart
+        uint32_t pen = 0xFFFFFF;
+        uint32_t fill = 0;
+        uint8_t pen_width = 1;
+        uint8_t font = 0;
+    };
+
+    /**
+     * @brief Canvas is what pages draw on. It has the same drawing functions
+     * as vex::brain::lcd and passes every call on to it. While the screen is
+     * being mirrored, the calls are also recorded into the MirrorStream.
+     */
+    class Canvas
+    {
+    public:
+        /**
+         * @brief Create a canvas
+         * @param lcd the screen to draw on
+         * @param mirror where to record drawing. nullptr to not record
+         */
+        Canvas(vex::brain::lcd &lcd, MirrorStream *mirror = nullptr) : scr(lcd), mirror(mirror) {}
+
+        void setPenColor(const vex::color &c);
+        void setPenColor(const char *hex);
+        void setFillColor(const vex::color &c);
+        void setFillColor(const char *hex);
+        void setPenWidth(uint32_t width);
+        void setFont(vex::fontType font);
+        void setClipRegion(int32_t x, int32_t y, int32_t w, int32_t h);
+
+        void drawPixel(int32_t x, int32_t y);
+        void drawLine(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+        void drawRectangle(int32_t x, int32_t y, int32_t w, int32_t h);
+        void drawRectangle(int32_t x, int32_t y, int32_t w, int32_t h, const vex::color &fill);
+        void drawCircle(int32_t x, int32_t y, int32_t radius);
+        void drawCircle(int32_t x, int32_t y, int32_t radius, const vex::color &fill);
+        void drawImageFromBuffer(uint32_t *argb, int32_t x, int32_t y, int32_t w, int32_t h);
+        /**
+         * @brief draw a w x h piece of a bigger image whose rows are stride
+         * pixels apart. The brain only draws whole buffers, so this goes to
+         * the screen a row at a time but is mirrored as a single image
+         */
+        void drawImageFromBuffer(uint32_t *argb, int32_t x, int32_t y, int32_t w, int32_t h, int32_t stride);
+        void clearScreen(const vex::color &c = vex::color::black);
+
+        void printAt(int32_t x, int32_t y, const char *fmt, ...);
+        void printAt(int32_t x, int32_t y, bool opaque, const char *fmt, ...);
+
+        int32_t getStringWidth(const char *s) { return scr.getStringWidth(s); }
+        int32_t getStringHeight(const char *s) { return scr.getStringHeight(s); }
+
+        /// @return the screen underneath, for anything a Canvas doesn't do.
+        /// Drawing on it directly isn't mirrored
+        vex::brain::lcd &lcd() { return scr; }
+
+    private:
+        void record_text(int32_t x, int32_t y, bool opaque, const char *s);
+
+        vex::brain::lcd &scr;
+        MirrorStream *mirror;
+    };
+
+    /**
+     * @brief start mirroring the screen over the USB serial port. Can be
+     * called before or after start_screen
+     * @param bytes_per_sec most bytes sent in a second, on average. The
+     * brain's USB serial comfortably does 20000 or so next to normal printing
+     * @param max_fps most frames sent in a second
+     * Only the first call's settings are used, later calls just start it
+     * again after stop_mirror()
+     */
+    void start_mirror(uint32_t bytes_per_sec = 20000, uint32_t max_fps = 10);
+
+    /// @brief stop mirroring the screen
+    void stop_mirror();
+} // namespace screen
@@ -107,6 +107,15 @@ class TankDrive {
      */
     void drive_tank_raw(double left, double right);
 
+    /**
+     * @brief scale drive voltages for the battery (see BatteryCompensation)
+     * so the same input gives the same speed all match
+     * @param enabled true to compensate, false to send voltages as they are
+     */
+    void set_battery_compensation(bool enabled) {
+        compensate_battery = enabled;
+    }
+
     /**
      * Drive the robot using arcade style controls. forward_back controls the
      * linear motion, left_right controls the turning.
@@ -325,4 +334,6 @@ class TankDrive {
                ///< you're driving)
     bool is_pure_pursuit =
         false; ///< true if we are driving with a pure pursuit system
+    bool compensate_battery =
+        false; ///< scale drive_tank_raw voltages for the battery
 };
@@ -24,7 +24,8 @@ public:
   AutoChooser(std::vector<std::string> paths, size_t def = 0);
 
   void update(bool was_pressed, int x, int y);
-  void draw(vex::brain::lcd &, bool first_draw, unsigned int frame_number);
+  void draw(screen::Canvas &, bool first_draw, unsigned int frame_number);
+  bool updates_in_background() const override { return false; }
 
   /**
    * Get the currently selected auto choice
@@ -0,0 +1,72 @@
+#pragma once
+#include "vex.h"
+
+/**
+ * @brief BatteryCompensation
+ * The output stage shared by every subsystem that commands its motors in
+ * volts.
+ *
+ * Motors are told "spin at X volts" assuming a full battery. As the battery
+ * sags over a match, the same command gives less torque, so a feedforward
+ * tuned at the start of practice (kV especially) undershoots by the end.
+ *
+ * This keeps a filtered reading of the brain's battery voltage and scales
+ * commands by nominal / battery so that X volts means the same thing all
+ * match. The reading is filtered over about a second so current spikes from
+ * the drive accelerating don't make every other subsystem jump.
+ *
+ * Subsystems opt in one by one (see set_battery_compensation() on Flywheel,
+ * TankDrive, Lift and CataIntakeSys) and then pass their voltages through
+ * compensate(). Call start() once from robot_init() so the battery is being
+ * read before any of them run. Until then compensate() leaves voltages
+ * alone.
+ *
+ * Usage:
+ * BatteryCompensation::start(); // in robot_init()
+ * motors.spin(fwd, BatteryCompensation::compensate(ff_volts), volt);
+ */
+class BatteryCompensation {
+  public:
+    /**
+     * @brief scale a voltage for the current battery. Safe to call from any
+     * task
+     * @param volts the voltage that would be right on a battery at
+     * nominal_volts()
+     * @return the voltage to actually send, limited to +/-max_output
+     */
+    static double compensate(double volts);
+
+    /**
+     * @return what commands are multiplied by right now (1 on a nominal
+     * battery, more on a sagging one)
+     */
+    static double scale();
+
+    /**
+     * @return the filtered battery voltage
+     */
+    static double voltage();
+
+    /**
+     * @brief change what battery voltage commands are meant for. Use the
+     * voltage the robot was tuned at
+     * @param volts the nominal battery voltage
+     */
+    static void set_nominal_volts(double volts);
+
+    /**
+     * @return the battery voltage commands are meant for
+     */
+    static double nominal_volts();
+
+    /**
+     * @brief start filtering the battery voltage. Call this once from
+     * robot_init(), before the subsystems start. Not thread safe
+     */
+    static void start();
+
+    static constexpr double max_output = 12.0; ///< the most a motor can be
+                                               ///< told to do
+    static constexpr double max_scale = 1.25;  ///< don't scale up more than
+                                               ///< this for a dying battery
+};
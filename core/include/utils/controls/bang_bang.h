@@ -1,3 +1,4 @@
+#pragma once
 #include "../core/include/utils/controls/feedback_base.h"
 
 class BangBang : public Feedback
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "../core/include/utils/controls/feedback_base.h"
+#include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/pid.h"
+#include "vex.h"
+#include <memory>
+#include <vector>
+
+/**
+ * ControllerBank
+ *
+ * Holds many PID / PIDFF loops and updates all of them at once. Instead of
+ * each loop being its own object with its own timer, the bank keeps every
+ * gain and every bit of state in its own array (p for every loop, i for every
+ * loop, ...) and runs the math for all of them in one plain loop with one
+ * timestamp. That loop is all floats, with no virtual calls, no library calls,
+ * no divisions (loops updated together share one 1/dt) and no branches the
+ * compiler can't turn into selects, so GCC vectorizes it at -O3 (the host
+ * build in tools/host, check with -fopt-info-vec). That matters when running
+ * hundreds of loops in a simulation or tuning sweep. The brain's -Os build
+ * doesn't vectorize, but still gets the cheaper float math. Loops that were
+ * reset or updated on their own since the last update_all() get a dt of
+ * their own.
+ *
+ * Each loop can still be handed to anything that wants a Feedback (see
+ * ControllerBank::Loop), and calling update() on that handle updates just
+ * that loop.
+ *
+ * The math is the same as PIDFF: a PID (integral clamping while saturated)
+ * plus kS*sign + kV*vel + kA*accel + kG of feedforward. Angular loops wrap
+ * their error to +/-180 degrees. Being floats, outputs match PIDFF to about
+ * six significant digits.
+ *
+ * Usage:
+ * ControllerBank bank(4);
+ * Feedback &left = bank.add_pid(drive_pid_cfg);
+ * Feedback &lift = bank.add_pidff(lift_pid_cfg, lift_ff_cfg);
+ * ...
+ * bank.set_measurement(0, left_enc.position(rev));
+ * bank.set_measurement(1, lift_pot.angle(deg));
+ * bank.update_all();
+ *
+ * Not thread safe - update the bank from one task.
+ */
+class ControllerBank {
+  public:
+    /**
+     * A handle to one loop in the bank that acts like any other Feedback
+     */
+    class Loop : public Feedback {
+      public:
+        Loop(ControllerBank &bank, size_t index) : bank(bank), index(index) {}
+
+        void init(double start_pt, double set_pt, double start_vel = 0,
+                  double end_vel = 0) override;
+        /// @brief update only this loop with a new sensor value. Only kS and
+        /// kG are applied, the velocity and acceleration references are zeroed
+        double update(double val) override;
+        /**
+         * @brief update only this loop, with velocity and acceleration
+         * references for the feedforward
+         */
+        double update(double val, double vel_setpt, double a_setpt = 0);
+        double get() override;
+        void set_limits(double lower, double upper) override;
+        bool is_on_target() override;
+
+        /// @brief change the target without resetting the loop
+        void set_target(double target);
+        double get_target() const;
+
+        /// @return where this loop is in the bank's arrays
+        size_t get_index() const { return index; }
+
+      private:
+        ControllerBank &bank;
+        size_t index;
+    };
+
+    /**
+     * @brief Create an empty bank
+     * @param capacity how many loops to make room for up front so adding
+     * them doesn't reallocate
+     */
+    explicit ControllerBank(size_t capacity = 16);
+
+    ControllerBank(const ControllerBank &) = delete;
+    ControllerBank &operator=(const ControllerBank &) = delete;
+
+    /**
+     * @brief add a PID loop
+     * @param cfg the gains. copied in now and again by refresh_gains()
+     * @return a handle to the new loop. lives as long as the bank
+     */
+    Loop &add_pid(PID::pid_config_t &cfg);
+
+    /**
+     * @brief add a PID loop with feedforward
+     * @param pid_cfg the pid gains
+     * @param ff_cfg the feedforward gains
+     * @return a handle to the new loop. lives as long as the bank
+     */
+    Loop &add_pidff(PID::pid_config_t &pid_cfg,
+                    FeedForward::ff_config_t &ff_cfg);
+
+    /**
+     * @return the handle for loop i
+     */
+    Loop &operator[](size_t i) { return *handles[i]; }
+
+    /**
+     * @return how many loops there are
+     */
+    size_t size() const { return kp.size(); }
+
+    /**
+     * @brief copy the gains from every loop's config structs again. Call
+     * this after tuning them (say from a screen page)
+     */
+    void refresh_gains();
+
+    /**
+     * @brief give loop i a new sensor reading for the next update_all()
+     */
+    void set_measurement(size_t i, double val) { meas[i] = val; }
+
+    /**
+     * @brief give loop i velocity and acceleration references for its
+     * feedforward
+     */
+    void set_reference(size_t i, double vel, double accel) {
+        vel_ref[i] = vel;
+        acc_ref[i] = accel;
+    }
+
+    /**
+     * @brief update every loop using the measurements from set_measurement()
+     * and one shared timestamp
+     */
+    void update_all();
+
+    /**
+     * @brief update every loop with a measurement each and one shared
+     * timestamp
+     * @param measurements size() sensor readings, in the order the loops were
+     * added
+     */
+    void update_all(const double *measurements);
+
+    /**
+     * @brief update every loop as if `now` seconds had passed since the bank
+     * was made. For simulations that keep their own time
+     * @param now time in seconds
+     */
+    void update_all_at(double now);
+
+    /**
+     * @return the output of loop i from its last update
+     */
+    double output(size_t i) const { return out[i]; }
+
+  private:
+    /// @brief add a loop with no gains and return its index
+    size_t add_loop(PID::pid_config_t *pid_cfg,
+                    FeedForward::ff_config_t *ff_cfg);
+    /// @brief run the math for loops [begin, end) at time now
+    void step(size_t begin, size_t end, double now);
+    /// @brief the float math for loops [begin, end), which were all last
+    /// updated dt seconds ago
+    void step_together(size_t begin, size_t end, double dt);
+    /// @brief reset the memory of loop i
+    void reset(size_t i, double now);
+
+    vex::timer tmr;
+
+    // where the gains came from, for refresh_gains()
+    std::vector<PID::pid_config_t *> pid_cfgs;
+    std::vector<FeedForward::ff_config_t *> ff_cfgs;
+    std::vector<std::unique_ptr<Loop>> handles;
+
+    // what step_together() reads and writes, in floats so twice as many
+    // loops fit in a vector register (and the brain's NEON has no doubles)
+    std::vector<float> kp, ki, kd, ks, kv, ka, kg, deadband;
+    std::vector<float> angular; ///< 1 for angular loops, 0 for linear
+    std::vector<float> target, meas, vel_ref, acc_ref, lower, upper;
+    std::vector<float> last_err, accum, out;
+
+    // the rest, and times in seconds, stay doubles
+    std::vector<double> on_target_time, end_vel, last_time;
+    std::vector<double> on_target_since; ///< when we got in deadband
+    std::vector<char> in_deadband;       ///< true if we're in deadband
+};
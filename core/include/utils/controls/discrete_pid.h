@@ -0,0 +1,158 @@
+#pragma once
+
+#include "../core/include/utils/controls/feedback_base.h"
+#include "../core/include/utils/controls/pid.h"
+#include "vex.h"
+
+/**
+ * DiscretePID Class
+ *
+ * A PID controller meant to be updated at a fixed rate (say from a
+ * PeriodicTask). Rather than timing itself like PID does, it assumes every
+ * call to update() is exactly sample_time seconds after the last, which makes
+ * it cheap and keeps the math the same no matter how jittery the caller is.
+ *
+ * Compared to PID it:
+ * - takes the derivative of the measurement instead of the error, so changing
+ *   the target doesn't kick the output
+ * - low-pass filters that derivative so running the loop faster doesn't
+ *   amplify sensor noise
+ * - unwinds the integral by how much the output got clamped (back-calculation)
+ *   instead of just pausing it, so it recovers quicker from saturation
+ * - can keep some of a set_target() change out of the proportional term.
+ *   With p_on_measurement = 1 a new target never makes the output jump, the
+ *   integral walks it there instead. init() always starts a fresh movement
+ *   with the full proportional term
+ * - keeps the output continuous when the gains in pid_config_t change
+ *
+ * The formula (h = sample_time, y = measurement, r = target) is:
+ *
+ * P = kP*(error - m*(r - r_init))       (m = p_on_measurement)
+ * D = Tf/(Tf+h) * D_last - kD/(Tf+h) * (y - y_last)
+ * out = clamp(P + I + D)
+ * I += kI*h*error + h/Tt * (out - (P + I + D))
+ *
+ * It uses the same pid_config_t as PID so it can be dropped in anywhere a PID
+ * or a Feedback was.
+ */
+class DiscretePID : public Feedback {
+public:
+  /**
+   * discrete_config_t holds the settings DiscretePID needs on top of the
+   * normal pid_config_t
+   */
+  struct discrete_config_t {
+    double sample_time; ///< seconds between calls to update()
+    double d_cutoff_hz; ///< cutoff frequency of the derivative filter.
+                        ///< 0 for no filtering
+    double tracking_time; ///< how fast the integral unwinds when the output is
+                          ///< clamped (seconds). 0 to pick sqrt(Ti*Td)
+    double p_on_measurement; ///< 0 to 1, how much of a set_target() change
+                             ///< stays out of the proportional term. 0 (or
+                             ///< left out of the braces) is a normal PID, 1
+                             ///< means target changes never bump the output
+  };
+
+  /**
+   * Create the DiscretePID object
+   * @param config the gains, deadband, etc. shared with PID
+   * @param dconfig the sample time and filter settings
+   */
+  DiscretePID(PID::pid_config_t &config, const discrete_config_t &dconfig);
+
+  /**
+   * Inherited from Feedback for interoperability.
+   * Update the setpoint and reset the controller's memory
+   *
+   * @param start_pt the current sensor value
+   * @param set_pt sets the target of the controller
+   * @param start_vel completely ignored. necessary to satisfy Feedback base
+   * @param end_vel sets the target end velocity of the controller
+   */
+  void init(double start_pt, double set_pt, double start_vel = 0,
+            double end_vel = 0) override;
+
+  /**
+   * Run one sample of the controller. Should be called every sample_time
+   * seconds
+   * @param sensor_val the distance, angle, encoder position or whatever it is
+   * we are measuring
+   * @return the new output. What would be returned by DiscretePID::get()
+   */
+  double update(double sensor_val) override;
+
+  /**
+   * Gets the output from when update() was last run
+   * @return the Out value of the controller
+   */
+  double get() override;
+
+  /**
+   * Set the limits on the output. If both are 0, no limits are applied
+   * @param lower the lower limit
+   * @param upper the upper limit
+   */
+  void set_limits(double lower, double upper) override;
+
+  /**
+   * Checks if the controller is on target.
+   * @return true if the loop has been within [deadband] for [on_target_time]
+   * seconds worth of samples
+   */
+  bool is_on_target() override;
+
+  /**
+   * Reset the integral, derivative filter and on target counting
+   */
+  void reset();
+
+  /**
+   * Get the delta between the last sensor reading and the target
+   * @return the error, wrapped if error_method is ANGULAR
+   */
+  double get_error() const;
+
+  /**
+   * @return the target the controller is trying to achieve
+   */
+  double get_target() const;
+
+  /**
+   * Set the target. Unlike init() this doesn't reset anything, the output
+   * carries on smoothly from where it was
+   * @param target the sensor reading we would like to achieve
+   */
+  void set_target(double target);
+
+  /**
+   * @return the sensor value that we were last updated with
+   */
+  double get_sensor_val() const;
+
+  PID::pid_config_t &config; ///< gains and deadband. see pid_config_t
+  discrete_config_t dconfig; ///< sample time and filter settings
+
+private:
+  /// @brief to - from, wrapped if error_method is ANGULAR
+  double wrap_diff(double from, double to) const;
+  /// @brief the error as seen by the proportional term
+  double weighted_error() const;
+
+  double target = 0;     ///< where we're trying to get to
+  double target_moved = 0; ///< how far set_target() moved us since init()
+  double target_vel = 0; ///< if != 0, don't wait to stop before on target
+  double sensor_val = 0; ///< the last sensor reading
+  double last_sensor_val = 0; ///< the sensor reading before that
+  bool first_sample = true;   ///< true if there is no last_sensor_val yet
+
+  double p_term = 0; ///< the proportional part of the last output
+  double i_term = 0; ///< the integral so far (already multiplied by kI)
+  double d_term = 0; ///< the filtered derivative part of the last output
+  double last_p = 0; ///< the kP we used last sample. for bumpless gain changes
+
+  double lower_limit = 0; ///< never output lower than this
+  double upper_limit = 0; ///< never output higher than this
+  double out = 0;         ///< the last output
+
+  unsigned int on_target_samples = 0; ///< samples in a row within deadband
+};
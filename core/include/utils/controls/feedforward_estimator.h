@@ -0,0 +1,144 @@
+#pragma once
+
+#include "../core/include/utils/controls/feedforward.h"
+#include "vex.h"
+
+/**
+ * FeedForwardEstimator
+ *
+ * Learns the FeedForward constants of a mechanism while it's being driven
+ * normally. Every control tick, give it the output that was sent to the
+ * motors and the velocity and acceleration that were measured. It fits
+ *
+ * output = kS*sgn(v) + kV*v + kA*a + kG
+ *
+ * with recursive least squares: each sample nudges the estimate a little
+ * and nothing is stored, so it costs the same every tick no matter how long
+ * it runs. Old samples are slowly forgotten (the forgetting factor) so the
+ * estimate follows the robot as the battery sags over a match.
+ *
+ * Along with the estimate it keeps a rough confidence bound on each constant.
+ * Once every bound is small enough it reports converged() and apply() will
+ * copy the estimate into an ff_config_t - the same one a FeedForward or
+ * PIDFF is already using, so it takes effect on their next update.
+ *
+ * Usage:
+ * FeedForwardEstimator est(FeedForwardEstimator::kS | FeedForwardEstimator::kV | FeedForwardEstimator::kA);
+ * // in the drive loop
+ * est.add_sample(volts_sent, odom.get_speed(), odom.get_accel());
+ * est.apply(drive_ff_cfg);
+ *
+ * Use measured velocity and acceleration, not the setpoints - the point is
+ * to learn what the robot actually does with a given output.
+ */
+class FeedForwardEstimator {
+  public:
+    /// @brief which constants to estimate. Constants that are left out are
+    /// treated as 0 by the fit and never touched by apply()
+    enum Term {
+        kS = 1 << 0,
+        kV = 1 << 1,
+        kA = 1 << 2,
+        kG = 1 << 3,
+        All = kS | kV | kA | kG,
+    };
+
+    /// @brief settings for the estimator
+    struct estimator_config_t {
+        double forgetting; ///< 0-1. how much of the old data to keep each
+                           ///< sample. 0.999 at 100hz remembers ~10 seconds
+        double min_speed;  ///< samples slower than this are ignored (static
+                           ///< friction makes the model wrong near 0)
+        double rel_tolerance; ///< converged when every bound is under this
+                              ///< fraction of its estimate...
+        double abs_tolerance; ///< ...or under this absolute amount
+        int min_samples;      ///< and at least this many samples have been
+                              ///< used
+        double max_covariance; ///< caps the uncertainty so a long stretch of
+                               ///< boring data can't make the next sample
+                               ///< throw the estimate around
+    };
+
+    /// @brief settings that work for most drivetrains and flywheels
+    static const estimator_config_t default_config;
+
+    /**
+     * @brief Create an estimator
+     * @param terms which constants to estimate, Terms or'd together. kS and
+     * kG look the same if the mechanism only ever goes one way, so leave one
+     * of them out for flywheels
+     * @param cfg tuning for the estimator itself
+     * @param initial starting guess. The closer it is the quicker it
+     * converges
+     */
+    explicit FeedForwardEstimator(
+        int terms = kS | kV | kA,
+        const estimator_config_t &cfg = default_config,
+        const FeedForward::ff_config_t &initial = {0, 0, 0, 0});
+
+    /**
+     * @brief forget everything and start over from a guess
+     */
+    void reset(const FeedForward::ff_config_t &initial = {0, 0, 0, 0});
+
+    /**
+     * @brief feed one control tick to the estimator
+     * @param output what was sent to the motors this tick
+     * @param vel measured velocity
+     * @param accel measured acceleration
+     * @return true if the sample was used (false if it was too slow)
+     */
+    bool add_sample(double output, double vel, double accel);
+
+    /**
+     * @return the current estimate. Terms that aren't estimated are 0
+     */
+    FeedForward::ff_config_t estimate() const;
+
+    /**
+     * @return the confidence bound (about 2 standard deviations) on each
+     * constant, in the same units as the constant
+     */
+    FeedForward::ff_config_t bounds() const;
+
+    /**
+     * @return true once every estimated constant's bound is within
+     * tolerance and enough samples have been seen
+     */
+    bool converged() const;
+
+    /**
+     * @brief copy the estimate into cfg if it has converged. Constants that
+     * aren't estimated are left alone
+     * @param cfg the config to update, usually the one a FeedForward or PIDFF
+     * is using
+     * @return true if cfg was changed
+     */
+    bool apply(FeedForward::ff_config_t &cfg) const;
+
+    /**
+     * @return how many samples have been used
+     */
+    int samples() const { return num_samples; }
+
+    /**
+     * @brief print the estimate and bounds over serial
+     */
+    void print() const;
+
+  private:
+    static const int N = 4; ///< one slot per Term, in enum order
+
+    /// @brief the regressor for one sample. Slots for left out terms are 0
+    void regressor(double vel, double accel, double phi[N]) const;
+
+    int terms;
+    estimator_config_t cfg;
+
+    mutable vex::mutex mut;
+    double theta[N];  ///< the estimate
+    double P[N][N];   ///< covariance of the estimate
+    double noise_var; ///< running average of the squared prediction error
+    double noise_weight; ///< how many samples noise_var is worth
+    int num_samples;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+/**
+ * FlywheelObserver
+ *
+ * Estimates flywheel speed from the motor's velocity readings and the output
+ * being sent to the motor. A plain filter only ever lags behind the readings;
+ * the observer also knows what the motor should be doing with the output it
+ * was given, so it can smooth out noise without lagging.
+ *
+ * The model is a first order spin up: with output u (-1 to 1, like
+ * Flywheel::spin_raw) the wheel heads toward u / kV rpm with time constant
+ * tau. kV is the same kV the flywheel's FeedForward uses. Each update
+ * predicts where the wheel should be, then corrects toward the reading with
+ * a Kalman gain.
+ *
+ * The difference between the reading and the prediction (the residual) is
+ * also the best place to see shots. When a ball or disc goes through, the
+ * wheel suddenly slows down by much more than the model says it could. When
+ * the residual drops below -shot_threshold_rpm the observer:
+ * - counts a shot
+ * - jumps its estimate to the reading so the feedback sees the drop right
+ *   away instead of a filtered version of it
+ * - reports a recovery boost for boost_time seconds, which Flywheel adds to
+ *   its output to get back up to speed sooner
+ *
+ * Usage:
+ * FlywheelObserver::observer_config_t obs_cfg = {...};
+ * FlywheelObserver obs(obs_cfg);
+ * flywheel.set_observer(&obs);
+ */
+class FlywheelObserver {
+  public:
+    /// @brief the model of the flywheel, and how to detect and recover from
+    /// shots
+    struct observer_config_t {
+        double kV;  ///< output per rpm at steady state (from the FeedForward)
+        double tau; ///< time constant of the wheel spinning up, in seconds
+        double process_noise;     ///< how far (rpm^2/s) the real wheel
+                                  ///< wanders from the model. Higher trusts
+                                  ///< the readings more
+        double measurement_noise; ///< variance (rpm^2) of the readings.
+                                  ///< Higher trusts the model more
+        double shot_threshold_rpm; ///< a residual below -this is a shot
+        double boost;      ///< output added after a shot
+        double boost_time; ///< how long to add it for, in seconds
+    };
+
+    /**
+     * @brief Create an observer
+     * @param cfg the model. Kept by reference so it can be tuned live
+     */
+    FlywheelObserver(observer_config_t &cfg);
+
+    /**
+     * @brief start over from a known speed
+     * @param rpm the speed to start from
+     */
+    void reset(double rpm);
+
+    /**
+     * @brief run the observer once
+     * @param measured_rpm the velocity reading
+     * @param output the output that has been applied since the last update.
+     * Anything past -1 to 1 is treated as -1 or 1, the motor saturates there
+     * @param dt seconds since the last update
+     * @return the estimated rpm
+     */
+    double update(double measured_rpm, double output, double dt);
+
+    /**
+     * @return the estimated rpm from the last update
+     */
+    double get_rpm() const { return rpm; }
+
+    /**
+     * @return the residual (reading - prediction) from the last update
+     */
+    double get_residual() const { return residual; }
+
+    /**
+     * @return the output to add for recovering from a recent shot (0 if
+     * there wasn't one)
+     */
+    double get_boost() const { return boost_left > 0 ? cfg.boost : 0.0; }
+
+    /**
+     * @return how many shots have been detected since the observer was made
+     */
+    int shots() const { return shot_count; }
+
+  private:
+    observer_config_t &cfg;
+
+    double rpm = 0;      ///< estimated speed
+    double P;            ///< variance of the estimate
+    double residual = 0; ///< last reading minus last prediction
+    double boost_left = 0; ///< seconds of boost left
+    bool in_shot = false;  ///< a shot was detected and hasn't ended yet
+    int shot_count = 0;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "../core/include/utils/controls/feedback_base.h"
+#include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/pid.h"
+#include "../core/include/utils/controls/pidff.h"
+#include "../core/include/utils/serializer.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace screen {
+class Page;
+}
+
+/**
+ * GainSchedule
+ *
+ * A PIDFF whose gains change with the situation. One set of gains usually
+ * has to be tuned for the worst case (a lift fully extended, a long drive, a
+ * low battery) which makes it sluggish everywhere else. A gain schedule holds
+ * a few sets of gains, each for a value of some scheduling variable, and
+ * blends between the two nearest ones every update.
+ *
+ * The scheduling variable can be:
+ * - the measurement (lift height, arm angle)
+ * - the setpoint
+ * - the distance left to the setpoint (gentle near the end of a drive,
+ *   aggressive far from it)
+ * - anything else, through a function (BatteryCompensation::voltage, ...)
+ *
+ * p, i, d, kS, kV, kA and kG are interpolated linearly. deadband,
+ * on_target_time and error_method come from the first breakpoint. Outside
+ * the breakpoints the nearest one is used as is.
+ *
+ * The breakpoints can be saved and loaded with a Serializer and tuned on the
+ * brain with Page().
+ *
+ * Usage:
+ * GainSchedule lift_fb({
+ *     {0.0, {.p = 0.8, ...}, {.kG = 0.5}},   // lift down
+ *     {3.0, {.p = 0.4, ...}, {.kG = 1.2}},   // lift up
+ * });
+ */
+class GainSchedule : public Feedback {
+  public:
+    /// @brief what picks the gains
+    enum class ScheduleBy {
+        Measurement,       ///< the sensor value given to update()
+        Setpoint,          ///< the target
+        DistanceRemaining, ///< |target - sensor value|
+        Custom,            ///< the function given to the constructor
+    };
+
+    /// @brief the gains to use at one value of the scheduling variable
+    struct breakpoint_t {
+        double at;                  ///< value of the scheduling variable
+        PID::pid_config_t pid;      ///< pid gains here
+        FeedForward::ff_config_t ff; ///< feedforward gains here
+    };
+
+    /**
+     * @brief Create a gain schedule
+     * @param breakpoints the gains to blend between. Need not be sorted.
+     * There must be at least one
+     * @param by what picks the gains
+     * @param custom the scheduling variable when by is Custom
+     */
+    GainSchedule(const std::vector<breakpoint_t> &breakpoints,
+                 ScheduleBy by = ScheduleBy::Measurement,
+                 std::function<double()> custom = nullptr);
+
+    /**
+     * @brief add another breakpoint, keeping them sorted
+     */
+    void add_breakpoint(const breakpoint_t &bp);
+
+    /**
+     * @return the breakpoints, sorted by `at`. Changing their gains takes
+     * effect on the next update
+     */
+    std::vector<breakpoint_t> &get_breakpoints() { return points; }
+
+    void init(double start_pt, double set_pt, double start_vel = 0,
+              double end_vel = 0) override;
+
+    /**
+     * @brief pick the gains for the current situation then update the
+     * PIDFF. Only kS and kG of the feedforward are applied
+     * @param val the sensor value
+     * @return the output
+     */
+    double update(double val) override;
+
+    /**
+     * @brief pick the gains for the current situation then update the
+     * PIDFF with velocity and acceleration setpoints for the feedforward
+     */
+    double update(double val, double vel_setpt, double a_setpt = 0);
+
+    double get() override;
+    void set_limits(double lower, double upper) override;
+    bool is_on_target() override;
+
+    /**
+     * @brief change the target without resetting the loop
+     */
+    void set_target(double set_pt);
+
+    /**
+     * @return the scheduling variable from the last update
+     */
+    double get_schedule_value() const { return sched_val; }
+
+    /// @return the pid gains used in the last update
+    const PID::pid_config_t &current_pid() const { return cur_pid; }
+    /// @return the feedforward gains used in the last update
+    const FeedForward::ff_config_t &current_ff() const { return cur_ff; }
+
+    /**
+     * @brief save every breakpoint under name (name_count, name_0_at,
+     * name_0_p, ...)
+     */
+    void save(Serializer &s, const std::string &name) const;
+
+    /**
+     * @brief load breakpoints saved with save(). If nothing was saved under
+     * name, the breakpoints are left alone
+     */
+    void load(Serializer &s, const std::string &name);
+
+    /**
+     * @brief a page for tuning the breakpoints' gains
+     * @param s if not null, the page's Save button saves here
+     * @param name what to save under
+     */
+    screen::Page *Page(Serializer *s = nullptr,
+                       const std::string &name = "schedule");
+
+  private:
+    /// @brief blend the breakpoints for the scheduling variable x into
+    /// cur_pid and cur_ff
+    void schedule(double x);
+    /// @brief the scheduling variable for a sensor value
+    double schedule_value(double val) const;
+
+    std::vector<breakpoint_t> points;
+    ScheduleBy by;
+    std::function<double()> custom;
+
+    PID::pid_config_t cur_pid;
+    FeedForward::ff_config_t cur_ff;
+    PIDFF pidff;
+
+    double sched_val = 0;
+};
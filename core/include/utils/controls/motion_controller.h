@@ -99,12 +99,11 @@ class MotionController : public Feedback
      * It does this by first calculating the kS (voltage to overcome static friction) by slowly increasing
      * the voltage until it moves.
      * 
-     * Next is kV (voltage to sustain a certain velocity), where the robot will record it's steady-state velocity
-     * at 'pct' speed.
+     * Next are kV (voltage to sustain a certain velocity) and kA (voltage needed to accelerate by a certain rate).
+     * The robot drives at 'pct' and every velocity and acceleration measurement along the way is fed to a
+     * FeedForwardEstimator, which fits pct-kS = kV*V + kA*Accel as it goes.
      * 
-     * Finally, kA (voltage needed to accelerate by a certain rate), where the robot will record the entire movement's
-     * velocity and acceleration, record a plot of [X=(pct-kV*V-kS), Y=(Acceleration)] along the movement,
-     * and since kA*Accel = pct-kV*V-kS, the reciprocal of the linear regression is the kA value.
+     * To keep tuning during normal driving instead, see FeedForwardEstimator.
      * 
      * @param drive The tankdrive to operate on
      * @param odometry The robot's odometry subsystem
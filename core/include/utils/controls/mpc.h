@@ -0,0 +1,168 @@
+#pragma once
+
+#include "../core/include/utils/controls/feedback_base.h"
+#include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/trapezoid_profile.h"
+#include "vex.h"
+
+/**
+ * MPC (Model Predictive Controller)
+ *
+ * Instead of reacting to the error right now like a PID, the MPC looks
+ * `horizon` steps into the future. It uses a model of the mechanism to
+ * predict where it will be for every possible sequence of outputs, picks the
+ * sequence that tracks the reference best without going outside the output
+ * limits, sends the first output of that sequence, and does it all again
+ * next update.
+ *
+ * The model is the same one FeedForward uses:
+ * output = kS*sgn(v) + kV*v + kA*a + kG
+ * so a tuned ff_config_t is all it needs. kA must not be 0.
+ *
+ * The reference comes from a TrapezoidProfile (when max_v and accel are set),
+ * so the MPC sees a turn in the profile coming and starts on it early. With
+ * no profile it goes straight for the setpoint, respecting the limits.
+ *
+ * The optimization is solved with a fixed number of iterations of projected
+ * gradient descent on fixed size arrays, so every update takes the same time
+ * and nothing is allocated. The expensive part that only depends on the
+ * model is done once in the constructor.
+ *
+ * Cost minimized over the horizon:
+ * sum q_pos*(pos - pos_ref)^2 + q_vel*(vel - vel_ref)^2
+ *   + r*(output - feedforward of the reference)^2
+ *
+ * update() must be called every `dt` seconds (say from a PeriodicTask).
+ */
+class MPC : public Feedback {
+  public:
+    /// @brief the biggest horizon supported. Sets the size of the arrays
+    static const int max_horizon = 20;
+
+    /// @brief everything needed to set up an MPC
+    struct mpc_config_t {
+        FeedForward::ff_config_t model; ///< how the mechanism responds
+        double dt;         ///< seconds between updates (and between steps of
+                           ///< the horizon)
+        int horizon;       ///< steps to look ahead. at most max_horizon
+        double q_pos;      ///< weight on position error
+        double q_vel;      ///< weight on velocity error
+        double r;          ///< weight on straying from the reference's
+                           ///< feedforward
+        int iterations;    ///< solver iterations per update
+        double max_v;      ///< profile max velocity. 0 for no profile
+        double accel;      ///< profile acceleration. 0 for no profile
+        double deadband;   ///< on target when the error is smaller than this
+        double on_target_time; ///< ...for this many seconds
+    };
+
+    /**
+     * @brief Create an MPC. Does the setup that only depends on the model
+     * @param config the model and weights. Copied, so changing it afterward
+     * does nothing until reconfigure()
+     */
+    MPC(const mpc_config_t &config);
+
+    /**
+     * @brief redo the setup after changing the model or weights
+     */
+    void reconfigure(const mpc_config_t &config);
+
+    /**
+     * @brief start a new movement
+     * @param start_pt where the mechanism is now
+     * @param set_pt where it should end up
+     * @param start_vel how fast it's moving now
+     * @param end_vel how fast it should be moving at the end
+     */
+    void init(double start_pt, double set_pt, double start_vel = 0,
+              double end_vel = 0) override;
+
+    /**
+     * @brief update with a new position reading. The velocity is estimated
+     * from the change in position
+     * @param val the position
+     * @return the output to send to the mechanism
+     */
+    double update(double val) override;
+
+    /**
+     * @brief update with a position and a velocity reading (better than
+     * estimating the velocity from position if there's a velocity sensor)
+     * @param pos the position
+     * @param vel the velocity
+     * @return the output to send to the mechanism
+     */
+    double update(double pos, double vel);
+
+    /**
+     * @return the output from the last update
+     */
+    double get() override;
+
+    /**
+     * @brief limit the output. Both 0 means no limits, but the MPC is at its
+     * best when it knows the real limits (say -12, 12 volts)
+     */
+    void set_limits(double lower, double upper) override;
+
+    /**
+     * @return true once the profile has finished and the mechanism has been
+     * within deadband of the setpoint for on_target_time
+     */
+    bool is_on_target() override;
+
+    /**
+     * @return the reference for the current update
+     */
+    motion_t get_motion() const { return ref[0]; }
+
+    /**
+     * @return how long the last solve took, in microseconds
+     */
+    uint32_t last_solve_us() const { return solve_us; }
+
+  private:
+    static const int N = max_horizon;
+
+    /// @brief fill ref[] with the reference for the next horizon steps
+    void build_reference();
+    /// @brief solve the QP from the current state, result in U[]
+    void solve(double pos, double vel);
+
+    mpc_config_t cfg;
+
+    // Model: x[k+1] = A x[k] + B (u[k] - d[k]), with x = (pos, vel) and d
+    // the kS and kG part of the output
+    double a12, a22, b1, b2;
+
+    // Effect of the input at step j on the position and velocity at step k+1
+    double Gp[N][N], Gv[N][N];
+    // Effect of the starting state on step k+1
+    double Ap12[N], Av22[N];
+    // Hessian of the cost and the solver step size
+    double H[N][N];
+    double step;
+
+    // Per update
+    motion_t ref[N + 1]; ///< reference now and for each step
+    double U[N];      ///< solution, kept to warm start the next solve
+    double Y[N], U_last[N], grad[N], g[N], d[N];
+
+    TrapezoidProfile profile;
+    bool use_profile;
+    vex::timer tmr;
+
+    double target = 0;
+    double end_vel = 0;
+    double lower = 0, upper = 0;
+    double out = 0;
+
+    double last_pos = 0;
+    double est_vel = 0;
+    double last_time = 0;
+    bool in_deadband = false;
+    double on_target_since = 0;
+    double cur_pos = 0;
+    uint32_t solve_us = 0;
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "../core/include/utils/command_structure/auto_command.h"
+#include "../core/include/utils/controls/bang_bang.h"
+#include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/pid.h"
+#include "../core/include/utils/periodic_task.h"
+#include "../core/include/utils/serializer.h"
+#include "vex.h"
+#include <functional>
+#include <string>
+
+namespace screen {
+class Page;
+}
+
+/**
+ * RelayAutotuner
+ *
+ * Finds PID gains for a mechanism by making it oscillate. A BangBang
+ * controller (the relay) pushes the mechanism with bias + amplitude while it's
+ * below the setpoint and bias - amplitude while it's above. Almost any
+ * mechanism settles into a steady oscillation like that, and the size and
+ * period of that oscillation tell us the ultimate gain Ku (the P gain that
+ * would make it oscillate on its own) and the ultimate period Tu:
+ *
+ * Ku = 4 * amplitude / (pi * oscillation half-height)
+ * Tu = time between upward crossings of the setpoint
+ *
+ * From those, a tuning rule (Ziegler-Nichols, Tyreus-Luyben, ...) gives PID
+ * gains. The bias is adjusted each cycle so the relay spends equal time high
+ * and low, which means the average output ends up being what it takes to
+ * hold the mechanism at the setpoint - a good starting kG for a lift or kV
+ * (divided by the setpoint) for a flywheel.
+ *
+ * It can run three ways:
+ * - by hand: call update(sensor, time) from your own loop (or a simulation)
+ *   and send the return value to the motors
+ * - from an autonomous: TuneCmd()
+ * - from the screen: Page()
+ *
+ * Results are saved and loaded through a Serializer so tuning carries over
+ * between programs.
+ */
+class RelayAutotuner {
+  public:
+    /// @brief Tuning rules that turn Ku and Tu into gains
+    enum class Rule {
+        ZieglerNichols,  ///< classic. fast, with lots of overshoot
+        TyreusLuyben,    ///< slower, less overshoot and more robust
+        PessenIntegral,  ///< fast disturbance rejection
+        SomeOvershoot,   ///< ZN variant with less overshoot
+        NoOvershoot,     ///< ZN variant with (almost) no overshoot
+        ZieglerNicholsPI ///< classic without a D term. good for flywheels
+    };
+
+    /// @brief what the relay test measured
+    struct result_t {
+        double ku;          ///< ultimate gain
+        double tu;          ///< ultimate period (seconds)
+        double amplitude;   ///< half height of the oscillation
+        double mean_output; ///< average output it took to hold the setpoint
+        bool valid;         ///< false if the test hasn't finished
+    };
+
+    /**
+     * @brief Create an autotuner
+     * @param sensor reads the mechanism (position, rpm, ...)
+     * @param actuator sends an output to the mechanism (volts, ...)
+     * @param setpoint where to make the mechanism oscillate around. Pick
+     * somewhere safe to move back and forth near
+     * @param amplitude how far above and below bias the relay pushes. Bigger
+     * makes a bigger oscillation
+     * @param bias starting guess for the output it takes to hold the
+     * setpoint (0 for most things, about kG for lifts)
+     * @param cycles how many cycles to average over once the oscillation
+     * settles
+     */
+    RelayAutotuner(std::function<double()> sensor,
+                   std::function<void(double)> actuator, double setpoint,
+                   double amplitude, double bias = 0, int cycles = 4);
+
+    /**
+     * @brief reset and begin a new test
+     * @param sensor_val the current sensor reading
+     * @param now the current time in seconds
+     */
+    void begin(double sensor_val, double now);
+
+    /**
+     * @brief run the relay once
+     * @param sensor_val the current sensor reading
+     * @param now the current time in seconds
+     * @return the output to send to the mechanism (0 once done)
+     */
+    double update(double sensor_val, double now);
+
+    /**
+     * @return true once enough cycles have been measured
+     */
+    bool done() const;
+
+    /**
+     * @return how many full cycles have been seen so far
+     */
+    int cycles_seen() const;
+
+    /**
+     * @return what the test measured. valid is false until done()
+     */
+    result_t result() const;
+
+    /**
+     * @brief turn the result into PID gains
+     * @param rule the tuning rule to use
+     * @param base deadband, on_target_time and error_method are copied from
+     * here
+     * @return the proposed gains
+     */
+    PID::pid_config_t pid_gains(Rule rule,
+                                const PID::pid_config_t &base) const;
+
+    /**
+     * @brief turn the result into feedforward gains. Only the term that the
+     * average output can tell us about is filled in, the rest are copied
+     * from base
+     * @param velocity_loop true if the sensor is a velocity (flywheel): kV is
+     * estimated. false if it's a position (lift): kG is estimated
+     * @param base the other feedforward gains
+     */
+    FeedForward::ff_config_t ff_gains(bool velocity_loop,
+                                      const FeedForward::ff_config_t &base)
+        const;
+
+    /**
+     * @brief save the gains to a serializer under name_p, name_i, name_d
+     * @param s the serializer to save to
+     * @param name prefix for the saved values
+     * @param cfg the gains to save
+     */
+    static void save(Serializer &s, const std::string &name,
+                     const PID::pid_config_t &cfg);
+
+    /**
+     * @brief load gains saved with save() into cfg. Gains that were never
+     * saved are left as they are
+     * @param s the serializer to load from
+     * @param name prefix the values were saved with
+     * @param cfg where to put them
+     */
+    static void load(Serializer &s, const std::string &name,
+                     PID::pid_config_t &cfg);
+
+    /**
+     * @brief start running the test in the background using the sensor and
+     * actuator functions
+     */
+    void start();
+
+    /**
+     * @brief stop the background test and the mechanism
+     */
+    void stop();
+
+    /**
+     * @return true if the background test is running
+     */
+    bool running() const;
+
+    /**
+     * @brief run the test, then write the gains into cfg (and save them if
+     * given a serializer)
+     * @param rule the tuning rule to use
+     * @param cfg where to put the gains
+     * @param s if not null, save the gains here too
+     * @param name the name to save them under
+     * @return a command that finishes when the test does
+     */
+    AutoCommand *TuneCmd(Rule rule, PID::pid_config_t &cfg,
+                         Serializer *s = nullptr,
+                         const std::string &name = "autotune");
+
+    /**
+     * @brief a page to start the test, pick a rule and apply or save the
+     * gains
+     * @param cfg the gains the page's Apply button writes to
+     * @param s if not null, the page's Save button saves to this
+     * @param name the name to save gains under
+     */
+    screen::Page *Page(PID::pid_config_t &cfg, Serializer *s = nullptr,
+                       const std::string &name = "autotune");
+
+    /// @return a printable name for a rule
+    static const char *rule_name(Rule rule);
+
+    static const uint32_t period_ms = 10; ///< how often the background test
+                                          ///< runs
+
+  private:
+    friend class RelayAutotunerPage;
+
+    std::function<double()> sensor;
+    std::function<void(double)> actuator;
+    double setpoint;
+    double amplitude;
+    double start_bias;
+    int cycles_wanted;
+
+    BangBang relay;
+    vex::timer tmr;
+    PeriodicTask task;
+
+    // measurements of the current test
+    double bias = 0;
+    bool above = false;         ///< which side of the setpoint we're on
+    double last_switch = 0;     ///< when the relay last switched
+    double time_high = 0;       ///< time spent high this cycle
+    double time_low = 0;        ///< time spent low this cycle
+    double last_rise = -1;      ///< when we last crossed the setpoint going up
+    double cycle_max = 0;       ///< highest reading this cycle
+    double cycle_min = 0;       ///< lowest reading this cycle
+    int cycles = 0;             ///< full cycles seen (counting the first)
+    double sum_period = 0;      ///< summed over the measured cycles
+    double sum_amplitude = 0;   ///< summed over the measured cycles
+    double sum_bias = 0;        ///< summed over the measured cycles
+    int measured = 0;           ///< cycles that went into the sums
+};
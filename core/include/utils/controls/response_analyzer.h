@@ -0,0 +1,201 @@
+#pragma once
+
+#include "../core/include/utils/controls/feedback_base.h"
+#include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/pid.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Plant
+ * A model of a mechanism for ResponseAnalyzer to run a controller against
+ */
+class Plant {
+  public:
+    virtual ~Plant() {}
+    /// @brief put the mechanism back at rest at x0
+    virtual void reset(double x0) = 0;
+    /**
+     * @brief apply output u for dt seconds
+     * @return the new sensor reading
+     */
+    virtual double step(double u, double dt) = 0;
+};
+
+/**
+ * A mechanism whose reading heads toward gain * u with time constant tau.
+ * Flywheel rpm is a good example
+ */
+class FirstOrderPlant : public Plant {
+  public:
+    FirstOrderPlant(double gain, double tau) : gain(gain), tau(tau) {}
+    void reset(double x0) override { x = x0; }
+    double step(double u, double dt) override;
+
+  private:
+    double gain, tau;
+    double x = 0;
+};
+
+/**
+ * A mechanism whose position follows the FeedForward model
+ * u = kS*sgn(v) + kV*v + kA*a + kG
+ * (drivetrains, lifts, arms). kA must not be 0
+ */
+class InertiaPlant : public Plant {
+  public:
+    InertiaPlant(const FeedForward::ff_config_t &model) : model(model) {}
+    void reset(double x0) override {
+        pos = x0;
+        vel = 0;
+    }
+    double step(double u, double dt) override;
+
+  private:
+    FeedForward::ff_config_t model;
+    double pos = 0, vel = 0;
+};
+
+/**
+ * ResponseAnalyzer
+ *
+ * Measures how well a Feedback controls a Plant:
+ * - step_response(): rise time, overshoot, settling time, steady state error
+ * - bode(): the loop's frequency response, measured by adding a sine wave to
+ *   the output and comparing what comes back around the loop. margins() turns
+ *   that into gain and phase margins
+ * - pid_grid(): both of those for every combination of a list of gains
+ *
+ * Controllers keep their own vex::timers, so simulated time has to pass as
+ * fast as the controller thinks it does. Between steps the analyzer calls
+ * `advance(dt)`. On the brain that is a vexDelay (the default) and an
+ * analysis takes as long as the simulated motion would. tools/host builds
+ * this against a simulated clock where vexDelay only moves the clock, so a
+ * grid of hundreds of combinations runs in well under a second there (see
+ * tools/host/response_grid.cpp).
+ *
+ * Results can be printed as csv over serial or saved to the SD card.
+ */
+class ResponseAnalyzer {
+  public:
+    /// @brief what a step response looked like
+    struct step_metrics_t {
+        double rise_time;     ///< seconds from 10% to 90% of the step
+        double overshoot;     ///< how far past the setpoint it went, as a
+                              ///< fraction of the step
+        double settling_time; ///< seconds until it stayed within the band
+        double steady_state_error; ///< |setpoint - final reading|
+        bool settled;              ///< false if it never stayed in the band
+    };
+
+    /// @brief one point of the loop's frequency response
+    struct freq_point_t {
+        double hz;    ///< frequency
+        double gain;  ///< |L|, loop gain (not dB)
+        double phase; ///< angle of L in degrees, unwrapped by bode()
+    };
+
+    /// @brief stability margins from a frequency response
+    struct margins_t {
+        double gain_margin_db;   ///< how much more gain until oscillation
+        double phase_margin_deg; ///< how much more lag until oscillation
+        double crossover_hz;     ///< where |L| = 1
+        double phase_crossover_hz; ///< where the phase is -180
+        bool has_gain_margin;  ///< false if the phase never reached -180
+        bool has_phase_margin; ///< false if |L| never crossed 1
+    };
+
+    /// @brief everything measured for one set of gains in pid_grid()
+    struct grid_result_t {
+        PID::pid_config_t cfg;
+        step_metrics_t step;
+        margins_t margins;
+    };
+
+    /// @brief makes a controller from gains, for pid_grid()
+    typedef std::function<std::unique_ptr<Feedback>(PID::pid_config_t &)>
+        feedback_factory_t;
+
+    /**
+     * @brief Create an analyzer
+     * @param dt seconds per simulation step
+     * @param advance called between steps to let dt pass for the
+     * controller's timers. Defaults to waiting for real
+     */
+    ResponseAnalyzer(double dt, std::function<void(double)> advance =
+                                    ResponseAnalyzer::wait_realtime);
+
+    /**
+     * @brief run a step from start to setpoint
+     * @param fb the controller
+     * @param plant the mechanism
+     * @param start where the mechanism starts
+     * @param setpoint where it's told to go
+     * @param duration how long to run for
+     * @param band settled once within this fraction of the step
+     */
+    step_metrics_t step_response(Feedback &fb, Plant &plant, double start,
+                                 double setpoint, double duration,
+                                 double band = 0.02);
+
+    /**
+     * @brief measure the loop gain at one frequency. The controller holds
+     * operating_pt while a sine of amplitude is added to its output
+     * @param settle_cycles cycles to run before measuring
+     * @param cycles cycles to measure over
+     */
+    freq_point_t loop_response(Feedback &fb, Plant &plant, double hz,
+                               double amplitude, double operating_pt,
+                               int settle_cycles = 2, int cycles = 4);
+
+    /**
+     * @brief measure the loop gain at `points` frequencies spaced evenly (on
+     * a log scale) from hz_lo to hz_hi
+     */
+    std::vector<freq_point_t> bode(Feedback &fb, Plant &plant, double hz_lo,
+                                   double hz_hi, int points, double amplitude,
+                                   double operating_pt);
+
+    /**
+     * @brief find the gain and phase margins in a frequency response from
+     * bode()
+     */
+    static margins_t margins(const std::vector<freq_point_t> &resp);
+
+    /**
+     * @brief run a step response and a bode sweep for every combination of
+     * ps, is and ds
+     * @param base deadband, on_target_time and error_method for every run
+     * @param make builds the controller for a set of gains (a PID if null)
+     * @param plant the mechanism
+     * @param start step start / operating point of the sweep
+     * @param setpoint step end
+     * @param duration how long each step runs
+     * @param hz_lo lowest sweep frequency
+     * @param hz_hi highest sweep frequency
+     * @param points frequencies per sweep. 0 to skip the sweeps
+     * @param amplitude size of the sine added during the sweeps
+     */
+    std::vector<grid_result_t>
+    pid_grid(const PID::pid_config_t &base, const std::vector<double> &ps,
+             const std::vector<double> &is, const std::vector<double> &ds,
+             feedback_factory_t make, Plant &plant, double start,
+             double setpoint, double duration, double hz_lo = 0.1,
+             double hz_hi = 20, int points = 0, double amplitude = 0.1);
+
+    /// @brief print grid results as csv over serial
+    static void print_csv(const std::vector<grid_result_t> &results);
+
+    /// @brief save grid results as csv on the SD card
+    static void log_csv(const std::vector<grid_result_t> &results,
+                        const std::string &filename);
+
+    /// @brief the default advance: wait dt seconds for real
+    static void wait_realtime(double dt);
+
+  private:
+    double dt;
+    std::function<void(double)> advance;
+};
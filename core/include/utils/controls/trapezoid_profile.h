@@ -140,6 +140,7 @@ private:
 
   trapezoid_profile_segment_t segments[MAX_TRAPEZOID_PROFILE_SEGMENTS];
   int num_acceleration_phases;
+  int num_segments; ///< how many of segments are part of the profile
 
   bool precalculated; ///< whether or not the segment array is up to date
 
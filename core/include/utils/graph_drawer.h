@@ -3,11 +3,24 @@
 #include <string>
 #include <stdio.h>
 #include <vector>
+#include <initializer_list>
 #include <cmath>
 #include "vex.h"
 #include "../core/include/utils/geometry.h"
 #include "../core/include/utils/vector2d.h"
+#include "../core/include/subsystems/screen_mirror.h"
 
+/**
+ * GraphDrawer
+ * Graphs one or more series of samples over time.
+ *
+ * Samples go into a ring allocated in the constructor, so adding them never
+ * allocates and they can come in at the control loop's rate. When there are
+ * more samples than pixels across, each column of pixels is drawn as a line
+ * from the smallest to the biggest sample that landed in it, so short spikes
+ * still show up. With auto bounds, the window follows the samples currently
+ * on the graph (growing right away, shrinking gradually).
+ */
 class GraphDrawer
 {
 public:
@@ -22,13 +35,26 @@ public:
    * add_samples adds a point to the graph, removing one from the back
    * @param sample an x, y coordinate of the next point to graph
    */
-  void add_samples(std::vector<point_t> sample);
+  void add_samples(const std::vector<point_t> &sample);
 
   /**
    * add_samples adds a point to the graph, removing one from the back
    * @param sample a y coordinate of the next point to graph, the x coordinate is gotten from vex::timer::system(); (time in ms)
    */
-  void add_samples(std::vector<double> sample);
+  void add_samples(const std::vector<double> &sample);
+
+  /**
+   * add_samples adds a point to each series without allocating, e.g. add_samples({target, actual})
+   * @param sample a y coordinate for each series, timestamped with vex::timer::system()
+   */
+  void add_samples(std::initializer_list<double> sample);
+
+  /**
+   * add_samples adds a point to each series without allocating
+   * @param sample a y coordinate for each series, timestamped with vex::timer::system()
+   * @param n how many values sample points to. Should be the number of series
+   */
+  void add_samples(const double *sample, size_t n);
 
   /**
    * draws the graph to the screen in the constructor
@@ -37,15 +63,37 @@ public:
    * @param width the width of the graphed region
    * @param height the height of the graphed region
    */
-  void draw(vex::brain::lcd &screen, int x, int y, int width, int height);
+  void draw(screen::Canvas &screen, int x, int y, int width, int height);
+
+  /**
+   * @return bytes held by the samples and the drawing buffers
+   */
+  size_t memory_bytes() const;
+
+  /**
+   * release frees the samples and the drawing buffers, for a page that's
+   * been put away. The graph starts over, empty, on the next add_samples
+   */
+  void release();
 
 private:
+  /// @brief move the auto bounds toward the samples on the graph now
+  void slide_bounds(size_t oldest, size_t count);
+  /// @brief allocate the samples again after release()
+  void restore();
+
   std::vector<std::vector<point_t>> series;
+  size_t num_samples; ///< size of each series' ring
   int sample_index = 0;
+  size_t filled = 0; ///< samples added so far, up to the size of the ring
   std::vector<vex::color> cols;
   vex::color bgcol = vex::transparent;
-  bool border;
+  bool border = false;
   double upper;
   double lower;
   bool auto_fit = false;
+
+  // per pixel column buckets for draw(), only reallocated when the width changes
+  std::vector<double> col_min, col_max, col_first, col_last;
+  std::vector<bool> col_used;
 };
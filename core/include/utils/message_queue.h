@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief MessageQueue
+ * A bounded, lock-free, multiple producer single consumer queue.
+ * Any number of threads (button callbacks, auto commands, other state
+ * machines) can push into it at the same time, but only one thread may pop
+ * from it. It never allocates after construction and never blocks so it is
+ * safe to push into from anywhere.
+ *
+ * Each slot carries a sequence number that tells producers and the consumer
+ * whether that slot is free to write or ready to read (see Dmitry Vyukov's
+ * bounded queue for the original design).
+ *
+ * @tparam T the type of thing to hold. should be cheap to copy (an enum is
+ * perfect)
+ * @tparam capacity how many items can be waiting at once. Must be a power of 2
+ */
+template <typename T, size_t capacity> class MessageQueue {
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0,
+                  "MessageQueue capacity must be a power of 2");
+
+  public:
+    /**
+     * @brief Create an empty queue
+     */
+    MessageQueue() : head(0), tail(0) {
+        for (size_t i = 0; i < capacity; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MessageQueue(const MessageQueue &) = delete;
+    MessageQueue &operator=(const MessageQueue &) = delete;
+
+    /**
+     * @brief add an item to the back of the queue. Safe to call from any
+     * thread
+     * @param item the thing to add
+     * @return true if it was added, false if the queue was full
+     */
+    bool push(const T &item) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                // slot is free, try to claim it
+                if (tail.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // consumer hasn't gotten here yet, we're full
+                return false;
+            } else {
+                // someone else claimed it first, try again
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = item;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief take the item at the front of the queue. Only ONE thread may
+     * call this
+     * @param out where to put the item if there is one
+     * @return true if an item was taken, false if the queue was empty
+     */
+    bool pop(T &out) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        Cell &cell = cells[pos & mask];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) {
+            return false;
+        }
+        out = cell.data;
+        cell.seq.store(pos + capacity, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief check if anything is waiting. Only meaningful from the consumer
+     * thread, other threads may see a slightly stale answer
+     * @return true if there is nothing to pop
+     */
+    bool empty() const {
+        size_t pos = head.load(std::memory_order_relaxed);
+        size_t seq = cells[pos & mask].seq.load(std::memory_order_acquire);
+        return (intptr_t)seq - (intptr_t)(pos + 1) < 0;
+    }
+
+  private:
+    static const size_t mask = capacity - 1;
+
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    Cell cells[capacity];
+    std::atomic<size_t> head; ///< next slot the consumer will read
+    std::atomic<size_t> tail; ///< next slot a producer will claim
+};
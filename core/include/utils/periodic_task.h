@@ -0,0 +1,163 @@
+#pragma once
+#include "vex.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace screen {
+class Page;
+}
+
+/**
+ * @brief PeriodicTask
+ * A background loop that runs a function every period_ms milliseconds and
+ * keeps track of how long that function takes.
+ *
+ * Every subsystem that used to make its own `while(true){...; vexDelay(x);}`
+ * task should declare one of these instead so that all the loops on the robot
+ * show up in one place. Each task says how often it should run (period), how
+ * long it expects one run to take (budget) and what vex priority it runs at.
+ *
+ * Runs are scheduled against a fixed timeline (release n is at start + n *
+ * period) rather than sleeping a fixed amount after each run, so a run that
+ * takes a while doesn't push every later run back. If a run takes so long
+ * that whole periods go by, those periods are skipped (and counted) instead
+ * of running several times back to back to catch up.
+ *
+ * Every task is added to a registry when it's constructed. Use
+ * PeriodicTask::Page() to see all of them on the brain screen, or
+ * print_stats()/log_stats() to send them over serial or to the SD card.
+ *
+ * Usage:
+ * PeriodicTask blinker("blinker", 100, 200, [](){ toggle_the_light(); });
+ * blinker.start();
+ */
+class PeriodicTask {
+  public:
+    /**
+     * @brief a snapshot of how a task has been doing
+     */
+    struct stats_t {
+        const char *name;   ///< the name the task was declared with
+        uint32_t period_ms; ///< how often it should run
+        uint32_t budget_us; ///< how long one run is allowed to take
+        int32_t priority;   ///< vex task priority
+        bool running;       ///< false if stopped or never started
+        uint32_t runs;      ///< how many times the function has been run
+        uint32_t overruns;  ///< runs that took longer than budget_us
+        uint32_t missed;    ///< periods skipped because a run went too long
+        uint32_t last_us;   ///< how long the most recent run took
+        uint32_t max_us;    ///< longest run
+        double avg_us;      ///< average run
+        double cpu_share;   ///< fraction of the last second spent running (0-1)
+    };
+
+    /**
+     * @brief Declare a periodic task. It doesn't run until start() is called
+     * @param name what to call the task on the screen and in logs. Must live
+     * forever (a string literal is perfect)
+     * @param period_ms how often to run body
+     * @param budget_us how long one run of body should take at most. 0 means
+     * the whole period
+     * @param body the function to run
+     * @param priority the vex task priority to run at
+     */
+    PeriodicTask(const char *name, uint32_t period_ms, uint32_t budget_us,
+                 std::function<void()> body,
+                 int32_t priority = vex::task::taskPriorityNormal);
+
+    PeriodicTask(const PeriodicTask &) = delete;
+    PeriodicTask &operator=(const PeriodicTask &) = delete;
+
+    /**
+     * @brief stops the task and removes it from the registry
+     */
+    ~PeriodicTask();
+
+    /**
+     * @brief begin running. Does nothing if already running. If the task was
+     * stopped from inside body and that run hasn't finished yet, the same
+     * loop just keeps going (without the start delay)
+     * @param start_delay_ms how long to wait before the first run (useful for
+     * letting sensors warm up)
+     */
+    void start(uint32_t start_delay_ms = 0);
+
+    /**
+     * @brief stop running. The stats are kept and start() may be called again.
+     * From another task this waits until the current run (if any) finishes
+     * and the loop has exited, so anything body uses can be freed as soon as
+     * it returns. From inside body it returns right away, the current run
+     * finishes and no more are started
+     */
+    void stop();
+
+    /**
+     * @return true if the task has been started and not stopped
+     */
+    bool running() const;
+
+    /**
+     * @return how this task has been doing. Safe to call from any thread
+     */
+    stats_t stats() const;
+
+    /**
+     * @return stats for every declared task, in the order they were declared
+     */
+    static std::vector<stats_t> all_stats();
+
+    /**
+     * @brief print a table of every task's stats over serial
+     */
+    static void print_stats();
+
+    /**
+     * @brief write every task's stats as csv to a file on the SD card. Slow,
+     * don't call this from a control loop
+     * @param filename the file to write to (overwritten)
+     */
+    static void log_stats(const std::string &filename);
+
+    /**
+     * @return a page showing every task's timing
+     */
+    static screen::Page *Page();
+
+  private:
+    static int runner_func(void *self);
+    /// @brief add one run that took run_us to the stats
+    void record(uint32_t run_us, uint64_t now_us);
+    /// @brief sleep for ms, or less if we get stopped
+    void sleep_while_running(int32_t ms);
+    /// @return true if called from our own loop (from inside body)
+    bool on_own_task() const;
+
+    const char *name;
+    uint32_t period_ms;
+    uint32_t budget_us;
+    int32_t priority;
+    std::function<void()> body;
+
+    vex::task runner;
+    vex::mutex life_mut; ///< guards starting and ending the loop
+    std::atomic<bool> is_running{false}; ///< false once stop() is called
+    std::atomic<bool> loop_alive{false}; ///< true until runner_func returns
+    std::atomic<int32_t> runner_id{-1};  ///< vex thread id of the loop
+    uint32_t start_delay_ms = 0;
+
+    mutable vex::mutex mut; ///< guards everything below
+    uint32_t runs = 0;
+    uint32_t overruns = 0;
+    uint32_t missed = 0;
+    uint32_t last_us = 0;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+
+    // cpu share is measured over windows of this long
+    static const uint64_t window_us = 1000000;
+    uint64_t window_start_us = 0;
+    uint64_t window_busy_us = 0;
+    double cpu_share = 0.0;
+};
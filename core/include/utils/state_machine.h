@@ -1,7 +1,200 @@
 #pragma once
+#include "../core/include/utils/logger.h"
+#include "../core/include/utils/message_queue.h"
+#include "../core/include/utils/periodic_task.h"
+#include "vex.h"
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+/**
+ * @brief StateMachineExecutor
+ * Runs any number of state machines on one shared background task instead of
+ * every machine getting its own task.
+ * A machine is only stepped when it has messages waiting or when its work()
+ * is due. Between those times the executor sleeps until the earliest deadline
+ * of all its machines, so the whole executor wakes up about as often as its
+ * fastest machine's delay_ms. A message sent while it sleeps is handled at
+ * that deadline, which is never later than the receiving machine's own next
+ * work(), the same as when every machine polled on its own task. A message
+ * sent while it's stepping is picked up before it goes back to sleep.
+ *
+ * Machines are dispatched in priority order. After every step the executor
+ * looks again from the highest priority machine, so a high priority machine
+ * that became ready while a lower one was stepping goes next. A step itself
+ * is never interrupted (we're running on one task) so keep entry(), work()
+ * and exit() short. Give the executor a higher task priority than the robot's
+ * other loops if its machines should cut in front of them.
+ *
+ * Machines add themselves when they're constructed and remove themselves when
+ * they're destroyed. The executor doesn't step anything until start() is
+ * called, so call it once every machine on it has been constructed.
+ *
+ * Usage:
+ * StateMachineExecutor exec;
+ * Thing1 t1(..., &exec); // Thing1 : public StateMachine<Thing1, ...>
+ * Thing2 t2(..., &exec);
+ * exec.start();
+ */
+class StateMachineExecutor {
+  public:
+    /**
+     * @brief Something the executor knows how to run. StateMachine implements
+     * this, you shouldn't have to
+     */
+    class Dispatchable {
+      public:
+        /**
+         * @brief check if this needs to run
+         * @param now_ms the current time from vex::timer::system()
+         * @return true if there are messages waiting or work is due
+         */
+        virtual bool ready(uint32_t now_ms) const = 0;
+        /**
+         * @return the time (from vex::timer::system()) that work is due next
+         */
+        virtual uint32_t next_due() const = 0;
+        /**
+         * @brief handle all waiting messages and run work if it is due
+         * @param now_ms the current time from vex::timer::system()
+         */
+        virtual void step(uint32_t now_ms) = 0;
+
+        virtual ~Dispatchable() {}
+    };
+
+    /**
+     * @brief Create an executor. Nothing runs until start() is called
+     * @param task_priority the vex task priority of the shared task
+     */
+    explicit StateMachineExecutor(
+        int32_t task_priority = vex::task::taskPriorityNormal)
+        : task_priority(task_priority) {}
+
+    StateMachineExecutor(const StateMachineExecutor &) = delete;
+    StateMachineExecutor &operator=(const StateMachineExecutor &) = delete;
+
+    /**
+     * @brief start the shared task. Does nothing if already started
+     */
+    void start() {
+        if (started.exchange(true)) {
+            return;
+        }
+        runner = vex::task(thread_runner, this, task_priority);
+    }
+
+    /**
+     * @brief start running a machine on this executor. This is called for you
+     * by the StateMachine constructor
+     * @param machine the machine to run
+     * @param priority higher priorities are dispatched first
+     */
+    void add(Dispatchable *machine, int priority) {
+        mut.lock();
+        Entry e = {machine, priority};
+        // keep sorted highest priority first. stable so equal priorities run
+        // in the order they were added
+        auto it = std::upper_bound(
+            machines.begin(), machines.end(), e,
+            [](const Entry &a, const Entry &b) {
+                return a.priority > b.priority;
+            });
+        machines.insert(it, e);
+        mut.unlock();
+        notify();
+    }
+
+    /**
+     * @brief stop running a machine. This is called for you by the
+     * StateMachine destructor. If the machine is in the middle of a step this
+     * waits for the step to finish
+     * @param machine the machine to remove
+     */
+    void remove(Dispatchable *machine) {
+        mut.lock();
+        machines.erase(std::remove_if(machines.begin(), machines.end(),
+                                      [machine](const Entry &e) {
+                                          return e.machine == machine;
+                                      }),
+                       machines.end());
+        mut.unlock();
+    }
+
+    /**
+     * @brief tell the executor a machine has something to do, so it looks
+     * again before going to sleep. Safe to call from any thread,
+     * StateMachine::send_message calls it
+     */
+    void notify() { woken = true; }
+
+  private:
+    struct Entry {
+        Dispatchable *machine;
+        int priority;
+    };
+
+    int32_t task_priority;
+    std::atomic<bool> started{false};
+    std::atomic<bool> woken{false};
+    vex::mutex mut;
+    std::vector<Entry> machines;
+    vex::task runner;
+
+    /// how long to sleep with no machines to wait on
+    static const int32_t idle_ms = 20;
+
+    /**
+     * @brief the shared task. Steps ready machines highest priority first
+     * until none are ready, then sleeps until the next one is due
+     */
+    static int thread_runner(void *vptr) {
+        StateMachineExecutor &exec = *static_cast<StateMachineExecutor *>(vptr);
+        while (true) {
+            exec.woken = false;
+
+            exec.mut.lock();
+            bool stepped = true;
+            while (stepped) {
+                stepped = false;
+                uint32_t now = vex::timer::system();
+                for (Entry &e : exec.machines) {
+                    if (e.machine->ready(now)) {
+                        e.machine->step(now);
+                        stepped = true;
+                        // start over in case something more important is
+                        // ready now
+                        break;
+                    }
+                }
+            }
+
+            // figure out how long we can sleep for
+            uint32_t now = vex::timer::system();
+            int32_t wait_ms = idle_ms;
+            for (Entry &e : exec.machines) {
+                int32_t until_due = (int32_t)(e.machine->next_due() - now);
+                if (until_due < wait_ms) {
+                    wait_ms = until_due;
+                }
+            }
+            exec.mut.unlock();
+
+            // A message came in while we were stepping, go around again
+            // (after letting other tasks have a turn). Otherwise sleep once,
+            // until the earliest deadline
+            if (exec.woken || wait_ms < 1) {
+                wait_ms = 1;
+            }
+            vexDelay(wait_ms);
+        }
+        return 0;
+    }
+};
 
 /**
  * @brief State Machine :))))))
@@ -10,6 +203,11 @@
  * example)
  * The statemachine runs in a background thread and a user thread can interact
  * with it through current_state and send_message.
+ * Messages are queued so a burst of them (say two button callbacks in the same
+ * loop) are all delivered, in order. By default each machine gets its own
+ * background PeriodicTask (so it shows up with the rest of the robot's loops)
+ * but multiple machines can share one task by giving them a
+ * StateMachineExecutor.
  *
  * Designwise:
  * the System class should hold onto any motors, feedback controllers, etc that
@@ -18,6 +216,43 @@
  * certain amount of time, it should hold a timer rather than the System holding
  * that timer. (see Junder from 2024 for an example of this design)
  *
+ * Every state is constructed once, when the machine is, and switching states
+ * just switches which one is current (no new/delete while running). Because
+ * of that, entry() should reset anything the state keeps between visits.
+ *
+ * Which message moves which state to which is written down as a table in the
+ * System:
+ * static constexpr Transition transitions[] = {
+ *     {ThingState::Off, ThingMessage::Enable, ThingState::On},
+ *     {ThingState::On, ThingMessage::Disable, ThingState::Off},
+ * };
+ * (and `constexpr Thing::Transition Thing::transitions[];` in the .cpp)
+ * A message with no entry for the current state is ignored. The table is
+ * checked when the machine is compiled so a state that tries to go two places
+ * on the same message or go to itself won't build.
+ *
+ * Hierarchy:
+ * A state can live inside another by overriding parent(). When a message
+ * comes in and the current state has no transition for it, its parent gets a
+ * try, then the parent's parent and so on. This lets a whole group of states
+ * share one row (`{Enabled, Disable, Off}` instead of one per enabled state).
+ * Going between states exits everything up to the closest shared parent and
+ * enters everything down to the new state, outermost first. A state with
+ * children picks which one to go into with initial_child().
+ *
+ * Regions:
+ * A machine can be in several states at once, one per region, by giving the
+ * constructor more than one initial state. Every message goes to every region
+ * so one region can react to something another does by sending a message
+ * from its entry()/exit()/work() (`sys.send_message(...)`). Those get handled
+ * in the same step they were sent from, no waiting on another task.
+ *
+ * Every machine also keeps a small trace of its most recent transitions and a
+ * histogram of how long it stayed in each state. Recording only happens on a
+ * transition so it's cheap enough to leave on during a match. Look at them
+ * with get_trace() and get_dwell() or save them to the SD card with
+ * dump_trace().
+ *
  * @tparam System The system that this is the base class of `class Thing :
  * public StateMachine<Thing>
  * @tparam IDType The ID enum that recognizes states. Hint hint, use an `enum
@@ -30,10 +265,12 @@
  * and current states. If true, it is expected that IDType and Message have a
  * function called to_string that takes them as its only parameter and returns a
  * std::string
+ * @tparam queue_size how many outside messages can be waiting before
+ * send_message starts refusing them. Must be a power of 2
  */
 template <typename System, typename IDType, typename Message, int32_t delay_ms,
-          bool do_log = false>
-class StateMachine {
+          bool do_log = false, size_t queue_size = 8>
+class StateMachine : public StateMachineExecutor::Dispatchable {
     static_assert(std::is_enum<Message>::value,
                   "Message should be an enum (it's easier that way)");
     static_assert(std::is_enum<IDType>::value,
@@ -73,10 +310,70 @@ class StateMachine {
         bool exists;
         Message thing;
     };
+
+    /**
+     * @brief one row of the System's transition table. When in state `from`
+     * (or a state inside it) and the message `on` comes in, go to state `to`
+     */
+    struct Transition {
+        IDType from;
+        Message on;
+        IDType to;
+    };
+
+    /**
+     * @brief one recorded transition
+     */
+    struct TraceEvent {
+        uint32_t time_ms;          ///< when it happened (vex::timer::system())
+        IDType from;               ///< the state we left
+        Message msg;               ///< the message that made us leave
+        IDType to;                 ///< the state we went to
+        uint32_t time_in_state_ms; ///< how long we were in `from`
+    };
+
+    /**
+     * @brief how long the machine stays in a state each time it visits.
+     * Bucket 0 holds visits of 0ms, bucket i holds visits of [2^(i-1), 2^i)
+     * ms and the last bucket holds everything longer
+     */
+    struct DwellHistogram {
+        static const int num_buckets = 16;
+        uint32_t buckets[num_buckets];
+        uint32_t count;    ///< number of visits recorded
+        uint32_t total_ms; ///< sum of all visits
+        uint32_t max_ms;   ///< longest visit
+
+        DwellHistogram() : buckets(), count(0), total_ms(0), max_ms(0) {}
+
+        /// @brief record one visit that lasted ms milliseconds
+        void add(uint32_t ms) {
+            int b = 0;
+            for (uint32_t v = ms; v != 0 && b < num_buckets - 1; v >>= 1) {
+                b++;
+            }
+            buckets[b]++;
+            count++;
+            total_ms += ms;
+            if (ms > max_ms) {
+                max_ms = ms;
+            }
+        }
+        /// @return the average visit length in ms, 0 if never visited
+        double mean_ms() const {
+            return count == 0 ? 0.0 : (double)total_ms / (double)count;
+        }
+    };
+
+    /// number of transitions remembered by the trace
+    static const size_t trace_len = 64;
+    /// how deep states can be nested inside each other
+    static const size_t max_depth = 8;
+
     /**
      * Abstract class that all states for this machine must inherit from
-     * States MUST override respond() and id() in order to function correctly
-     * (the compiler won't have it any other way)
+     * States MUST override id() in order to function correctly (the compiler
+     * won't have it any other way)
      */
     struct State {
         // run once when we enter the state
@@ -85,122 +382,522 @@ class StateMachine {
         virtual MaybeMessage work(System &) { return {}; }
         // run once when we exit the state
         virtual void exit(System &) {}
-        // respond to a message when one comes in
-        virtual State *respond(System &s, Message m) = 0;
         // Identify
         virtual IDType id() const = 0;
+        // The state this one lives inside. Top level states return their own
+        // id
+        virtual IDType parent() const { return id(); }
+        // For states with children: which child to go into when something
+        // transitions here. States without children return their own id
+        virtual IDType initial_child(System &) { return id(); }
 
         // virtual destructor cuz c++
         virtual ~State() {}
     };
 
-    // Data that gets passed to the runner thread. Don't worry too much about
-    // this
-    using thread_data = std::pair<State *, StateMachine *>;
-
     /**
      * @brief Construct a state machine and immediatly start running it
-     * @param initial the state that the machine will begin in
+     * @param all_states one of every state the machine can be in. The machine
+     * owns these and reuses them for its whole life
+     * @param initial the state each region will begin in. Most machines only
+     * have one region so this is just `{Thing::Start}`
+     * @param executor if not null, run on this shared executor rather than
+     * on a task of our own
+     * @param priority priority among the other machines on the executor.
+     * Ignored if executor is null
+     * @param name what to call our task in the PeriodicTask registry.
+     * Ignored if executor is not null
+     */
+    StateMachine(const std::vector<State *> &all_states,
+                 std::initializer_list<IDType> initial,
+                 StateMachineExecutor *executor = nullptr, int priority = 0,
+                 const char *name = "state machine")
+        : initial_ids(initial) {
+        static_assert(!has_duplicate(System::transitions, num_transitions()),
+                      "A state has two transitions for the same message");
+        static_assert(!has_self_transition(System::transitions,
+                                           num_transitions()),
+                      "A state transitions to itself. Leave it out of the "
+                      "table to ignore that message");
+
+        for (State *st : all_states) {
+            size_t i = index_of(st->id());
+            if (i >= states.size()) {
+                states.resize(i + 1, nullptr);
+            }
+            if (states[i] != nullptr) {
+                printf("StateMachine: two states with the same id\n");
+            }
+            states[i] = st;
+        }
+        for (const Transition &t : System::transitions) {
+            if (state_for(t.from) == nullptr || state_for(t.to) == nullptr) {
+                printf("StateMachine: transition table uses a state that "
+                       "wasn't given to the constructor\n");
+            }
+        }
+        for (State *st : states) {
+            if (st != nullptr && state_for(st->parent()) == nullptr) {
+                printf("StateMachine: a state's parent wasn't given to the "
+                       "constructor\n");
+            }
+        }
+        dwell.resize(states.size());
+        entered_ms.resize(states.size(), 0);
+        active.resize(initial_ids.size(), nullptr);
+        internal.reserve(active.size() * max_depth);
+
+        if (executor != nullptr) {
+            this->executor = executor;
+            executor->add(this, priority);
+        } else {
+            runner = new PeriodicTask(name, delay_ms, 0, [this]() {
+                step(vex::timer::system());
+            });
+            runner->start();
+        }
+    }
+
+    /**
+     * @brief stop running. If a step is in progress this waits for it to
+     * finish
      */
-    StateMachine(State *initial)
-        : runner(thread_runner, new thread_data{initial, this}) {}
+    virtual ~StateMachine() {
+        if (executor != nullptr) {
+            executor->remove(this);
+        }
+        delete runner;
+    }
 
     /**
      * @brief retrieve the current state of the state machine. This is safe to
      * call from external threads
-     * @return the current state
+     * @param region which region to look at if the machine has more than one
+     * @return the current (innermost) state
      */
-    IDType current_state() const {
+    IDType current_state(size_t region = 0) const {
         mut.lock();
-        auto t = cur_type;
+        State *st = active[region];
+        auto t = st == nullptr ? initial_ids[region] : st->id();
         mut.unlock();
         return t;
     }
+
+    /**
+     * @brief check if the machine is in a state, or in a state inside of it,
+     * in any region. This is safe to call from external threads
+     * @param id the state to look for
+     * @return true if id is active
+     */
+    bool in_state(IDType id) const {
+        bool found = false;
+        mut.lock();
+        for (State *st : active) {
+            State *chain[max_depth];
+            size_t depth = chain_of(st, chain);
+            for (size_t i = 0; i < depth; i++) {
+                if (chain[i]->id() == id) {
+                    found = true;
+                }
+            }
+        }
+        mut.unlock();
+        return found;
+    }
+
     /**
      * @brief send a message to the state machine from outside
+     * This is safe to call from external threads and never blocks. Messages
+     * are handled in the order they are sent. States can call this too to
+     * talk to other regions
      * @param msg the message to send
-     * This is safe to call from external threads
+     * @return false if the queue was full and the message was dropped. The
+     * caller decides what to do about that (send it again later, give up...)
+     */
+    bool send_message(Message msg) {
+        if (!incoming.push(msg)) {
+            return false;
+        }
+        if (executor != nullptr) {
+            executor->notify();
+        }
+        return true;
+    }
+
+    /**
+     * @brief copy out the most recent transitions. Safe to call from external
+     * threads
+     * @param out where to put them, oldest first
+     * @param max how many fit in out
+     * @return how many were copied
      */
-    void send_message(Message msg) {
+    size_t get_trace(TraceEvent *out, size_t max) const {
         mut.lock();
-        incoming_msg = msg;
+        size_t n = trace_count < max ? trace_count : max;
+        // start n events back from the newest
+        size_t start = (trace_next + trace_len - n) % trace_len;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = trace[(start + i) % trace_len];
+        }
         mut.unlock();
+        return n;
     }
 
-  private:
-    vex::task runner;
-    mutable vex::mutex mut;
-    MaybeMessage incoming_msg;
-    IDType cur_type;
+    /**
+     * @brief get the dwell time histogram for one state. Safe to call from
+     * external threads
+     * @param state the state to look at
+     * @return the histogram (empty if the machine doesn't have that state)
+     */
+    DwellHistogram get_dwell(IDType state) const {
+        DwellHistogram h;
+        mut.lock();
+        size_t i = index_of(state);
+        if (i < dwell.size()) {
+            h = dwell[i];
+        }
+        mut.unlock();
+        return h;
+    }
 
     /**
-     * @brief the thread that does the running of the state machine.
-     * @param vptr the thread_data that we get passed to begin. cast it back
-     * @return return value of thread (the thread never ends so this doesn't
-     * really matter)
+     * @brief write the trace and every state's dwell histogram to a csv-ish
+     * file on the SD card. Slow, don't call this from a control loop or the
+     * screen task
+     * @param filename the file to write to (overwritten)
      */
-    static int thread_runner(void *vptr) {
-        thread_data *ptr = static_cast<thread_data *>(vptr);
-        State *cur_state = ptr->first;
+    void dump_trace(const std::string &filename) const {
+        TraceEvent events[trace_len];
+        size_t n = get_trace(events, trace_len);
 
-        StateMachine &sys = *ptr->second;
-        System &derived = *static_cast<System *>(&sys);
+        Logger log(filename);
+        log.Logln("time_ms,from,message,to,time_in_state_ms");
+        for (size_t i = 0; i < n; i++) {
+            const TraceEvent &e = events[i];
+            log.Logf("%lu,%s,%s,%s,%lu\n", (unsigned long)e.time_ms,
+                     to_string(e.from).c_str(), to_string(e.msg).c_str(),
+                     to_string(e.to).c_str(),
+                     (unsigned long)e.time_in_state_ms);
+        }
 
-        cur_state->entry(derived);
+        log.Logln("");
+        log.Logf("state,visits,mean_ms,max_ms");
+        // bucket b holds [2^(b-1), 2^b), the last one everything longer
+        for (int b = 0; b < DwellHistogram::num_buckets - 1; b++) {
+            log.Logf(",<%lu", (unsigned long)(1ul << b));
+        }
+        log.Logf(",>=%lu",
+                 (unsigned long)(1ul << (DwellHistogram::num_buckets - 2)));
+        log.Logln("");
+        for (size_t i = 0; i < states.size(); i++) {
+            if (states[i] == nullptr) {
+                continue;
+            }
+            DwellHistogram h = get_dwell(states[i]->id());
+            log.Logf("%s,%lu,%.1f,%lu", to_string(states[i]->id()).c_str(),
+                     (unsigned long)h.count, h.mean_ms(),
+                     (unsigned long)h.max_ms);
+            for (int b = 0; b < DwellHistogram::num_buckets; b++) {
+                log.Logf(",%lu", (unsigned long)h.buckets[b]);
+            }
+            log.Logln("");
+        }
+    }
+
+    /**
+     * @brief check if this machine needs to run. Used by
+     * StateMachineExecutor
+     */
+    bool ready(uint32_t now_ms) const override {
+        return !started || !incoming.empty() ||
+               (int32_t)(now_ms - next_work_ms) >= 0;
+    }
+    /**
+     * @return when work() is due next. Used by StateMachineExecutor
+     */
+    uint32_t next_due() const override { return next_work_ms; }
+
+    /**
+     * @brief run work() if it is due then respond to every waiting message.
+     * Used by StateMachineExecutor and our own task, don't call this yourself
+     * @param now_ms the current time from vex::timer::system()
+     */
+    void step(uint32_t now_ms) override {
+        System &derived = *static_cast<System *>(this);
 
-        sys.cur_type = cur_state->id();
+        if (!started) {
+            started = true;
+            next_work_ms = now_ms;
+            for (size_t r = 0; r < active.size(); r++) {
+                enter(r, nullptr, state_for(initial_ids[r]));
+            }
+        }
 
-        auto respond_to_message = [&](Message msg) {
-            if (do_log) {
-                printf("responding to msg: %s\n", to_string(msg).c_str());
-                fflush(stdout);
+        if ((int32_t)(now_ms - next_work_ms) >= 0) {
+            // stay on a fixed timeline unless we fell a whole period behind
+            next_work_ms += delay_ms;
+            if ((int32_t)(now_ms - next_work_ms) >= 0) {
+                next_work_ms = now_ms + delay_ms;
             }
 
-            State *next_state = cur_state->respond(derived, msg);
+            // Internal Messages passed. Collect them all before responding
+            // so one region's transition doesn't change who else gets to
+            // work this step. There's room for one from every work() call
+            internal.clear();
+            for (State *leaf : active) {
+                if (do_log) {
+                    printf("state: %s\n", to_string(leaf->id()).c_str());
+                }
+                State *chain[max_depth];
+                size_t depth = chain_of(leaf, chain);
+                // outermost first
+                for (size_t i = depth; i > 0; i--) {
+                    MaybeMessage m = chain[i - 1]->work(derived);
+                    if (m.has_message()) {
+                        internal.push_back(m.message());
+                    }
+                }
+            }
+            for (size_t i = 0; i < internal.size(); i++) {
+                respond_to_message(internal[i]);
+            }
+        }
 
-            if (cur_state != next_state) {
-                // switched states
-                sys.mut.lock();
+        // External Messages passed (and anything states sent while
+        // responding)
+        Message msg;
+        while (incoming.pop(msg)) {
+            respond_to_message(msg);
+        }
+    }
 
-                cur_state->exit(derived);
-                next_state->entry(derived);
+  private:
+    PeriodicTask *runner = nullptr; ///< our task if not on an executor
+    StateMachineExecutor *executor = nullptr; ///< the executor we run on
+    mutable vex::mutex mut;
+    MessageQueue<Message, queue_size> incoming;
+    std::vector<State *> states;      ///< every state, indexed by its id
+    std::vector<IDType> initial_ids;  ///< where each region starts
+    std::vector<State *> active;      ///< innermost state of each region
+    std::vector<uint32_t> entered_ms; ///< when each state was entered
+    std::vector<Message> internal;    ///< messages from work() this step
 
-                delete cur_state;
+    TraceEvent trace[trace_len];       ///< ring buffer of recent transitions
+    size_t trace_next = 0;             ///< where the next event goes
+    size_t trace_count = 0;            ///< how many events are valid
+    std::vector<DwellHistogram> dwell; ///< indexed by state id
+    bool started = false;
+    uint32_t next_work_ms = 0;
 
-                cur_state = next_state;
-                sys.cur_type = cur_state->id();
+    /**
+     * @brief give a message to every region and switch states in the ones
+     * that have a transition for it
+     * @param msg the message to respond to
+     */
+    void respond_to_message(Message msg) {
+        if (do_log) {
+            printf("responding to msg: %s\n", to_string(msg).c_str());
+            fflush(stdout);
+        }
 
-                sys.mut.unlock();
+        for (size_t r = 0; r < active.size(); r++) {
+            State *chain[max_depth];
+            size_t depth = chain_of(active[r], chain);
+            // innermost state gets first pick, then its parents
+            for (size_t i = 0; i < depth; i++) {
+                const Transition *t = find_transition(chain[i]->id(), msg);
+                if (t != nullptr) {
+                    transition(r, msg, state_for(t->to));
+                    break;
+                }
             }
-        };
+            // Ignore messages this region doesn't have a transition for
+        }
+    }
 
-        while (true) {
-            if (do_log) {
-                std::string str = to_string(cur_state->id());
-                std::string str2 = to_string(sys.cur_type);
+    /**
+     * @brief move one region to a new state, exiting and entering everything
+     * in between
+     * @param region the region that is moving
+     * @param msg the message that caused it (for the trace)
+     * @param target where the transition table says to go
+     */
+    void transition(size_t region, Message msg, State *target) {
+        System &derived = *static_cast<System *>(this);
+        State *from = active[region];
 
-                printf("state: %s %s\n", str.c_str(), str2.c_str());
+        State *from_chain[max_depth];
+        size_t from_depth = chain_of(from, from_chain);
+
+        // exit until we get to something the target is inside of
+        State *common = nullptr;
+        uint32_t now = vex::timer::system();
+        for (size_t i = 0; i < from_depth; i++) {
+            if (contains(from_chain[i], target)) {
+                common = from_chain[i];
+                break;
             }
+        }
+        if (common == from && initial_leaf(target) == from) {
+            // already there
+            return;
+        }
+        // before entering, which might enter `from` again and reset this
+        mut.lock();
+        uint32_t time_in_from = now - entered_ms[index_of(from->id())];
+        mut.unlock();
+        for (size_t i = 0; i < from_depth && from_chain[i] != common; i++) {
+            from_chain[i]->exit(derived);
+            mut.lock();
+            dwell[index_of(from_chain[i]->id())].add(
+                now - entered_ms[index_of(from_chain[i]->id())]);
+            mut.unlock();
+        }
+
+        State *to = enter(region, common, target);
+
+        mut.lock();
+        trace[trace_next] = {now, from->id(), msg, to->id(), time_in_from};
+        trace_next = (trace_next + 1) % trace_len;
+        if (trace_count < trace_len) {
+            trace_count++;
+        }
+        mut.unlock();
+    }
+
+    /**
+     * @brief enter target (and its parents below `above`), then keep going
+     * into initial children until we get to a state without any
+     * @param region the region we are entering in
+     * @param above a parent of target that we are already in (nullptr if
+     * none)
+     * @param target the state to enter
+     * @return the innermost state we ended up in
+     */
+    State *enter(size_t region, State *above, State *target) {
+        System &derived = *static_cast<System *>(this);
+
+        // outer states get entered before inner ones
+        State *chain[max_depth];
+        size_t depth = chain_of(target, chain);
+        size_t first = 0;
+        while (first < depth && chain[first] != above) {
+            first++;
+        }
+
+        State *cur = target;
+        for (size_t i = first; i > 0; i--) {
+            enter_one(chain[i - 1]);
+        }
+        // then dig down into children
+        State *child = state_for(cur->initial_child(derived));
+        while (child != nullptr && child != cur) {
+            enter_one(child);
+            cur = child;
+            child = state_for(cur->initial_child(derived));
+        }
+
+        mut.lock();
+        active[region] = cur;
+        mut.unlock();
+        return cur;
+    }
 
-            // Internal Message passed
-            MaybeMessage internal_msg = cur_state->work(derived);
+    void enter_one(State *st) {
+        System &derived = *static_cast<System *>(this);
+        mut.lock();
+        entered_ms[index_of(st->id())] = vex::timer::system();
+        mut.unlock();
+        st->entry(derived);
+    }
 
-            if (internal_msg.has_message()) {
-                respond_to_message(internal_msg.message());
+    /**
+     * @brief which state we would end up in if we transitioned to st
+     */
+    State *initial_leaf(State *st) {
+        System &derived = *static_cast<System *>(this);
+        for (size_t i = 0; i < max_depth; i++) {
+            State *child = state_for(st->initial_child(derived));
+            if (child == nullptr || child == st) {
+                break;
             }
+            st = child;
+        }
+        return st;
+    }
 
-            // External Message passed
-            sys.mut.lock();
-            MaybeMessage incoming = sys.incoming_msg;
-            sys.incoming_msg = {};
-            sys.mut.unlock();
+    /**
+     * @brief list st and every state it is inside of
+     * @param st the innermost state
+     * @param chain where to put them, st first and the top level state last
+     * @return how many were put in chain
+     */
+    size_t chain_of(State *st, State *(&chain)[max_depth]) const {
+        size_t depth = 0;
+        while (st != nullptr && depth < max_depth) {
+            chain[depth++] = st;
+            State *parent = state_for(st->parent());
+            if (parent == st) {
+                break;
+            }
+            st = parent;
+        }
+        return depth;
+    }
 
-            if (incoming.has_message()) {
-                respond_to_message(incoming.message());
+    /// @return true if inner is outer or is somewhere inside of it
+    bool contains(State *outer, State *inner) const {
+        State *chain[max_depth];
+        size_t depth = chain_of(inner, chain);
+        for (size_t i = 0; i < depth; i++) {
+            if (chain[i] == outer) {
+                return true;
             }
+        }
+        return false;
+    }
 
-            vexDelay(delay_ms);
+    static const Transition *find_transition(IDType from, Message msg) {
+        for (const Transition &t : System::transitions) {
+            if (t.from == from && t.on == msg) {
+                return &t;
+            }
         }
-        return 0;
+        return nullptr;
+    }
+
+    static constexpr size_t num_transitions() {
+        return sizeof(System::transitions) / sizeof(Transition);
+    }
+    static size_t index_of(IDType id) { return static_cast<size_t>(id); }
+    State *state_for(IDType id) const {
+        size_t i = index_of(id);
+        return i < states.size() ? states[i] : nullptr;
+    }
+
+    // Compile time checks on the transition table. These are recursive
+    // because constexpr functions can only be a single return in c++11
+
+    /// @return true if any transition after i has the same from and on as i
+    static constexpr bool matches_later(const Transition *t, size_t n,
+                                        size_t i, size_t j) {
+        return j >= n ? false
+                      : (t[i].from == t[j].from && t[i].on == t[j].on) ||
+                            matches_later(t, n, i, j + 1);
+    }
+    /// @return true if two transitions leave the same state on the same
+    /// message
+    static constexpr bool has_duplicate(const Transition *t, size_t n,
+                                        size_t i = 0) {
+        return i >= n ? false
+                      : matches_later(t, n, i, i + 1) ||
+                            has_duplicate(t, n, i + 1);
+    }
+    /// @return true if a transition goes from a state to that same state
+    static constexpr bool has_self_transition(const Transition *t, size_t n,
+                                              size_t i = 0) {
+        return i >= n ? false
+                      : t[i].from == t[i].to ||
+                            has_self_transition(t, n, i + 1);
     }
 };
@@ -2,6 +2,7 @@
 #include "../core/include/utils/controls/feedforward.h"
 #include "../core/include/utils/controls/pid.h"
 #include "../core/include/utils/math_util.h"
+#include "../core/include/utils/battery_compensation.h"
 #include "../core/include/subsystems/screen.h"
 #include "../core/include/utils/graph_drawer.h"
 #include "vex.h"
@@ -14,7 +15,10 @@ using namespace vex;
 
 Flywheel::Flywheel(motor_group &motors, Feedback &feedback, FeedForward &helper, const double ratio, Filter &filt) : motors(motors),
                                                                                                                      task_running(false), fb(feedback), ff(helper),
-                                                                                                                     ratio(ratio), avger(filt) {}
+                                                                                                                     ratio(ratio),
+                                                                                                                     rpm_task("flywheel", flywheel_period_ms, flywheel_budget_us, [this]()
+                                                                                                                              { spinRPMTask(this); }),
+                                                                                                                     avger(filt) {}
 
 /**
  * Return the current value that the target_rpm should be set to
@@ -33,41 +37,86 @@ motor_group &Flywheel::get_motors() const { return motors; }
 double Flywheel::measure_RPM()
 {
   double rawRPM = ratio * motors.velocity(velocityUnits::rpm);
+  if (observer != nullptr)
+  {
+    double dt = obs_tmr.value();
+    obs_tmr.reset();
+    return observer->update(rawRPM, last_output, dt);
+  }
   avger.add_entry(rawRPM);
   return avger.get_value();
 }
 
 double Flywheel::getRPM() const
 {
+  if (observer != nullptr)
+    return observer->get_rpm();
   return avger.get_value();
 }
 
+void Flywheel::set_observer(FlywheelObserver *obs)
+{
+  fb_mut.lock();
+  observer = obs;
+  if (observer != nullptr)
+  {
+    observer->reset(ratio * motors.velocity(velocityUnits::rpm));
+    obs_tmr.reset();
+  }
+  fb_mut.unlock();
+}
+
+void Flywheel::set_ff_estimator(FeedForwardEstimator *est, FeedForward::ff_config_t *cfg)
+{
+  fb_mut.lock();
+  ff_est = est;
+  ff_cfg = cfg;
+  est_last_rpm = getRPM();
+  est_tmr.reset();
+  fb_mut.unlock();
+}
+
 /**
- * Runs a thread that keeps track of updating flywheel RPM and controlling it accordingly
+ * One update of the RPM controller. Run every flywheel_period_ms by rpm_task
+ * while the flywheel is spinning at an RPM
  */
 int spinRPMTask(void *wheelPointer)
 {
   Flywheel &wheel = *(Flywheel *)wheelPointer;
 
   // get the pid from the wheel and set its target to the RPM stored in the wheel.
-  while (true)
-  {
-    double rpm = wheel.measure_RPM();
+  double rpm = wheel.measure_RPM();
 
-    if (wheel.target_rpm != 0)
+  if (wheel.target_rpm != 0)
+  {
+    double output = wheel.ff.calculate(wheel.target_rpm, 0.0, 0.0);
     {
-      double output = wheel.ff.calculate(wheel.target_rpm, 0.0, 0.0);
-      {
-        wheel.fb_mut.lock();
-        wheel.fb.update(rpm); // check the current velocity and update the PID with it.
+      wheel.fb_mut.lock();
+      wheel.fb.update(rpm); // check the current velocity and update the PID with it.
+
+      output += wheel.fb.get();
+      wheel.fb_mut.unlock();
+    }
 
-        output += wheel.fb.get();
-        wheel.fb_mut.unlock();
-      }
+    // Get back up to speed quicker after a shot
+    if (wheel.observer != nullptr)
+      output += wheel.observer->get_boost();
 
-      wheel.spin_raw(output, fwd); // set the motors to whatever feedforward tells them to do
+    wheel.spin_raw(output, fwd); // set the motors to whatever feedforward tells them to do
+
+    // Learn the feedforward from what we just did
+    wheel.fb_mut.lock();
+    if (wheel.ff_est != nullptr)
+    {
+      double dt = wheel.est_tmr.value();
+      wheel.est_tmr.reset();
+      double accel = dt > 0 ? (rpm - wheel.est_last_rpm) / dt : 0.0;
+      wheel.est_last_rpm = rpm;
+      wheel.ff_est->add_sample(wheel.last_output, rpm, accel);
+      if (wheel.ff_cfg != nullptr)
+        wheel.ff_est->apply(*wheel.ff_cfg);
     }
-    vexDelay(5);
+    wheel.fb_mut.unlock();
   }
   return 0;
 }
@@ -84,7 +133,11 @@ int spinRPMTask(void *wheelPointer)
  */
 void Flywheel::spin_raw(double speed, directionType dir)
 {
-  motors.spin(dir, speed * 12, voltageUnits::volt);
+  last_output = (dir == fwd) ? speed : -speed;
+  double volts = speed * 12;
+  if (compensate_battery)
+    volts = BatteryCompensation::compensate(volts);
+  motors.spin(dir, volts, voltageUnits::volt);
 }
 
 /**
@@ -96,7 +149,7 @@ void Flywheel::spin_raw(double speed, directionType dir)
 void Flywheel::spin_manual(double speed, directionType dir)
 {
   if (!task_running) {
-    motors.spin(dir, speed * 12, voltageUnits::volt);
+    spin_raw(speed, dir);
 }
 }
 
@@ -115,7 +168,7 @@ void Flywheel::spin_rpm(double input_rpm)
   // only run if the RPM is different or it isn't already running
   if (!task_running)
   {
-    rpm_task = task(spinRPMTask, this);
+    rpm_task.start();
     task_running = true;
   }
   // now that its running, set the target
@@ -139,6 +192,7 @@ void Flywheel::stop()
     task_running = false;
     rpm_task.stop();
     target_rpm = 0.0;
+    last_output = 0;
     motors.stop();
   }
 }
@@ -152,8 +206,14 @@ public:
   FlywheelPage(const Flywheel &fw) : fw(fw), gd(GraphDrawer(window_size, 0.0, 0.0, {vex::color(255, 0, 0), vex::color(0, 255, 0), vex::color(0, 0, 255)}, 3)), avg_err(window_size) {}
   /// @brief @see Page#update
   void update(bool, int, int) override {}
+  /// @brief samples are taken when drawing, nothing to do while hidden
+  bool updates_in_background() const override { return false; }
+  /// @brief the graph's history
+  size_t heavy_bytes() const override { return gd.memory_bytes(); }
+  /// @brief forget the graph's history
+  void unload() override { gd.release(); }
   /// @brief @see Page#draw
-  void draw(vex::brain::lcd &screen, bool,
+  void draw(screen::Canvas &screen, bool,
             unsigned int) override
   {
 
@@ -172,6 +232,8 @@ public:
     screen.printAt(50, 90, "stddev: %.2f", avg_err.get_value());
     screen.printAt(50, 150, "temp: %.2fc", fw.get_motors().temperature(vex::celsius));
     screen.printAt(50, 180, "volt: %.2fv", volts);
+    if (fw.observer != nullptr)
+      screen.printAt(50, 210, "shots: %d", fw.observer->shots());
   }
 
 private:
@@ -1,25 +1,95 @@
+// pl_mpeg's packet buffers only ever hold a few packets at once here, and
+// grow if one doesn't fit. Must be defined before pl_mpeg.h is first included
+#define PLM_BUFFER_DEFAULT_SIZE (16 * 1024)
+
 #include "../core/include/subsystems/fun/video.h"
+#include "../core/include/subsystems/fun/video_frames.h"
+#include <atomic>
 #include <cstdint>
 
 #define PL_MPEG_IMPLEMENTATION
 #include "../core/include/subsystems/fun/pl_mpeg.h"
+#include "../core/include/utils/periodic_task.h"
 
-static uint8_t buf[358400];
-
-enum VideoState { DoesntExist, TooBig, DidntReadRight, Ok, NeverInitialized };
+enum VideoState { DoesntExist, DidntReadRight, Ok, NeverInitialized, Loading };
 
-static vex::task video_task;
-static VideoState state = VideoState::NeverInitialized;
+static std::atomic<VideoState> state(VideoState::NeverInitialized);
+/// only changed with both video_mut and frames_mut held
 static std::string name = "";
-static uint8_t *argb_buffer;
 static int w;
 static int h;
 static int x;
 static int y;
-static bool frame_ready = false;
 static plm_t *plm;
+
+// Triple buffer between the decoder and the screen. The decoder owns
+// `back`, the screen owns `front`, and the third buffer is handed between
+// them by swapping its index through `middle`. Neither side ever waits on
+// the other, and the screen always gets the newest complete frame
+static const int fresh_bit = 4; ///< set in middle when it holds a new frame
+static const int index_mask = 3;
+static uint8_t *argb_buffers[3] = {nullptr, nullptr, nullptr};
+static std::atomic<int> middle(1);
+static int back = 0;  ///< only touched by the decoder
+static int front = 2; ///< only touched by the screen
+/// held by the screen while it draws from argb_buffers, and by whoever frees
+/// or reallocates them. The decoder doesn't take it, it is always stopped
+/// (and waited for) before the buffers change
+static vex::mutex frames_mut;
+
+// The file is streamed off the SD card instead of loaded whole. A low
+// priority task reads it ahead a chunk at a time into `ring`, and pl_mpeg
+// pulls from the ring when it needs more. head and tail count every byte
+// ever written and read, so head - tail is how full it is. The reader only
+// moves head, the decoder only moves tail
+static const uint32_t ring_size = 32 * 1024;
+static const uint32_t chunk_size = 4 * 1024;
+static uint8_t ring[ring_size];
+static std::atomic<uint32_t> ring_head(0);
+static std::atomic<uint32_t> ring_tail(0);
+static std::atomic<bool> file_done(false);
+/// set by the decoder to have the reader start the file over. The decoder
+/// doesn't touch the ring until the reader clears it
+static std::atomic<bool> rewind_pending(false);
+/// set when pl_mpeg has been told the stream ended, so it has rewound itself
+static bool stream_ended = false;
+/// set by close_video() so the decoder stops waiting on the reader
+static std::atomic<bool> closing(false);
+static FIL *video_file = nullptr;
+/// the player's page unloaded the video, it loads it again when shown
+static std::atomic<bool> unloaded(false);
+/// held while a video is opened or closed, so set_video() from the user and
+/// the page's loader take turns
+static vex::mutex video_mut;
+/// true while load_task is opening the video again
+static std::atomic<bool> loading(false);
+static vex::task load_task;
+/// how long pl_mpeg will wait for the reader before giving up on a read
+static const uint32_t max_wait_ms = 50;
+const int32_t video_reader_priority = 1;
+const uint32_t video_reader_ms = 10;
+const uint32_t video_reader_budget_us = 5000;
+
+// stats, written by the decoder
+static std::atomic<uint32_t> underruns(0);
+static std::atomic<uint32_t> frames_decoded(0);
+static std::atomic<uint32_t> frames_dropped(0);
+static std::atomic<uint32_t> last_decode_us(0);
+static std::atomic<uint32_t> avg_decode_us(0);
+// written by the screen
+static uint32_t frames_shown = 0;
 const int32_t video_player_priority = 2;
-static int32_t file_size = 0;
+/// how often the decoder checks whether a frame is due
+const uint32_t video_tick_ms = 5;
+const uint32_t video_budget_us = 20000;
+/// frames in a row that may be skipped to catch up before one is shown anyway
+const uint32_t max_skips = 4;
+/// further behind than this and the clock is reset instead of catching up
+const uint64_t max_lag_us = 500000;
+
+// when frames are due, set to the file's frame rate when it's opened
+static FramePacer pacer(33333, max_skips, max_lag_us);
+static std::atomic<uint32_t> frames_skipped(0);
 static bool should_restart = false;
 
 void video_restart(){
@@ -27,14 +97,11 @@ void video_restart(){
 }
 
 
-void explain_error(vex::brain::lcd &screen) {
+void explain_error(screen::Canvas &screen) {
     switch (state) {
     case DoesntExist:
         screen.printAt(40, 30, true, "Couldn't find video %s", name.c_str());
         break;
-    case TooBig:
-        screen.printAt(40, 30, true, "%s was too big to open", name.c_str());
-        break;
     case DidntReadRight:
         screen.printAt(40, 30, true,
                        "%s wasnt read correctly. Are you sure its mpeg1",
@@ -44,88 +111,343 @@ void explain_error(vex::brain::lcd &screen) {
         screen.printAt(40, 30, true,
                        "no video loaded. did you forget set_video()");
         break;
+    case Loading:
+        screen.printAt(40, 30, true, "loading %s", name.c_str());
+        break;
 
     default:
         break;
     }
 }
 
-int video_player() {
-    if (state != Ok) {
-        return 1;
+/**
+ * @brief read up to max_chunks more of the file into the ring. Only called by
+ * the reader (and set_video before the reader starts)
+ */
+static void fill_ring(int max_chunks) {
+    if (rewind_pending) {
+        vexFileSeek(video_file, 0, SEEK_SET);
+        ring_head = ring_tail.load();
+        file_done = false;
+        rewind_pending = false;
+    }
+    for (int i = 0; i < max_chunks && !file_done; i++) {
+        uint32_t head = ring_head;
+        uint32_t space = ring_size - (head - ring_tail);
+        if (space < chunk_size) {
+            return;
+        }
+        // ring_size is a multiple of chunk_size, so a chunk never wraps
+        uint32_t at = head % ring_size;
+        int32_t got = vexFileRead((char *)ring + at, 1, chunk_size, video_file);
+        if (got <= 0) {
+            file_done = true;
+            return;
+        }
+        ring_head = head + got;
     }
-    plm_frame_t *frame = NULL;
-    while (true) {
-        for (int i = 1; frame = plm_decode_video(plm); i++) {
+}
 
-            uint32_t start_ms = vex::timer::system();
+/// read ahead. Run every video_reader_ms by reader_task
+static void video_reader() {
+    if (video_file != nullptr) {
+        fill_ring(2);
+    }
+}
 
-            frame_ready = false;
-            plm_frame_to_bgra(frame, argb_buffer, w * 4);
-            frame_ready = true;
-            uint32_t elapsed_ms = vex::timer::system() - start_ms;
+/**
+ * @brief pl_mpeg's load callback: move whatever the reader has ready into
+ * pl_mpeg's buffer. Waits a little for the reader if there's nothing yet
+ */
+static void load_from_ring(plm_buffer_t *self, void *user) {
+    PLM_UNUSED(user);
+    // Not while pl_mpeg is looking ahead for the next picture, it goes back
+    // to where it was after and the bytes have to still be there
+    if (self->discard_read_bytes) {
+        plm_buffer_discard_read_bytes(self);
+    }
 
-            vexDelay(33 - elapsed_ms);
-            if (should_restart){
-                should_restart = false;
-                break;
-            }
+    for (uint32_t waited = 0;; waited++) {
+        bool done = file_done;
+        uint32_t tail = ring_tail;
+        uint32_t avail = ring_head - tail;
+        if (avail > 0) {
+            uint32_t n = self->capacity - self->length;
+            n = avail < n ? avail : n;
+            uint32_t at = tail % ring_size;
+            uint32_t first = ring_size - at < n ? ring_size - at : n;
+            memcpy(self->bytes + self->length, ring + at, first);
+            memcpy(self->bytes + self->length + first, ring, n - first);
+            self->length += n;
+            ring_tail = tail + n;
+            return;
+        }
+        if (done) {
+            self->has_ended = TRUE;
+            stream_ended = true;
+            return;
+        }
+        if (closing) {
+            return;
         }
+        if (waited >= max_wait_ms) {
+            underruns++;
+            return;
+        }
+        vexDelay(1);
+    }
+}
+
+/**
+ * decode and convert the next frame if it's due. Run every video_tick_ms by
+ * video_task. When decoding falls behind, frames are still decoded (later
+ * frames depend on them) but not converted or shown until it catches up
+ */
+void video_player() {
+    if (state != Ok) {
+        return;
+    }
+    if (should_restart) {
+        should_restart = false;
         plm_rewind(plm);
+        rewind_pending = true;
     }
-    return 0;
+    // wait for the reader to start the file over
+    if (rewind_pending) {
+        pacer.restart(vex::timer::systemHighResolution());
+        return;
+    }
+
+    uint64_t start_us = vex::timer::systemHighResolution();
+    if (!pacer.due(start_us)) {
+        return;
+    }
+
+    plm_frame_t *frame = plm_decode_video(plm);
+    if (frame == NULL) {
+        // pl_mpeg loops by rewinding itself at the end. Have the reader
+        // start the file over to match
+        if (stream_ended) {
+            stream_ended = false;
+            rewind_pending = true;
+        }
+        return;
+    }
+    if (!pacer.decoded(vex::timer::systemHighResolution())) {
+        frames_skipped++;
+        return;
+    }
+
+    frame_to_bgra_fast(frame, argb_buffers[back], w * 4);
+
+    // Publish the finished frame and take whatever was in the middle to
+    // decode into next. If that still had the fresh bit, the screen never
+    // got to it
+    int old = middle.exchange(back | fresh_bit);
+    back = old & index_mask;
+    if (old & fresh_bit) {
+        frames_dropped++;
+    }
+    frames_decoded++;
+
+    uint32_t took = (uint32_t)(vex::timer::systemHighResolution() - start_us);
+    last_decode_us = took;
+    uint32_t avg = avg_decode_us;
+    avg_decode_us = avg == 0 ? took : (9 * avg + took) / 10;
 }
 
-void set_video(const std::string &filename) {
+/// @brief swap in the newest frame if there is one. Screen thread only
+/// @return true if front changed
+static bool take_frame() {
+    if (!(middle.load() & fresh_bit)) {
+        return false;
+    }
+    front = middle.exchange(front) & index_mask;
+    frames_shown++;
+    return true;
+}
+
+video_stats_t video_stats() {
+    return video_stats_t{frames_decoded, frames_dropped, frames_skipped,
+                         frames_shown, underruns, last_decode_us / 1000.0,
+                         avg_decode_us / 1000.0};
+}
+
+static PeriodicTask video_task("video", video_tick_ms, video_budget_us,
+                               video_player, video_player_priority);
+static PeriodicTask reader_task("video reader", video_reader_ms,
+                                video_reader_budget_us, video_reader,
+                                video_reader_priority);
+
+/// @brief stop playing, then close the file and decoder and free the frames
+static void close_video() {
+    state = NeverInitialized;
+    // stop() waits for each loop to exit. The decoder goes first: it may be
+    // waiting on the reader, and the reader must not be stopped under it
+    closing = true;
+    video_task.stop();
+    reader_task.stop();
+    closing = false;
+
+    // Neither task is running now, nothing but the screen can touch these
+    frames_mut.lock();
+    for (int i = 0; i < 3; i++) {
+        delete[] argb_buffers[i];
+        argb_buffers[i] = nullptr;
+    }
+    frames_mut.unlock();
+    if (plm != nullptr) {
+        plm_destroy(plm);
+        plm = nullptr;
+    }
+    if (video_file != nullptr) {
+        vexFileClose(video_file);
+        video_file = nullptr;
+    }
+}
+
+/// @brief close the last video and open filename. Called with video_mut held
+static void open_video(const std::string &filename) {
     vex::brain Brain;
-    const char *fname = filename.c_str();
+
+    // Put away the last video. This waits for the decoder and reader to stop
+    close_video();
+    unloaded = false;
+    frames_mut.lock();
+    name = filename;
+    frames_mut.unlock();
+    const char *fname = name.c_str();
 
     if (!Brain.SDcard.exists(fname)) {
         state = DoesntExist;
         return;
     }
-    file_size = Brain.SDcard.size(fname);
-    if (file_size > sizeof(buf)) {
-        state = TooBig;
+    video_file = vexFileOpen(fname, "rb");
+    if (video_file == nullptr) {
+        state = DoesntExist;
         return;
     }
-    const int32_t read = Brain.SDcard.loadfile(fname, buf, sizeof(buf));
 
-    if (read != file_size) {
-        state = DidntReadRight;
-        return;
-    }
-    plm = plm_create_with_memory(buf, file_size, 0);
+    // Start with one chunk, the reader gets the rest while this plays
+    ring_head = 0;
+    ring_tail = 0;
+    file_done = false;
+    rewind_pending = false;
+    stream_ended = false;
+    fill_ring(1);
+    reader_task.start();
+
+    plm_buffer_t *source = plm_buffer_create_with_capacity(chunk_size * 2);
+    plm_buffer_set_load_callback(source, load_from_ring, NULL);
+    plm = plm_create_with_buffer(source, TRUE);
 
     plm_set_audio_enabled(plm, false);
     plm_set_loop(plm, true);
 
     w = plm_get_width(plm);
     h = plm_get_height(plm);
+    if (w <= 0 || h <= 0) {
+        state = DidntReadRight;
+        reader_task.stop();
+        return;
+    }
     int render_buf_len = w * h * 4;
     x = (480 - w) / 2;
     y = (200 - h) / 2;
-    argb_buffer = new uint8_t[render_buf_len];
+    double fps = plm_get_framerate(plm);
+    pacer.set_frame_us(fps > 0 ? (uint64_t)(1000000 / fps) : 33333);
+    init_convert_tables();
+    // close_video() freed the old ones after the decoder stopped. The
+    // screen may be looking at the pointers
+    frames_mut.lock();
+    for (int i = 0; i < 3; i++) {
+        argb_buffers[i] = new uint8_t[render_buf_len]();
+    }
+    middle = 1;
+    back = 0;
+    front = 2;
+    frames_mut.unlock();
     state = Ok;
-    name = fname;
-    video_task = vex::task(video_player, video_player_priority);
+    pacer.restart(vex::timer::systemHighResolution());
+    video_task.start();
+}
+
+void set_video(const std::string &filename) {
+    video_mut.lock();
+    open_video(filename);
+    video_mut.unlock();
+}
+
+/// @brief open the unloaded video again. Runs on load_task
+static int load_thread(void *) {
+    video_mut.lock();
+    if (unloaded) {
+        std::string again = name;
+        open_video(again);
+    }
+    video_mut.unlock();
+    loading = false;
+    return 0;
 }
 
 VideoPlayer::VideoPlayer() {}
-void VideoPlayer::update(bool was_pressed, int x, int y) {}
+void VideoPlayer::update(bool was_pressed, int x, int y) {
+    // Only redraw when the decoder has finished a new frame
+    if (state == Ok && (middle.load() & fresh_bit)) {
+        invalidate();
+    }
+}
+
+void VideoPlayer::on_enter() {
+    // Opening the file and reading the headers takes a while, don't hold up
+    // the screen for it. The page says it's loading until the first frame
+    if (unloaded && !loading.exchange(true)) {
+        // unless a set_video() got there first
+        VideoState closed = NeverInitialized;
+        state.compare_exchange_strong(closed, Loading);
+        load_task = vex::task(load_thread, nullptr);
+    }
+}
+
+size_t VideoPlayer::heavy_bytes() const {
+    if (state != Ok) {
+        return 0;
+    }
+    // the three argb buffers, pl_mpeg's three YCbCr frames and its packet
+    // buffer
+    return (size_t)w * h * 4 * 3 + (size_t)w * h * 3 / 2 * 3 + chunk_size * 2;
+}
 
-void VideoPlayer::draw(vex::brain::lcd &screen, bool first_draw,
+void VideoPlayer::unload() {
+    // Someone else is opening or closing a video, try again next time
+    if (!video_mut.try_lock()) {
+        return;
+    }
+    if (state == Ok) {
+        // waits for the decoder and reader to stop before freeing anything
+        close_video();
+        unloaded = true;
+    }
+    video_mut.unlock();
+}
+
+void VideoPlayer::draw(screen::Canvas &screen, bool first_draw,
                        unsigned int frame_number) {
+    frames_mut.lock();
     if (state != Ok) {
         explain_error(screen);
+        frames_mut.unlock();
         return;
     }
-    // nothin bad ever happened with a spin lock
-    for (int i = 0; i < 5; i++){
-        if (frame_ready){
-            break;
-        }
-        vexDelay(1);
-    }
-    screen.drawImageFromBuffer((uint32_t *)argb_buffer, x, y, w, h);
+    take_frame();
+    screen.drawImageFromBuffer((uint32_t *)argb_buffers[front], x, y, w, h);
+    frames_mut.unlock();
+
+    video_stats_t st = video_stats();
+    screen.setPenColor(vex::color(120, 120, 120));
+    screen.printAt(45, 230, false,
+                   "decode %.1fms (avg %.1f) skip %lu drop %lu/%lu under %lu",
+                   st.last_decode_ms, st.avg_decode_ms,
+                   (unsigned long)st.skipped, (unsigned long)st.dropped,
+                   (unsigned long)st.decoded, (unsigned long)st.underruns);
 }
\ No newline at end of file
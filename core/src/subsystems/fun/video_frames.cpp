@@ -0,0 +1,93 @@
+#include "../core/include/subsystems/fun/video_frames.h"
+
+/**
+ * Lookup tables for YCbCr -> BGRA, same math as pl_mpeg's plm_frame_to_bgra
+ * without the per pixel multiplies and clamp branches. Luma is scaled by
+ * table, the chroma terms are worked out once per 2x2 block of pixels, and
+ * each pixel is packed into one 32 bit word with one store
+ */
+static const int clamp_offset = 320;
+static uint8_t clamp_tab[clamp_offset * 2 + 256];
+static int16_t luma_tab[256];
+
+void init_convert_tables() {
+    for (int i = 0; i < (int)sizeof(clamp_tab); i++) {
+        int v = i - clamp_offset;
+        clamp_tab[i] = v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+    for (int i = 0; i < 256; i++) {
+        luma_tab[i] = ((i - 16) * 76309) >> 16;
+    }
+}
+
+void frame_to_bgra_fast(plm_frame_t *frame, uint8_t *dest, int stride) {
+    const uint8_t *clamp = clamp_tab + clamp_offset;
+    int cols = frame->width >> 1;
+    int rows = frame->height >> 1;
+    int yw = frame->y.width;
+    int cw = frame->cb.width;
+    int dw = stride / 4;
+
+    for (int row = 0; row < rows; row++) {
+        const uint8_t *y0 = frame->y.data + row * 2 * yw;
+        const uint8_t *y1 = y0 + yw;
+        const uint8_t *cb_row = frame->cb.data + row * cw;
+        const uint8_t *cr_row = frame->cr.data + row * cw;
+        uint32_t *d0 = (uint32_t *)dest + row * 2 * dw;
+        uint32_t *d1 = d0 + dw;
+
+        for (int col = 0; col < cols; col++) {
+            int cr = cr_row[col] - 128;
+            int cb = cb_row[col] - 128;
+            const uint8_t *r = clamp + ((cr * 104597) >> 16);
+            const uint8_t *g = clamp - ((cb * 25674 + cr * 53278) >> 16);
+            const uint8_t *b = clamp + ((cb * 132201) >> 16);
+
+            int ya = luma_tab[y0[0]], yb = luma_tab[y0[1]];
+            int yc = luma_tab[y1[0]], yd = luma_tab[y1[1]];
+            d0[0] = (r[ya] << 16) | (g[ya] << 8) | b[ya];
+            d0[1] = (r[yb] << 16) | (g[yb] << 8) | b[yb];
+            d1[0] = (r[yc] << 16) | (g[yc] << 8) | b[yc];
+            d1[1] = (r[yd] << 16) | (g[yd] << 8) | b[yd];
+
+            y0 += 2;
+            y1 += 2;
+            d0 += 2;
+            d1 += 2;
+        }
+    }
+}
+
+FramePacer::FramePacer(uint64_t frame_us, uint32_t max_skips,
+                       uint64_t max_lag_us)
+    : frame_us(frame_us), max_skips(max_skips), max_lag_us(max_lag_us) {}
+
+void FramePacer::restart(uint64_t now_us) {
+    start_us = now_us;
+    frame_index = 0;
+    skips_in_row = 0;
+}
+
+bool FramePacer::due(uint64_t now_us) {
+    due_us = start_us + frame_index * frame_us;
+    if (now_us < due_us) {
+        return false;
+    }
+    if (now_us - due_us > max_lag_us) {
+        // too far behind to catch up, start timing again
+        restart(now_us);
+        due_us = now_us;
+    }
+    return true;
+}
+
+bool FramePacer::decoded(uint64_t now_us) {
+    frame_index++;
+    // Already time for the next one, don't bother showing this one
+    if (now_us >= due_us + frame_us && skips_in_row < max_skips) {
+        skips_in_row++;
+        return false;
+    }
+    skips_in_row = 0;
+    return true;
+}
@@ -9,13 +9,16 @@
 OdometryBase::OdometryBase(bool is_async) : current_pos(zero_pos)
 {
   if (is_async) {
-    handle = new vex::task(background_task, (void *)this);
-}
+    // Wait a second for the sensors to settle before the first update
+    handle = new PeriodicTask("odometry", odometry_period_ms, odometry_budget_us,
+                              [this]() { background_task(this); });
+    handle->start(1000);
+  }
 }
 
 /**
- * Function that runs in the background task. This function pointer is passed
- * to the vex::task constructor.
+ * One background update. Run every odometry_period_ms by the background
+ * PeriodicTask.
  *
  * @param ptr Pointer to OdometryBase object
  * @return Required integer return code. Unused.
@@ -23,13 +26,13 @@ OdometryBase::OdometryBase(bool is_async) : current_pos(zero_pos)
 int OdometryBase::background_task(void *ptr)
 {
   OdometryBase &obj = *((OdometryBase *)ptr);
-  vexDelay(1000);
-  while (!obj.end_task)
+  if (obj.end_task)
   {
-    obj.mut.lock();
-    obj.update();
-    obj.mut.unlock();
+    return 0;
   }
+  obj.mut.lock();
+  obj.update();
+  obj.mut.unlock();
 
   return 0;
 }
@@ -42,6 +45,10 @@ int OdometryBase::background_task(void *ptr)
 void OdometryBase::end_async()
 {
   this->end_task = true;
+  if (handle != nullptr)
+  {
+    handle->stop();
+  }
 }
 
 /**
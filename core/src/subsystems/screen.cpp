@@ -1,25 +1,237 @@
 #include "../core/include/subsystems/screen.h"
 #include "../core/include/utils/math_util.h"
+#include "../core/include/utils/message_queue.h"
+#include "../core/include/utils/periodic_task.h"
 namespace screen {
-void draw_label(vex::brain::lcd &scr, std::string lbl, ScreenRect rect) {
+void draw_label(Canvas &scr, std::string lbl, ScreenRect rect) {
     uint32_t height = scr.getStringHeight(lbl.c_str());
     scr.printAt(rect.x1 + 1, rect.y1 + height, true, "%s", lbl.c_str());
 }
-void draw_widget(vex::brain::lcd &scr, WidgetConfig &widget, ScreenRect rect) {
+
+static Rect to_rect(ScreenRect r) {
+    return Rect{{(double)r.x1, (double)r.y1}, {(double)r.x2, (double)r.y2}};
+}
+
+static bool contains(ScreenRect r, int x, int y) {
+    return x >= (int)r.x1 && x < (int)r.x2 && y >= (int)r.y1 && y < (int)r.y2;
+}
+
+WidgetPage::WidgetPage(WidgetConfig &cfg) : base_widget(cfg) { relayout(); }
+
+void WidgetPage::relayout() {
+    nodes.clear();
+    grabbed = -1;
+    layout(base_widget, page_area);
+    invalidate();
+}
+
+/**
+ * Split rect between the children of a Row or Col by their sizes, or make a
+ * Node for anything else
+ */
+void WidgetPage::layout(WidgetConfig &widget, ScreenRect rect) {
+    const uint32_t gap = 2;
+    if (widget.type == WidgetConfig::Col || widget.type == WidgetConfig::Row) {
+        bool col = widget.type == WidgetConfig::Col;
+        int total = 0;
+        for (SizedWidget &sw : widget.widgets) {
+            total += sw.size > 0 ? sw.size : 1;
+        }
+        if (total == 0) {
+            return;
+        }
+        uint32_t start = col ? rect.y1 : rect.x1;
+        uint32_t length = col ? rect.y2 - rect.y1 : rect.x2 - rect.x1;
+        int before = 0;
+        for (SizedWidget &sw : widget.widgets) {
+            int size = sw.size > 0 ? sw.size : 1;
+            uint32_t from = start + length * before / total;
+            uint32_t to = start + length * (before + size) / total;
+            before += size;
+            // leave a gap between neighbours
+            if (to - from > gap) {
+                to -= gap;
+            }
+            ScreenRect child = col ? ScreenRect{rect.x1, from, rect.x2, to}
+                                   : ScreenRect{from, rect.y1, to, rect.y2};
+            layout(sw.widget, child);
+        }
+        return;
+    }
+
+    Node node;
+    node.cfg = &widget;
+    node.rect = rect;
     switch (widget.type) {
-    case WidgetConfig::Type::Col:
-    case WidgetConfig::Type::Row:
-    case WidgetConfig::Type::Slider:
-    case WidgetConfig::Type::Button:
-    case WidgetConfig::Type::Checkbox:
-    case WidgetConfig::Type::Graph:
-        printf("unimplemented\n");
+    case WidgetConfig::Slider:
+        if (widget.slider.val == nullptr) {
+            printf("WidgetPage: slider %s has no value\n",
+                   widget.slider.label.c_str());
+            return;
+        }
+        node.slider.reset(new SliderWidget(*widget.slider.val,
+                                           widget.slider.low, widget.slider.high,
+                                           to_rect(rect), widget.slider.label));
+        node.last_val = *widget.slider.val;
+        break;
+    case WidgetConfig::Button: {
+        std::function<void()> onclick = widget.button.onclick;
+        node.button.reset(new ButtonWidget(
+            [onclick]() {
+                if (onclick) {
+                    onclick();
+                }
+            },
+            to_rect(rect), widget.button.label));
+        break;
+    }
+    case WidgetConfig::Checkbox:
+        node.checked = widget.checkbox.initial;
+        break;
+    default:
+        break;
+    }
+    nodes.push_back(std::move(node));
+}
+
+void WidgetPage::update(bool was_pressed [[maybe_unused]],
+                        int x [[maybe_unused]], int y [[maybe_unused]]) {
+    // touches come through touch()
+    bool poll = poll_tmr.time(vex::msec) > poll_ms;
+    if (poll) {
+        poll_tmr.reset();
+    }
+
+    for (Node &node : nodes) {
+        WidgetConfig &w = *node.cfg;
+        switch (w.type) {
+        case WidgetConfig::Slider:
+            // moved by touch() or from somewhere else
+            if (*w.slider.val != node.last_val) {
+                node.last_val = *w.slider.val;
+                invalidate(node.rect);
+            }
+            break;
+        case WidgetConfig::Text:
+            if (poll && w.text.text) {
+                std::string t = w.text.text();
+                if (t != node.last_text) {
+                    node.last_text = t;
+                    invalidate(node.rect);
+                }
+            }
+            break;
+        case WidgetConfig::Graph:
+            if (poll) {
+                invalidate(node.rect);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void WidgetPage::touch(const TouchEvent &e) {
+    if (e.type == TouchEvent::Press) {
+        grabbed = -1;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (contains(nodes[i].rect, e.x, e.y)) {
+                grabbed = (int)i;
+                break;
+            }
+        }
+    }
+    if (grabbed < 0) {
+        return;
+    }
+
+    Node &node = nodes[grabbed];
+    WidgetConfig &w = *node.cfg;
+    bool down = e.type == TouchEvent::Press || e.type == TouchEvent::Drag;
+    switch (w.type) {
+    case WidgetConfig::Slider:
+        if (down) {
+            // Keep following the finger after it slides off either end
+            int x = (int)clamp(e.x, node.rect.x1, node.rect.x2 - 1.0);
+            int y = (int)(node.rect.y1 + node.rect.y2) / 2;
+            node.slider->update(true, x, y);
+        }
         break;
-    case WidgetConfig::Type::Text:
-        draw_label(scr, widget.config.text.text(), rect);
+    case WidgetConfig::Button:
+        // the button only fires on the way down
+        node.button->update(down, e.x, e.y);
         break;
-    case WidgetConfig::Type::Label:
-        draw_label(scr, widget.config.label.label, rect);
+    case WidgetConfig::Checkbox:
+        if (e.type == TouchEvent::Press) {
+            node.checked = !node.checked;
+            if (w.checkbox.onupdate) {
+                w.checkbox.onupdate(node.checked);
+            }
+            invalidate(node.rect);
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (!down) {
+        grabbed = -1;
+    }
+}
+
+static bool overlaps(const ScreenRect &a, const ScreenRect &b) {
+    return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+}
+
+void WidgetPage::draw(Canvas &scr, bool first_draw [[maybe_unused]],
+                      unsigned int frame_number [[maybe_unused]]) {
+    ScreenRect area = draw_area();
+    for (Node &node : nodes) {
+        if (overlaps(node.rect, area)) {
+            draw_node(scr, node);
+        }
+    }
+}
+
+void WidgetPage::draw_node(Canvas &scr, Node &node) {
+    WidgetConfig &w = *node.cfg;
+    ScreenRect r = node.rect;
+    scr.setPenColor(vex::white);
+    scr.setFillColor(vex::black);
+    scr.setPenWidth(1);
+    switch (w.type) {
+    case WidgetConfig::Slider:
+        node.slider->draw(scr, false, 0);
+        break;
+    case WidgetConfig::Button:
+        node.button->draw(scr, false, 0);
+        break;
+    case WidgetConfig::Checkbox: {
+        int box = (int)(r.y2 - r.y1) - 4;
+        box = box > 20 ? 20 : box;
+        int top = (int)(r.y1 + r.y2) / 2 - box / 2;
+        scr.setFillColor(node.checked ? vex::color(0, 150, 0)
+                                      : vex::color(50, 50, 50));
+        scr.drawRectangle(r.x1 + 2, top, box, box);
+        scr.setFillColor(vex::black);
+        int h = scr.getStringHeight(w.checkbox.label.c_str());
+        scr.printAt(r.x1 + box + 8, top + box / 2 + h / 2, false, "%s",
+                    w.checkbox.label.c_str());
+        break;
+    }
+    case WidgetConfig::Label:
+        draw_label(scr, w.label.label, r);
+        break;
+    case WidgetConfig::Text:
+        draw_label(scr, node.last_text, r);
+        break;
+    case WidgetConfig::Graph:
+        if (w.graph != nullptr) {
+            w.graph->draw(scr, r.x1, r.y1, r.x2 - r.x1, r.y2 - r.y1);
+        }
+        break;
+    default:
         break;
     }
 }
@@ -32,14 +244,60 @@ void draw_widget(vex::brain::lcd &scr, WidgetConfig &widget, ScreenRect rect) {
 struct ScreenData {
     ScreenData(const std::vector<Page *> &m_pages, int m_page,
                vex::brain::lcd &m_screen)
-        : pages(m_pages), page(m_page), screen(m_screen) {}
+        : pages(m_pages), page(m_page), screen(m_screen),
+          last_shown(m_pages.size(), 0) {}
     std::vector<Page *> pages;
     int page = 0;
     vex::brain::lcd screen;
+
+    // carried between runs of the screen task
+    unsigned int frame = 0;
+    bool was_pressed = false; ///< debounced, what the front page's update() gets
+    int x_press = 0;
+    int y_press = 0;
+
+    MessageQueue<TouchEvent, 16> touches;
+    uint32_t up_since = 0;  ///< when the screen stopped reading a press
+    bool lifting = false;   ///< not pressed, but not for long enough to release
+    TouchEvent down = {};   ///< where the current touch started
+    bool nav_touch = false; ///< the current touch is on the navigation bars
+    bool swiping = false;   ///< the current touch is a swipe between pages
+
+    int drawn_page = -1; ///< page on the screen, -1 before the first draw
+    int entered_page = -1; ///< page last given on_enter()
+    std::vector<uint32_t> last_shown; ///< when each page was last in front
+    uint32_t last_draw_ms = 0;
 };
 
-static vex::thread *screen_thread = nullptr;
+/// how often the screen task runs (touch polling and page updates)
+static const uint32_t screen_period_ms = 5;
+/// how long one screen update (including drawing) is expected to take
+static const uint32_t screen_budget_us = 4000;
+/// shortest time between two frames, set by set_max_fps()
+static uint32_t frame_period_ms = 1000 / 30;
+/// most bytes hidden pages may hold, set by set_memory_budget() from any
+/// thread
+static std::atomic<size_t> memory_budget(SIZE_MAX);
+/// the budget changed, check it without waiting for a page change
+static std::atomic<bool> budget_changed(false);
+/// how long the screen has to read no press before a touch is released.
+/// Presses flicker off for a reading or two while dragging
+static const uint32_t release_debounce_ms = 15;
+/// how far the finger has to move to make a Drag
+static const int drag_px = 2;
+/// a touch is a swipe once it goes this far sideways...
+static const int swipe_px = 80;
+/// ...within this long of going down. Slower and it's a drag (of a slider,
+/// say)
+static const uint32_t swipe_ms = 300;
+
+static PeriodicTask *screen_task = nullptr;
 static bool running = false;
+/// made by the first start_mirror(). Kept after stop_mirror(), the screen
+/// task may be in the middle of using it. start_mirror() can be called from
+/// any thread, and only hands it over or asks it for a full frame
+static std::atomic<MirrorStream *> mirror(nullptr);
+static std::atomic<bool> mirroring(false);
 static int screen_thread_func(void *screen_data_v);
 static ScreenData *screen_data_ptr;
 
@@ -64,12 +322,194 @@ void start_screen(vex::brain::lcd &screen, std::vector<Page *> pages,
     }
 
     ScreenData *data = new ScreenData{pages, first_page, screen};
+    screen_data_ptr = data;
+    running = true;
+
+    screen_task = new PeriodicTask(
+        "screen", screen_period_ms, screen_budget_us,
+        [data]() { screen_thread_func(static_cast<void *>(data)); });
+    screen_task->start();
+}
+
+void stop_screen() {
+    running = false;
+    if (screen_task != nullptr) {
+        screen_task->stop();
+    }
+}
 
-    screen_thread =
-        new vex::thread(screen_thread_func, static_cast<void *>(data));
+void start_mirror(uint32_t bytes_per_sec, uint32_t max_fps) {
+    if (mirror.load() == nullptr) {
+        mirror = new MirrorStream(bytes_per_sec, max_fps);
+    } else {
+        // the viewer missed everything while stopped
+        mirror.load()->request_full_frame();
+    }
+    mirroring = true;
 }
 
-void stop_screen() { running = false; }
+void stop_mirror() { mirroring = false; }
+
+void set_memory_budget(size_t bytes) {
+    memory_budget = bytes;
+    budget_changed = true;
+}
+
+void set_max_fps(uint32_t fps) {
+    frame_period_ms = fps > 0 ? 1000 / fps : 0;
+}
+
+void Page::invalidate(ScreenRect rect) {
+    // keep it on the page
+    rect.x1 = rect.x1 < page_area.x1 ? page_area.x1 : rect.x1;
+    rect.y1 = rect.y1 < page_area.y1 ? page_area.y1 : rect.y1;
+    rect.x2 = rect.x2 > page_area.x2 ? page_area.x2 : rect.x2;
+    rect.y2 = rect.y2 > page_area.y2 ? page_area.y2 : rect.y2;
+    if (rect.x2 <= rect.x1 || rect.y2 <= rect.y1) {
+        return;
+    }
+
+    auto merge = [](ScreenRect &into, const ScreenRect &r) {
+        into.x1 = r.x1 < into.x1 ? r.x1 : into.x1;
+        into.y1 = r.y1 < into.y1 ? r.y1 : into.y1;
+        into.x2 = r.x2 > into.x2 ? r.x2 : into.x2;
+        into.y2 = r.y2 > into.y2 ? r.y2 : into.y2;
+    };
+
+    // Overlapping rectangles would be drawn twice, merge them
+    for (int i = 0; i < num_dirty; i++) {
+        ScreenRect &d = dirty[i];
+        if (rect.x1 <= d.x2 && d.x1 <= rect.x2 && rect.y1 <= d.y2 &&
+            d.y1 <= rect.y2) {
+            merge(d, rect);
+            return;
+        }
+    }
+    if (num_dirty < max_dirty) {
+        dirty[num_dirty++] = rect;
+        return;
+    }
+    // Out of room, draw everything in one
+    for (int i = 1; i < num_dirty; i++) {
+        merge(dirty[0], dirty[i]);
+    }
+    merge(dirty[0], rect);
+    num_dirty = 1;
+}
+
+int Page::take_dirty(ScreenRect *out) {
+    int n = num_dirty;
+    for (int i = 0; i < n; i++) {
+        out[i] = dirty[i];
+    }
+    num_dirty = 0;
+    return n;
+}
+
+/// @brief clear rect then draw the page, clipped to rect
+static void draw_clipped(Canvas &scr, Page *page, ScreenRect rect,
+                         bool first_draw, unsigned int frame) {
+    int w = rect.x2 - rect.x1;
+    int h = rect.y2 - rect.y1;
+    scr.setClipRegion(rect.x1, rect.y1, w, h);
+    scr.setPenColor(vex::color::black);
+    scr.setFillColor(vex::color::black);
+    scr.drawRectangle(rect.x1, rect.y1, w, h);
+    scr.setPenColor("#FFFFFF");
+    scr.setFillColor("#000000");
+    page->set_draw_area(rect);
+    page->draw(scr, first_draw, frame);
+}
+
+/// @brief draw the navigation bars. Only needed when the whole screen is
+/// cleared, pages are clipped so they can't draw over them
+static void draw_nav_bars(Canvas &scr) {
+    scr.setClipRegion(0, 0, 480, 240);
+    scr.setPenColor("#202020");
+    scr.setFillColor("#202020");
+    scr.drawRectangle(0, 0, 40, 240);
+    scr.drawRectangle(440, 0, 40, 240);
+    scr.setPenColor("#FFFFFF");
+    // left arrow
+    scr.drawLine(30, 100, 15, 120);
+    scr.drawLine(30, 140, 15, 120);
+    // right arrow
+    scr.drawLine(450, 100, 465, 120);
+    scr.drawLine(450, 140, 465, 120);
+}
+
+/**
+ * @brief turn what the touch screen reads into Press, Drag and Release events
+ * in screen_data.touches. A press is reported straight away, a release only
+ * once nothing has been read for release_debounce_ms
+ */
+static void read_touch(ScreenData &screen_data, uint32_t now) {
+    vex::brain::lcd &scr = screen_data.screen;
+    bool pressing = scr.pressing();
+
+    if (pressing) {
+        int x = scr.xPosition();
+        int y = scr.yPosition();
+        screen_data.lifting = false;
+        if (!screen_data.was_pressed) {
+            screen_data.was_pressed = true;
+            screen_data.touches.push({TouchEvent::Press, x, y, now});
+        } else if (abs(x - screen_data.x_press) >= drag_px ||
+                   abs(y - screen_data.y_press) >= drag_px) {
+            screen_data.touches.push({TouchEvent::Drag, x, y, now});
+        } else {
+            return;
+        }
+        screen_data.x_press = x;
+        screen_data.y_press = y;
+        return;
+    }
+
+    if (!screen_data.was_pressed) {
+        return;
+    }
+    if (!screen_data.lifting) {
+        screen_data.lifting = true;
+        screen_data.up_since = now;
+    }
+    if (now - screen_data.up_since >= release_debounce_ms) {
+        screen_data.lifting = false;
+        screen_data.was_pressed = false;
+        screen_data.touches.push({TouchEvent::Release, screen_data.x_press,
+                                  screen_data.y_press, screen_data.up_since});
+    }
+}
+
+/**
+ * @brief unload hidden pages, least recently shown first, until what they
+ * hold fits in memory_budget
+ */
+static void trim_hidden_pages(ScreenData &screen_data) {
+    while (true) {
+        size_t held = 0;
+        int oldest = -1;
+        for (size_t i = 0; i < screen_data.pages.size(); i++) {
+            if ((int)i == screen_data.entered_page) {
+                continue;
+            }
+            size_t bytes = screen_data.pages[i]->heavy_bytes();
+            held += bytes;
+            if (bytes > 0 &&
+                (oldest < 0 || screen_data.last_shown[i] <
+                                   screen_data.last_shown[oldest])) {
+                oldest = i;
+            }
+        }
+        if (held <= memory_budget || oldest < 0) {
+            return;
+        }
+        screen_data.pages[oldest]->unload();
+        if (screen_data.pages[oldest]->heavy_bytes() > 0) {
+            // couldn't free it, don't try forever
+            return;
+        }
+    }
+}
 
 void prev_page() {
     screen_data_ptr->page--;
@@ -87,80 +527,196 @@ void goto_page(size_t page) {
 }
 
 /**
- * @brief runs the screen thread
+ * @brief runs one update of the screen. Called every screen_period_ms by the
+ * screen task. Touches are read and pages updated every time, drawing happens
+ * at most every frame_period_ms and only when there is something to draw
  * This should only be called by start_screen
  * If you are calling this, maybe don't
  */
 int screen_thread_func(void *screen_data_v) {
     ScreenData &screen_data = *static_cast<ScreenData *>(screen_data_v);
-    screen_data_ptr = static_cast<ScreenData *>(screen_data_v);
-    running = true;
-    unsigned int frame = 0;
+    unsigned int &frame = screen_data.frame;
+    bool &was_pressed = screen_data.was_pressed;
+    int &x_press = screen_data.x_press;
+    int &y_press = screen_data.y_press;
 
-    bool was_pressed = false;
-    int x_press = 0;
-    int y_press = 0;
-
-    while (running) {
-        Page *front_page = screen_data.pages[screen_data.page];
-        bool pressing = screen_data.screen.pressing();
+    read_touch(screen_data, vex::timer::system());
 
-        if (pressing) {
-            pressing = true;
-            x_press = screen_data.screen.xPosition();
-            y_press = screen_data.screen.yPosition();
+    // Touches go to the front page, unless they're for changing pages
+    TouchEvent e;
+    while (screen_data.touches.pop(e)) {
+        if (e.type == TouchEvent::Press) {
+            screen_data.down = e;
+            screen_data.swiping = false;
+            screen_data.nav_touch = e.x < 40 || e.x > 440;
+            if (e.x < 40) {
+                prev_page();
+            } else if (e.x > 440) {
+                next_page();
+            }
+        }
+        if (screen_data.nav_touch) {
+            continue;
         }
-        bool just_pressed = pressing && !was_pressed;
 
-        if (just_pressed && x_press < 40) {
-            screen_data.page--;
-            if (screen_data.page < 0) {
-                screen_data.page += screen_data.pages.size();
+        int dx = e.x - screen_data.down.x;
+        int dy = e.y - screen_data.down.y;
+        if (e.type == TouchEvent::Drag && !screen_data.swiping &&
+            e.time_ms - screen_data.down.time_ms <= swipe_ms &&
+            abs(dx) > swipe_px && abs(dy) < abs(dx) / 2) {
+            screen_data.swiping = true;
+            TouchEvent cancel = e;
+            cancel.type = TouchEvent::Cancel;
+            screen_data.pages[screen_data.page]->touch(cancel);
+        }
+        if (screen_data.swiping) {
+            // swipe left for the next page, like turning one
+            if (e.type == TouchEvent::Release && dx < 0) {
+                next_page();
+            } else if (e.type == TouchEvent::Release) {
+                prev_page();
             }
+            continue;
         }
-        if (just_pressed && x_press > 440) {
-            screen_data.page++;
-            screen_data.page %= screen_data.pages.size();
+        screen_data.pages[screen_data.page]->touch(e);
+    }
+
+    // Let the pages know when the front one changes. The new one loads what
+    // it needs, hidden ones may have to give theirs up
+    uint32_t now = vex::timer::system();
+    if (screen_data.page != screen_data.entered_page) {
+        if (screen_data.entered_page >= 0) {
+            screen_data.pages[screen_data.entered_page]->on_exit();
+            screen_data.last_shown[screen_data.entered_page] = now;
         }
+        screen_data.entered_page = screen_data.page;
+        screen_data.pages[screen_data.page]->on_enter();
+        trim_hidden_pages(screen_data);
+    } else if (budget_changed.exchange(false)) {
+        trim_hidden_pages(screen_data);
+    }
 
-        // Update all pages
-        for (auto page : screen_data.pages) {
-            if (page == front_page) {
-                page->update(was_pressed, x_press, y_press);
-            } else {
-                page->update(false, 0, 0);
-            }
+    // Update the front page with the touch, and the others if they want it
+    Page *front_page = screen_data.pages[screen_data.entered_page];
+    bool page_touch = was_pressed && !screen_data.nav_touch &&
+                      !screen_data.swiping;
+    for (auto page : screen_data.pages) {
+        if (page == front_page) {
+            page->update(page_touch, x_press, y_press);
+        } else if (page->updates_in_background()) {
+            page->update(false, 0, 0);
         }
+    }
 
-        // Draw First Page
-        if (frame % 2 == 0) {
-            screen_data.screen.clearScreen(vex::color::black);
-            screen_data.screen.setPenColor("#FFFFFF");
-            screen_data.screen.setFillColor("#000000");
-            front_page->draw(screen_data.screen, false, frame / 5);
-
-            // Draw side boxes
-            screen_data.screen.setPenColor("#202020");
-            screen_data.screen.setFillColor("#202020");
-            screen_data.screen.drawRectangle(0, 0, 40, 240);
-            screen_data.screen.drawRectangle(440, 0, 40, 240);
-            screen_data.screen.setPenColor("#FFFFFF");
-            // left arrow
-            screen_data.screen.drawLine(30, 100, 15, 120);
-            screen_data.screen.drawLine(30, 140, 15, 120);
-            // right arrow
-            screen_data.screen.drawLine(450, 100, 465, 120);
-            screen_data.screen.drawLine(450, 140, 465, 120);
+    // the mirror's viewer fell behind, start it over from a clear screen
+    MirrorStream *mirror_now = mirroring ? mirror.load() : nullptr;
+    if (mirror_now != nullptr && mirror_now->wants_full_frame()) {
+        screen_data.drawn_page = -1;
+    }
+
+    if (now - screen_data.last_draw_ms >= frame_period_ms) {
+        Canvas scr(screen_data.screen, mirror_now);
+        // Draw the page that was entered. If another thread changed pages
+        // since, the new one is entered (and loaded) next time around
+        front_page = screen_data.pages[screen_data.entered_page];
+        bool first_draw = screen_data.entered_page != screen_data.drawn_page;
+        bool drew = false;
+
+        if (first_draw) {
+            // Everything from scratch, the only time the nav bars are drawn
+            if (mirror_now != nullptr) {
+                mirror_now->restart();
+            }
+            scr.clearScreen(vex::color::black);
+            draw_nav_bars(scr);
+            ScreenRect ignored[Page::max_dirty];
+            front_page->take_dirty(ignored);
+            draw_clipped(scr, front_page, page_area, true, frame / 5);
+            screen_data.drawn_page = screen_data.entered_page;
+            drew = true;
+        } else if (front_page->retained()) {
+            ScreenRect dirty[Page::max_dirty];
+            int n = front_page->take_dirty(dirty);
+            for (int i = 0; i < n; i++) {
+                draw_clipped(scr, front_page, dirty[i], false, frame / 5);
+            }
+            drew = n > 0;
+        } else {
+            draw_clipped(scr, front_page, page_area, false, frame / 5);
+            drew = true;
         }
 
-        screen_data.screen.render();
-        frame++;
-        was_pressed = pressing;
-        vexDelay(5);
+        if (drew) {
+            scr.setClipRegion(0, 0, 480, 240);
+            screen_data.screen.render();
+            screen_data.last_draw_ms = now;
+        }
     }
+    if (mirror_now != nullptr) {
+        mirror_now->flush();
+    }
+
+    frame++;
 
     return 0;
 }
+void LazyPage::take_invalidated() {
+    ScreenRect rects[max_dirty];
+    int n = page->take_dirty(rects);
+    for (int i = 0; i < n; i++) {
+        invalidate(rects[i]);
+    }
+}
+
+void LazyPage::update(bool was_pressed, int x, int y) {
+    if (page != nullptr) {
+        page->update(was_pressed, x, y);
+        take_invalidated();
+    }
+}
+
+void LazyPage::touch(const TouchEvent &e) {
+    if (page != nullptr) {
+        page->touch(e);
+        take_invalidated();
+    }
+}
+
+void LazyPage::draw(Canvas &scr, bool first_draw, unsigned int frame_number) {
+    if (page != nullptr) {
+        page->set_draw_area(draw_area());
+        page->draw(scr, first_draw, frame_number);
+    }
+}
+
+void LazyPage::on_enter() {
+    if (page == nullptr) {
+        page = make();
+    }
+    if (page != nullptr) {
+        page->on_enter();
+    }
+}
+
+void LazyPage::on_exit() {
+    if (page != nullptr) {
+        page->on_exit();
+    }
+}
+
+void LazyPage::unload() {
+    if (page == nullptr) {
+        return;
+    }
+    // A page collecting data has to stay, only its heavy parts can go
+    if (page->updates_in_background()) {
+        page->unload();
+        return;
+    }
+    delete page;
+    page = nullptr;
+}
+
 /**
  * @brief FunctionPage
  * @param update_f drawing function
@@ -174,7 +730,7 @@ void FunctionPage::update(bool was_pressed, int x, int y) {
     update_f(was_pressed, x, y);
 }
 /// @brief draw uses the supplied draw function to draw to the screen
-void FunctionPage::draw(vex::brain::lcd &screen, bool first_draw,
+void FunctionPage::draw(Canvas &screen, bool first_draw,
                         unsigned int frame_number) {
     draw_f(screen, first_draw, frame_number);
 }
@@ -185,10 +741,15 @@ void StatsPage::update(bool was_pressed, int x, int y) {
     (void)x;
     (void)y;
     (void)was_pressed;
+    if (refresh_tmr.time(vex::msec) > refresh_ms) {
+        refresh_tmr.reset();
+        refreshes++;
+        invalidate();
+    }
 }
 void StatsPage::draw_motor_stats(const std::string &name, vex::motor &mot,
                                  unsigned int frame, int x, int y,
-                                 vex::brain::lcd &scr) {
+                                 Canvas &scr) {
     const vex::color hot_col = vex::color(120, 0, 0);
     const vex::color med_col = vex::color(140, 100, 0);
     const vex::color ok_col = vex::black;
@@ -214,7 +775,7 @@ void StatsPage::draw_motor_stats(const std::string &name, vex::motor &mot,
     scr.printAt(x + 2, y + 16, false, " %2d   %2.0fC   %.7s", port, temp,
                 name.c_str());
 }
-void StatsPage::draw(vex::brain::lcd &scr, bool first_draw [[maybe_unused]],
+void StatsPage::draw(Canvas &scr, bool first_draw [[maybe_unused]],
                      unsigned int frame_number [[maybe_unused]]) {
     int num = 0;
     int x = 40;
@@ -233,7 +794,8 @@ void StatsPage::draw(vex::brain::lcd &scr, bool first_draw [[maybe_unused]],
             num = 0;
         }
 
-        draw_motor_stats(kv.first, kv.second, frame_number, x, y, scr);
+        // blink once per refresh rather than per frame
+        draw_motor_stats(kv.first, kv.second, refreshes, x, y, scr);
         y += row_height;
         num++;
     }
@@ -247,71 +809,150 @@ OdometryPage::OdometryPage(OdometryBase &odom, double width, double height,
                            bool do_trail)
     : odom(odom), robot_width(width), robot_height(height), do_trail(do_trail),
       velocity_graph(30, 0.0, 0.0, {vex::green}, 1) {
+    load_field();
+    pose = odom.get_position();
+    for (int i = 0; i < path_len; i++) {
+        path[i] = pose;
+    }
+}
+
+void OdometryPage::load_field() {
+    // Decode the png once here, not every frame. The file itself isn't
+    // needed after that
     vex::brain b;
     if (b.SDcard.exists(field_filename)) {
-        buf_size = b.SDcard.size(field_filename);
-        buf = (uint8_t *)malloc(buf_size);
-        b.SDcard.loadfile(field_filename, buf, buf_size);
+        int32_t size = b.SDcard.size(field_filename);
+        uint8_t *png = (uint8_t *)malloc(size);
+        field_px = new uint32_t[field_size * field_size];
+        v5_image img = {0, 0, field_px, nullptr};
+        bool ok = png != nullptr &&
+                  b.SDcard.loadfile(field_filename, png, size) == size &&
+                  vexImagePngRead(png, &img, field_size, field_size, size) &&
+                  img.width == field_size && img.height == field_size;
+        free(png);
+        if (!ok) {
+            printf("OdometryPage: couldn't decode %s, it must be a %dx%d png\n",
+                   field_filename, field_size, field_size);
+            delete[] field_px;
+            field_px = nullptr;
+        }
     }
-    pose_t pos = odom.get_position();
-    for (int i = 0; i < path_len; i++) {
-        path[i] = pos;
+}
+
+void OdometryPage::on_enter() {
+    if (field_px == nullptr) {
+        load_field();
     }
 }
 
+size_t OdometryPage::heavy_bytes() const {
+    return field_px != nullptr ? field_size * field_size * sizeof(uint32_t)
+                               : 0;
+}
+
+void OdometryPage::unload() {
+    delete[] field_px;
+    field_px = nullptr;
+}
+
 int in_to_px(double in) {
     double p = in / (6.0 * 24.0);
     return (int)(p * 240);
 }
 
-void OdometryPage::draw(vex::brain::lcd &scr, bool first_draw [[maybe_unused]],
-                        unsigned int frame_number [[maybe_unused]]) {
-    pose_t pose = odom.get_position();
-    path[path_index] = pose;
+static point_t field_to_px(const point_t p) {
+    return {(double)in_to_px(p.x) + 200, (double)in_to_px(-p.y) + 240};
+}
 
-    if (do_trail && frame_number % 5 == 0) {
-        path_index++;
-        path_index %= path_len;
+ScreenRect OdometryPage::field_box() {
+    double x1 = 1e9, y1 = 1e9, x2 = -1e9, y2 = -1e9;
+    auto add = [&](point_t p) {
+        point_t px = field_to_px(p);
+        x1 = fmin(x1, px.x);
+        y1 = fmin(y1, px.y);
+        x2 = fmax(x2, px.x);
+        y2 = fmax(y2, px.y);
+    };
+
+    point_t pos = pose.get_point();
+    Mat2 mat = Mat2::FromRotationDegrees(pose.rot - 90);
+    const point_t to_left = point_t{-robot_width / 2.0, 0};
+    const point_t to_front = point_t{0.0, robot_height / 2.0};
+    add(pos + mat * (+to_left + to_front));
+    add(pos + mat * (-to_left + to_front));
+    add(pos + mat * (+to_left - to_front));
+    add(pos + mat * (-to_left - to_front));
+    add(pos + mat * (to_front * 2.0));
+    if (do_trail) {
+        for (int i = 0; i < path_len; i++) {
+            add(path[i].get_point());
+        }
     }
 
-    auto to_px = [](const point_t p) -> point_t {
-        return {(double)in_to_px(p.x) + 200, (double)in_to_px(-p.y) + 240};
-    };
+    // room for pen width and the position circle
+    const double pad = 4;
+    auto px = [](double v) { return (uint32_t)clamp(v, 0.0, 480.0); };
+    return {px(x1 - pad), px(y1 - pad), px(x2 + pad + 1), px(y2 + pad + 1)};
+}
 
-    auto draw_line = [to_px, &scr](const point_t from, const point_t to) {
-        scr.drawLine((int)to_px(from).x, (int)to_px(from).y, (int)to_px(to).x,
-                     (int)to_px(to).y);
-    };
+void OdometryPage::blit_field(Canvas &scr, ScreenRect area) {
+    // Rows of the decoded image are contiguous, so any rectangle of it can be
+    // drawn straight out of the buffer
+    int x1 = (int)area.x1 - field_x, x2 = (int)area.x2 - field_x;
+    x1 = x1 < 0 ? 0 : x1;
+    x2 = x2 > field_size ? field_size : x2;
+    int y1 = area.y1, y2 = (int)area.y2 > field_size ? field_size : area.y2;
+    if (x2 <= x1) {
+        return;
+    }
+    if (y2 <= y1) {
+        return;
+    }
+    scr.drawImageFromBuffer(field_px + y1 * field_size + x1, field_x + x1, y1,
+                            x2 - x1, y2 - y1, field_size);
+}
 
-    point_t pos = pose.get_point();
-    fflush(stdout);
-    scr.printAt(45, 30, "(%.2f, %.2f)", pose.x, pose.y);
-    scr.printAt(45, 50, "%.2f deg", pose.rot);
+void OdometryPage::draw(Canvas &scr, bool first_draw [[maybe_unused]],
+                        unsigned int frame_number [[maybe_unused]]) {
+    const ScreenRect text_area = {page_area.x1, 0, field_x, 240};
+    const ScreenRect field_area = {field_x, 0, page_area.x2, 240};
+    ScreenRect area = draw_area();
 
-    double speed = odom.get_speed();
-    scr.printAt(45, 80, "%.2f speed", speed);
-    velocity_graph.add_samples({speed});
-    velocity_graph.draw(scr, 30, 100, 170, 120);
+    auto draw_line = [&scr](const point_t from, const point_t to) {
+        point_t a = field_to_px(from), b = field_to_px(to);
+        scr.drawLine((int)a.x, (int)a.y, (int)b.x, (int)b.y);
+    };
 
-    if (buf == nullptr) {
+    if (overlaps(area, text_area)) {
+        scr.printAt(45, 30, "(%.2f, %.2f)", pose.x, pose.y);
+        scr.printAt(45, 50, "%.2f deg", pose.rot);
+        scr.printAt(45, 80, "%.2f speed", speed);
+        velocity_graph.draw(scr, 30, 100, 170, 120);
+    }
+
+    if (!overlaps(area, field_area)) {
+        return;
+    }
+    if (field_px == nullptr) {
         scr.printAt(180, 110, "Field Image Not Found");
         return;
     }
 
-    scr.drawImageFromBuffer(buf, 200, 0, buf_size);
+    blit_field(scr, area);
 
-    point_t pos_px = to_px(pos);
+    point_t pos = pose.get_point();
+    point_t pos_px = field_to_px(pos);
     scr.drawCircle((int)pos_px.x, (int)pos_px.y, 3, vex::color::white);
 
     if (do_trail) {
         pose_t last_pos = path[(path_index + 1) % path_len];
         for (int i = path_index + 2; i < path_index + path_len; i++) {
             int j = i % path_len;
-            pose_t pose = path[j];
+            pose_t p = path[j];
             scr.setPenWidth(2);
             scr.setPenColor(vex::color(255, 255, 80));
-            draw_line(pose.get_point(), last_pos.get_point());
-            last_pos = pose;
+            draw_line(p.get_point(), last_pos.get_point());
+            last_pos = p;
         }
     }
     scr.setPenColor(vex::color::white);
@@ -333,10 +974,41 @@ void OdometryPage::draw(vex::brain::lcd &scr, bool first_draw [[maybe_unused]],
 
     draw_line(pos, front);
 }
+
 void OdometryPage::update(bool was_pressed, int x, int y) {
     (void)x;
     (void)y;
     (void)was_pressed;
+    if (sample_tmr.time(vex::msec) < sample_ms) {
+        return;
+    }
+    sample_tmr.reset();
+
+    pose_t last_pose = pose;
+    pose = odom.get_position();
+    speed = odom.get_speed();
+    velocity_graph.add_samples({speed});
+    invalidate({page_area.x1, 0, (uint32_t)field_x, 240});
+
+    path[path_index] = pose;
+    if (do_trail && ++samples % trail_every == 0) {
+        path_index++;
+        path_index %= path_len;
+        path[path_index] = pose;
+    }
+
+    // Redraw where the robot and trail were and where they are now. Nothing
+    // on the field if nothing moved
+    bool moved = pose.x != last_pose.x || pose.y != last_pose.y ||
+                 pose.rot != last_pose.rot;
+    if (moved) {
+        ScreenRect box = field_box();
+        if (last_box.x2 > last_box.x1) {
+            invalidate(last_box);
+        }
+        invalidate(box);
+        last_box = box;
+    }
 }
 
 bool SliderWidget::update(bool was_pressed, int x, int y) {
@@ -354,7 +1026,7 @@ bool SliderWidget::update(bool was_pressed, int x, int y) {
     }
     return false;
 }
-void SliderWidget::draw(vex::brain::lcd &scr, bool first_draw [[maybe_unused]],
+void SliderWidget::draw(Canvas &scr, bool first_draw [[maybe_unused]],
                         unsigned int frame_number [[maybe_unused]]) {
     if (rect.height() <= 0) {
         printf("Slider: %s has no height. Cant use it.", name.c_str());
@@ -401,7 +1073,7 @@ bool ButtonWidget::update(bool was_pressed, int x, int y) {
     return false;
 }
 
-void ButtonWidget::draw(vex::brain::lcd &scr, bool first_draw [[maybe_unused]],
+void ButtonWidget::draw(Canvas &scr, bool first_draw [[maybe_unused]],
                         unsigned int frame_number [[maybe_unused]]) {
     scr.setPenColor(vex::white);
     scr.setPenWidth(1);
@@ -437,7 +1109,7 @@ void PIDPage::update(bool was_pressed, int x, int y) {
         onchange();
     }
 }
-void PIDPage::draw(vex::brain::lcd &scr, bool first_draw [[maybe_unused]],
+void PIDPage::draw(Canvas &scr, bool first_draw [[maybe_unused]],
                    unsigned int frame_number [[maybe_unused]]) {
     p_slider.draw(scr, first_draw, frame_number);
     i_slider.draw(scr, first_draw, frame_number);
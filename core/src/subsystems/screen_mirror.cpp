@@ -0,0 +1,398 @@
+#include "../core/include/subsystems/screen_mirror.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace screen {
+
+/// USB serial channel printf uses
+static const uint32_t serial_channel = 1;
+static const uint32_t transparent_bit = 1 << 24;
+
+MirrorStream::MirrorStream(uint32_t bytes_per_sec, uint32_t max_fps,
+                           uint32_t max_frame_bytes)
+    : bytes_per_sec(bytes_per_sec),
+      frame_period_ms(max_fps > 0 ? 1000 / max_fps : 0),
+      // the length in the header is 16 bits
+      max_frame_bytes(max_frame_bytes > 60000 ? 60000 : max_frame_bytes) {
+    rec.reserve(this->max_frame_bytes);
+    packet.reserve(this->max_frame_bytes + header_size + trailer_size);
+    // the viewer has nothing yet, start with a full redraw
+    overflowed = true;
+    last_flush_ms = vex::timer::system();
+    last_resync_ms = last_flush_ms - resync_ms;
+}
+
+void MirrorStream::restart() {
+    rec.clear();
+    overflowed = false;
+    // the viewer may have missed these, send them again
+    color(PenColor, pen);
+    color(FillColor, fill);
+    if (begin(PenWidth, 1)) {
+        u8(pen_width);
+    }
+    if (begin(Font, 1)) {
+        u8(font);
+    }
+}
+
+void MirrorStream::request_full_frame() { full_frame_requested = true; }
+
+bool MirrorStream::wants_full_frame() {
+    // rec belongs to the screen task, so a request from elsewhere is only
+    // acted on here
+    if (full_frame_requested.exchange(false)) {
+        rec.clear();
+        overflowed = true;
+    }
+    if (!overflowed || packet_sent < packet.size()) {
+        return false;
+    }
+    uint32_t now = vex::timer::system();
+    if (now - last_resync_ms < resync_ms) {
+        return false;
+    }
+    last_resync_ms = now;
+    resync_count++;
+    return true;
+}
+
+bool MirrorStream::begin(Op o, size_t arg_bytes) {
+    if (overflowed) {
+        return false;
+    }
+    if (rec.size() + 1 + arg_bytes > max_frame_bytes) {
+        // Too much to send, start over with a full redraw later
+        overflowed = true;
+        rec.clear();
+        return false;
+    }
+    rec.push_back(o);
+    return true;
+}
+
+void MirrorStream::u8(uint8_t v) { rec.push_back(v); }
+
+void MirrorStream::u16(uint16_t v) {
+    rec.push_back(v & 0xFF);
+    rec.push_back(v >> 8);
+}
+
+void MirrorStream::i16(int32_t v) {
+    v = v < -32768 ? -32768 : (v > 32767 ? 32767 : v);
+    u16((uint16_t)(int16_t)v);
+}
+
+void MirrorStream::u32(uint32_t v) {
+    u16(v & 0xFFFF);
+    u16(v >> 16);
+}
+
+void MirrorStream::color(Op o, uint32_t rgb) {
+    if (o == PenColor) {
+        pen = rgb;
+    } else if (o == FillColor) {
+        fill = rgb;
+    }
+    if (begin(o, 4)) {
+        u32(rgb);
+    }
+}
+
+void MirrorStream::image(const uint32_t *argb, int32_t x, int32_t y,
+                         int32_t w, int32_t h, int32_t stride) {
+    if (w <= 0 || h <= 0 || overflowed) {
+        return;
+    }
+    // Skip pixels until it fits in half of what's left of the buffer, so
+    // whatever is drawn over it still fits. A video frame or the field would
+    // otherwise fill it on its own
+    size_t used = rec.size() + 1 + 9;
+    size_t budget = used < max_frame_bytes ? (max_frame_bytes - used) / 2 : 0;
+    uint32_t step = 1;
+    auto size = [&](uint32_t s) {
+        return (size_t)((w + s - 1) / s) * ((h + s - 1) / s) * 2;
+    };
+    while (size(step) > budget && step < 255) {
+        step++;
+    }
+    if (!begin(Image, 9 + size(step))) {
+        return;
+    }
+    i16(x);
+    i16(y);
+    i16(w);
+    i16(h);
+    u8(step);
+    for (int32_t row = 0; row < h; row += step) {
+        const uint32_t *px = argb + row * stride;
+        for (int32_t col = 0; col < w; col += step) {
+            uint32_t c = px[col];
+            u16(((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c >> 3) & 0x1F));
+        }
+    }
+}
+
+void MirrorStream::start_packet(uint32_t now) {
+    packet.clear();
+    packet_sent = 0;
+    uint32_t len = 4 + rec.size();
+    packet.push_back(0xA5);
+    packet.push_back(0x5A);
+    packet.push_back(len & 0xFF);
+    packet.push_back(len >> 8);
+    for (int i = 0; i < 4; i++) {
+        packet.push_back((frame >> (8 * i)) & 0xFF);
+    }
+    packet.insert(packet.end(), rec.begin(), rec.end());
+
+    // fletcher16 over everything after the sync bytes
+    uint32_t a = 0, b = 0;
+    for (size_t i = 2; i < packet.size(); i++) {
+        a = (a + packet[i]) % 255;
+        b = (b + a) % 255;
+    }
+    packet.push_back(a);
+    packet.push_back(b);
+
+    rec.clear();
+    frame++;
+    last_packet_ms = now;
+}
+
+void MirrorStream::flush() {
+    uint32_t now = vex::timer::system();
+    double cap = max_frame_bytes + header_size + trailer_size;
+    tokens += bytes_per_sec * (now - last_flush_ms) / 1000.0;
+    tokens = tokens > cap ? cap : tokens;
+    last_flush_ms = now;
+
+    bool idle = packet_sent >= packet.size();
+    if (idle && !overflowed && !rec.empty() &&
+        now - last_packet_ms >= frame_period_ms) {
+        start_packet(now);
+    }
+
+    size_t n = packet.size() - packet_sent;
+    n = n > (size_t)tokens ? (size_t)tokens : n;
+    int32_t room = vexSerialWriteFree(serial_channel);
+    n = n > (size_t)(room > 0 ? room : 0) ? (size_t)(room > 0 ? room : 0) : n;
+    if (n == 0) {
+        return;
+    }
+    vexSerialWriteBuffer(serial_channel, &packet[packet_sent], n);
+    packet_sent += n;
+    tokens -= n;
+    sent_total += n;
+}
+
+/// @brief "#RRGGBB" to 0xRRGGBB
+static uint32_t parse_hex(const char *hex) {
+    if (hex == nullptr) {
+        return 0;
+    }
+    if (hex[0] == '#') {
+        hex++;
+    }
+    return strtoul(hex, nullptr, 16) & 0xFFFFFF;
+}
+
+static uint32_t to_rgb(const vex::color &c) {
+    return c.isTransparent() ? transparent_bit : (c.rgb() & 0xFFFFFF);
+}
+
+void Canvas::setPenColor(const vex::color &c) {
+    scr.setPenColor(c);
+    if (mirror) {
+        mirror->color(MirrorStream::PenColor, to_rgb(c));
+    }
+}
+
+void Canvas::setPenColor(const char *hex) {
+    scr.setPenColor(hex);
+    if (mirror) {
+        mirror->color(MirrorStream::PenColor, parse_hex(hex));
+    }
+}
+
+void Canvas::setFillColor(const vex::color &c) {
+    scr.setFillColor(c);
+    if (mirror) {
+        mirror->color(MirrorStream::FillColor, to_rgb(c));
+    }
+}
+
+void Canvas::setFillColor(const char *hex) {
+    scr.setFillColor(hex);
+    if (mirror) {
+        mirror->color(MirrorStream::FillColor, parse_hex(hex));
+    }
+}
+
+void Canvas::setPenWidth(uint32_t width) {
+    scr.setPenWidth(width);
+    if (mirror) {
+        mirror->pen_width = width > 255 ? 255 : width;
+        if (mirror->begin(MirrorStream::PenWidth, 1)) {
+            mirror->u8(mirror->pen_width);
+        }
+    }
+}
+
+void Canvas::setFont(vex::fontType font) {
+    scr.setFont(font);
+    if (mirror) {
+        mirror->font = (uint8_t)font;
+        if (mirror->begin(MirrorStream::Font, 1)) {
+            mirror->u8(mirror->font);
+        }
+    }
+}
+
+void Canvas::setClipRegion(int32_t x, int32_t y, int32_t w, int32_t h) {
+    scr.setClipRegion(x, y, w, h);
+    if (mirror && mirror->begin(MirrorStream::Clip, 8)) {
+        mirror->i16(x);
+        mirror->i16(y);
+        mirror->i16(w);
+        mirror->i16(h);
+    }
+}
+
+void Canvas::drawPixel(int32_t x, int32_t y) {
+    scr.drawPixel(x, y);
+    if (mirror && mirror->begin(MirrorStream::Pixel, 4)) {
+        mirror->i16(x);
+        mirror->i16(y);
+    }
+}
+
+void Canvas::drawLine(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    scr.drawLine(x1, y1, x2, y2);
+    if (mirror && mirror->begin(MirrorStream::Line, 8)) {
+        mirror->i16(x1);
+        mirror->i16(y1);
+        mirror->i16(x2);
+        mirror->i16(y2);
+    }
+}
+
+void Canvas::drawRectangle(int32_t x, int32_t y, int32_t w, int32_t h) {
+    scr.drawRectangle(x, y, w, h);
+    if (mirror && mirror->begin(MirrorStream::Rect, 8)) {
+        mirror->i16(x);
+        mirror->i16(y);
+        mirror->i16(w);
+        mirror->i16(h);
+    }
+}
+
+void Canvas::drawRectangle(int32_t x, int32_t y, int32_t w, int32_t h,
+                           const vex::color &fill) {
+    scr.drawRectangle(x, y, w, h, fill);
+    if (mirror) {
+        // the fill only applies to this rectangle
+        uint32_t prev = mirror->fill;
+        mirror->color(MirrorStream::FillColor, to_rgb(fill));
+        if (mirror->begin(MirrorStream::Rect, 8)) {
+            mirror->i16(x);
+            mirror->i16(y);
+            mirror->i16(w);
+            mirror->i16(h);
+        }
+        mirror->color(MirrorStream::FillColor, prev);
+    }
+}
+
+void Canvas::drawCircle(int32_t x, int32_t y, int32_t radius) {
+    scr.drawCircle(x, y, radius);
+    if (mirror && mirror->begin(MirrorStream::Circle, 6)) {
+        mirror->i16(x);
+        mirror->i16(y);
+        mirror->i16(radius);
+    }
+}
+
+void Canvas::drawCircle(int32_t x, int32_t y, int32_t radius,
+                        const vex::color &fill) {
+    scr.drawCircle(x, y, radius, fill);
+    if (mirror) {
+        uint32_t prev = mirror->fill;
+        mirror->color(MirrorStream::FillColor, to_rgb(fill));
+        if (mirror->begin(MirrorStream::Circle, 6)) {
+            mirror->i16(x);
+            mirror->i16(y);
+            mirror->i16(radius);
+        }
+        mirror->color(MirrorStream::FillColor, prev);
+    }
+}
+
+void Canvas::drawImageFromBuffer(uint32_t *argb, int32_t x, int32_t y,
+                                 int32_t w, int32_t h) {
+    scr.drawImageFromBuffer(argb, x, y, w, h);
+    if (mirror) {
+        mirror->image(argb, x, y, w, h, w);
+    }
+}
+
+void Canvas::drawImageFromBuffer(uint32_t *argb, int32_t x, int32_t y,
+                                 int32_t w, int32_t h, int32_t stride) {
+    if (stride == w) {
+        drawImageFromBuffer(argb, x, y, w, h);
+        return;
+    }
+    for (int32_t row = 0; row < h; row++) {
+        scr.drawImageFromBuffer(argb + row * stride, x, y + row, w, 1);
+    }
+    if (mirror) {
+        mirror->image(argb, x, y, w, h, stride);
+    }
+}
+
+void Canvas::clearScreen(const vex::color &c) {
+    scr.clearScreen(c);
+    if (mirror && mirror->begin(MirrorStream::Clear, 4)) {
+        mirror->u32(to_rgb(c));
+    }
+}
+
+void Canvas::record_text(int32_t x, int32_t y, bool opaque, const char *s) {
+    if (mirror) {
+        size_t len = strlen(s);
+        len = len > 255 ? 255 : len;
+        if (mirror->begin(MirrorStream::Text, 6 + len)) {
+            mirror->i16(x);
+            mirror->i16(y);
+            mirror->u8(opaque ? 1 : 0);
+            mirror->u8(len);
+            mirror->rec.insert(mirror->rec.end(), s, s + len);
+        }
+    }
+}
+
+void Canvas::printAt(int32_t x, int32_t y, const char *fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    scr.printAt(x, y, true, "%s", buf);
+    // without opaque, the brain draws text over the fill color
+    record_text(x, y, true, buf);
+}
+
+void Canvas::printAt(int32_t x, int32_t y, bool opaque, const char *fmt,
+                     ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    scr.printAt(x, y, opaque, "%s", buf);
+    record_text(x, y, opaque, buf);
+}
+
+} // namespace screen
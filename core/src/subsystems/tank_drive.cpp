@@ -1,4 +1,5 @@
 #include "../core/include/subsystems/tank_drive.h"
+#include "../core/include/utils/battery_compensation.h"
 #include "../core/include/utils/command_structure/drive_commands.h"
 #include "../core/include/utils/controls/pidff.h"
 #include "../core/include/utils/geometry.h"
@@ -157,8 +158,13 @@ void TankDrive::stop() {
 }
 
 void TankDrive::drive_tank_raw(double left_norm, double right_norm) {
-    left_motors.spin(directionType::fwd, left_norm * 12, voltageUnits::volt);
-    right_motors.spin(directionType::fwd, right_norm * 12, voltageUnits::volt);
+    double left_volts = left_norm * 12, right_volts = right_norm * 12;
+    if (compensate_battery) {
+        left_volts = BatteryCompensation::compensate(left_volts);
+        right_volts = BatteryCompensation::compensate(right_volts);
+    }
+    left_motors.spin(directionType::fwd, left_volts, voltageUnits::volt);
+    right_motors.spin(directionType::fwd, right_volts, voltageUnits::volt);
 }
 /**
  * Drive the robot using differential style controls. left_motors controls the
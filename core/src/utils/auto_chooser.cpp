@@ -43,7 +43,7 @@ void AutoChooser::update(bool was_pressed, int x, int y)
   }
 }
 
-void AutoChooser::draw(vex::brain::lcd &scr, [[maybe_unused]] bool first_draw, [[maybe_unused]] unsigned int frame_number)
+void AutoChooser::draw(screen::Canvas &scr, [[maybe_unused]] bool first_draw, [[maybe_unused]] unsigned int frame_number)
 {
   scr.setFont(vex::fontType::mono20);
 
@@ -0,0 +1,60 @@
+#include "../core/include/utils/battery_compensation.h"
+#include "../core/include/utils/moving_average.h"
+#include "../core/include/utils/periodic_task.h"
+#include <atomic>
+
+// The battery is sampled every period_ms and averaged over window samples
+static const uint32_t period_ms = 20;
+static const int window = 50;
+
+static double nominal = 12.8; // a charged V5 battery under light load
+// 0 until start(). Written by the battery task, read by every subsystem's
+static std::atomic<double> filtered(0.0);
+
+// Built by global constructors, before main() starts any tasks, so nothing
+// races to construct them
+static vex::brain battery_brain;
+static MovingAverage avg(window, 0.0);
+static PeriodicTask battery_task("battery", period_ms, 200, []() {
+    avg.add_entry(battery_brain.Battery.voltage(vex::volt));
+    filtered = avg.get_value();
+});
+
+void BatteryCompensation::start() {
+    if (battery_task.running()) {
+        return;
+    }
+    // Start the average at the first reading rather than ramping up from 0
+    double v = battery_brain.Battery.voltage(vex::volt);
+    for (int i = 0; i < window; i++) {
+        avg.add_entry(v);
+    }
+    filtered = v;
+    battery_task.start();
+}
+
+double BatteryCompensation::voltage() { return filtered; }
+
+double BatteryCompensation::scale() {
+    // no reading (or a nonsense one) - don't touch the output
+    if (filtered <= 1.0) {
+        return 1.0;
+    }
+    double s = nominal / filtered;
+    return s > max_scale ? max_scale : s;
+}
+
+double BatteryCompensation::compensate(double volts) {
+    double out = volts * scale();
+    if (out > max_output) {
+        return max_output;
+    }
+    if (out < -max_output) {
+        return -max_output;
+    }
+    return out;
+}
+
+void BatteryCompensation::set_nominal_volts(double volts) { nominal = volts; }
+
+double BatteryCompensation::nominal_volts() { return nominal; }
@@ -34,7 +34,7 @@ double BangBang::update(double val)
     {
         last_output = upper_bound;
     }
-    return upper_bound;
+    return last_output;
 }
 
 bool BangBang::is_on_target()
@@ -0,0 +1,224 @@
+#include "../core/include/utils/controls/controller_bank.h"
+#include <cmath>
+
+ControllerBank::ControllerBank(size_t capacity) {
+    pid_cfgs.reserve(capacity);
+    ff_cfgs.reserve(capacity);
+    handles.reserve(capacity);
+    for (std::vector<float> *v :
+         {&kp, &ki, &kd, &ks, &kv, &ka, &kg, &deadband, &angular, &target,
+          &meas, &vel_ref, &acc_ref, &lower, &upper, &last_err, &accum,
+          &out}) {
+        v->reserve(capacity);
+    }
+    for (std::vector<double> *v :
+         {&on_target_time, &end_vel, &last_time, &on_target_since}) {
+        v->reserve(capacity);
+    }
+    in_deadband.reserve(capacity);
+    tmr.reset();
+}
+
+ControllerBank::Loop &ControllerBank::add_pid(PID::pid_config_t &cfg) {
+    return *handles[add_loop(&cfg, nullptr)];
+}
+
+ControllerBank::Loop &
+ControllerBank::add_pidff(PID::pid_config_t &pid_cfg,
+                          FeedForward::ff_config_t &ff_cfg) {
+    return *handles[add_loop(&pid_cfg, &ff_cfg)];
+}
+
+size_t ControllerBank::add_loop(PID::pid_config_t *pid_cfg,
+                                FeedForward::ff_config_t *ff_cfg) {
+    size_t i = size();
+    pid_cfgs.push_back(pid_cfg);
+    ff_cfgs.push_back(ff_cfg);
+    handles.emplace_back(new Loop(*this, i));
+
+    for (std::vector<float> *v :
+         {&kp, &ki, &kd, &ks, &kv, &ka, &kg, &deadband, &angular, &target,
+          &meas, &vel_ref, &acc_ref, &lower, &upper, &last_err, &accum,
+          &out}) {
+        v->push_back(0);
+    }
+    for (std::vector<double> *v :
+         {&on_target_time, &end_vel, &last_time, &on_target_since}) {
+        v->push_back(0);
+    }
+    in_deadband.push_back(false);
+
+    refresh_gains();
+    reset(i, tmr.value());
+    return i;
+}
+
+void ControllerBank::refresh_gains() {
+    for (size_t i = 0; i < size(); i++) {
+        const PID::pid_config_t &p = *pid_cfgs[i];
+        kp[i] = p.p;
+        ki[i] = p.i;
+        kd[i] = p.d;
+        deadband[i] = p.deadband;
+        on_target_time[i] = p.on_target_time;
+        angular[i] = p.error_method == PID::ANGULAR ? 1.0f : 0.0f;
+
+        if (ff_cfgs[i] != nullptr) {
+            const FeedForward::ff_config_t &f = *ff_cfgs[i];
+            ks[i] = f.kS;
+            kv[i] = f.kV;
+            ka[i] = f.kA;
+            kg[i] = f.kG;
+        }
+    }
+}
+
+void ControllerBank::update_all() { step(0, size(), tmr.value()); }
+
+void ControllerBank::update_all(const double *measurements) {
+    for (size_t i = 0; i < size(); i++) {
+        meas[i] = measurements[i];
+    }
+    step(0, size(), tmr.value());
+}
+
+void ControllerBank::update_all_at(double now) { step(0, size(), now); }
+
+void ControllerBank::step(size_t begin, size_t end, double now) {
+    // Loops last updated at the same time share a dt, which is all of them
+    // unless some were reset or updated on their own since
+    size_t run = begin;
+    for (size_t i = begin + 1; i <= end; i++) {
+        if (i == end || last_time[i] != last_time[run]) {
+            step_together(run, i, now - last_time[run]);
+            run = i;
+        }
+    }
+
+    // the bookkeeping in doubles, kept out of the float math
+    const float *last_err = this->last_err.data(),
+                *deadband = this->deadband.data();
+    double *on_target_since = this->on_target_since.data(),
+           *last_time = this->last_time.data();
+    char *in_deadband = this->in_deadband.data();
+#pragma GCC ivdep
+    for (size_t i = begin; i < end; i++) {
+        bool within = std::fabs(last_err[i]) < deadband[i];
+        bool entered = within & !in_deadband[i];
+        on_target_since[i] = entered ? now : on_target_since[i];
+        in_deadband[i] = within;
+        last_time[i] = now;
+    }
+}
+
+/**
+ * The actual math. Written so every loop does the exact same operations
+ * (selects instead of ifs, a multiply by 1/dt instead of a divide, a cast
+ * instead of round()) on floats, so the compiler can vectorize it
+ */
+void ControllerBank::step_together(size_t begin, size_t end, double dt_s) {
+    const float dt = (float)dt_s;
+    const float inv_dt = dt > 0 ? 1.0f / dt : 0.0f;
+    float *kp = this->kp.data(), *ki = this->ki.data(), *kd = this->kd.data(),
+          *ks = this->ks.data(), *kv = this->kv.data(), *ka = this->ka.data(),
+          *kg = this->kg.data(), *angular = this->angular.data(),
+          *target = this->target.data(), *meas = this->meas.data(),
+          *vel_ref = this->vel_ref.data(), *acc_ref = this->acc_ref.data(),
+          *lower = this->lower.data(), *upper = this->upper.data(),
+          *last_err = this->last_err.data(), *accum = this->accum.data(),
+          *out = this->out.data();
+
+    // every array is its own, so no iteration touches another's memory.
+    // Saying so saves the compiler checking every pair of them at run time
+#pragma GCC ivdep
+    for (size_t i = begin; i < end; i++) {
+        // error, wrapped to +/-180 for angular loops. turns is 0 for linear
+        // ones, and the cast rounds it half away from zero
+        float err = target[i] - meas[i];
+        float turns = angular[i] * err * (1.0f / 360.0f);
+        turns = (float)(int32_t)(turns + std::copysign(0.5f, turns));
+        err -= 360.0f * turns;
+
+        float pd = kp[i] * err + kd[i] * (err - last_err[i]) * inv_dt;
+
+        // Only integrate while not saturated (Integral Clamping). & rather
+        // than && so both sides are always worked out, and a select of err
+        // rather than of the product, which both keep this free of branches
+        bool limits_exist = lower[i] != upper[i];
+        bool saturated = limits_exist & !((pd < upper[i]) & (pd > lower[i]));
+        accum[i] += dt * (saturated ? 0.0f : err);
+
+        float pid = pd + ki[i] * accum[i];
+        pid = (pid > upper[i]) & limits_exist ? upper[i] : pid;
+        pid = (pid < lower[i]) & limits_exist ? lower[i] : pid;
+
+        // Feedforward. kS pushes in the direction we're asked to go, or the
+        // way the pid is pushing if we aren't asked to go anywhere
+        float dir = vel_ref[i] != 0 ? vel_ref[i] : pid;
+        float sgn = (dir > 0 ? 1.0f : 0.0f) - (dir < 0 ? 1.0f : 0.0f);
+        float o = pid + ks[i] * sgn + kv[i] * vel_ref[i] + ka[i] * acc_ref[i] +
+                  kg[i];
+        o = (o > upper[i]) & limits_exist ? upper[i] : o;
+        out[i] = (o < lower[i]) & limits_exist ? lower[i] : o;
+
+        last_err[i] = err;
+    }
+}
+
+void ControllerBank::reset(size_t i, double now) {
+    last_err[i] = 0;
+    accum[i] = 0;
+    last_time[i] = now;
+    in_deadband[i] = false;
+    on_target_since[i] = now;
+    vel_ref[i] = 0;
+    acc_ref[i] = 0;
+}
+
+// Loop handle
+// ==============================================================================================================================
+
+void ControllerBank::Loop::init(double start_pt, double set_pt, double,
+                                double end_vel) {
+    bank.target[index] = set_pt;
+    bank.end_vel[index] = end_vel;
+    bank.meas[index] = start_pt;
+    bank.reset(index, bank.tmr.value());
+}
+
+double ControllerBank::Loop::update(double val) {
+    // Like PIDFF::update(val), no velocity or acceleration feedforward
+    return update(val, 0, 0);
+}
+
+double ControllerBank::Loop::update(double val, double vel_setpt,
+                                    double a_setpt) {
+    bank.set_reference(index, vel_setpt, a_setpt);
+    bank.meas[index] = val;
+    bank.step(index, index + 1, bank.tmr.value());
+    return bank.out[index];
+}
+
+double ControllerBank::Loop::get() { return bank.out[index]; }
+
+void ControllerBank::Loop::set_limits(double lower, double upper) {
+    bank.lower[index] = lower;
+    bank.upper[index] = upper;
+}
+
+bool ControllerBank::Loop::is_on_target() {
+    if (!bank.in_deadband[index]) {
+        return false;
+    }
+    if (bank.end_vel[index] != 0) {
+        return true;
+    }
+    return bank.last_time[index] - bank.on_target_since[index] >
+           bank.on_target_time[index];
+}
+
+void ControllerBank::Loop::set_target(double target) {
+    bank.target[index] = target;
+}
+
+double ControllerBank::Loop::get_target() const { return bank.target[index]; }
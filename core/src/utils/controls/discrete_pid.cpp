@@ -0,0 +1,150 @@
+#include "../core/include/utils/controls/discrete_pid.h"
+#include "../core/include/subsystems/odometry/odometry_base.h"
+#include <cmath>
+
+/**
+ * Create the DiscretePID object
+ */
+DiscretePID::DiscretePID(PID::pid_config_t &config,
+                         const discrete_config_t &dconfig)
+    : config(config), dconfig(dconfig), last_p(config.p) {
+  if (dconfig.sample_time <= 0) {
+    printf("(discrete_pid.cpp): Error - sample_time must be positive\n");
+  }
+  if (dconfig.p_on_measurement < 0 || dconfig.p_on_measurement > 1) {
+    printf("(discrete_pid.cpp): Error - p_on_measurement must be 0 to 1\n");
+  }
+}
+
+void DiscretePID::init(double start_pt, double set_pt, double,
+                       double end_vel) {
+  target = set_pt;
+  target_moved = 0;
+  target_vel = end_vel;
+  sensor_val = start_pt;
+  reset();
+}
+
+/**
+ * Run one sample of the controller, assuming sample_time has gone by since
+ * the last one
+ */
+double DiscretePID::update(double sensor_val) {
+  const double h = dconfig.sample_time;
+  this->sensor_val = sensor_val;
+
+  // Bumpless gain changes: move whatever the proportional term would jump by
+  // into the integral
+  if (config.p != last_p) {
+    i_term += (last_p - config.p) * weighted_error();
+    last_p = config.p;
+  }
+
+  p_term = config.p * weighted_error();
+
+  // Derivative on measurement, through a first order low pass
+  double dy = first_sample ? 0 : wrap_diff(last_sensor_val, sensor_val);
+  double tf = 0;
+  if (dconfig.d_cutoff_hz > 0) {
+    tf = 1.0 / (2.0 * M_PI * dconfig.d_cutoff_hz);
+  }
+  d_term = (tf / (tf + h)) * d_term - (config.d / (tf + h)) * dy;
+
+  double unclamped = p_term + i_term + d_term;
+  out = unclamped;
+  bool limits_exist = lower_limit != 0 || upper_limit != 0;
+  if (limits_exist) {
+    out = (out < lower_limit)   ? lower_limit
+          : (out > upper_limit) ? upper_limit
+                                : out;
+  }
+
+  // Integrate, and bleed off however much the output got clamped
+  // (back-calculation anti-windup)
+  if (config.i != 0) {
+    double tt = dconfig.tracking_time;
+    if (tt <= 0) {
+      // sqrt(Ti*Td) if there's a D term, otherwise Ti
+      tt = (config.d != 0) ? sqrt(fabs(config.d / config.i))
+                           : fabs(config.p / config.i);
+    }
+    double tracking = (tt > h) ? h / tt : 1.0;
+    i_term += config.i * h * get_error() + tracking * (out - unclamped);
+  }
+
+  last_sensor_val = sensor_val;
+  first_sample = false;
+
+  if (fabs(get_error()) < config.deadband) {
+    on_target_samples++;
+  } else {
+    on_target_samples = 0;
+  }
+
+  return out;
+}
+
+/**
+ * Gets the output from when update() was last run
+ */
+double DiscretePID::get() { return out; }
+
+/**
+ * Set the limits on the output. If both are 0, no limits are applied
+ */
+void DiscretePID::set_limits(double lower, double upper) {
+  lower_limit = lower;
+  upper_limit = upper;
+}
+
+/**
+ * Returns true if the loop has been within [deadband] for [on_target_time]
+ * seconds worth of samples
+ */
+bool DiscretePID::is_on_target() {
+  if (on_target_samples == 0) {
+    return false;
+  }
+  if (target_vel != 0) {
+    return true;
+  }
+  return on_target_samples * dconfig.sample_time > config.on_target_time;
+}
+
+/**
+ * Reset the integral, derivative filter and on target counting
+ */
+void DiscretePID::reset() {
+  i_term = 0;
+  d_term = 0;
+  p_term = 0;
+  first_sample = true;
+  last_p = config.p;
+  on_target_samples = 0;
+}
+
+double DiscretePID::get_error() const { return wrap_diff(sensor_val, target); }
+
+double DiscretePID::get_target() const { return target; }
+
+/**
+ * Set the target without resetting. How much of the change shows up right
+ * away in the output is set by p_on_measurement
+ */
+void DiscretePID::set_target(double target) {
+  target_moved += wrap_diff(this->target, target);
+  this->target = target;
+}
+
+double DiscretePID::get_sensor_val() const { return sensor_val; }
+
+double DiscretePID::wrap_diff(double from, double to) const {
+  if (config.error_method == PID::ERROR_TYPE::ANGULAR) {
+    return OdometryBase::smallest_angle(from, to);
+  }
+  return to - from;
+}
+
+double DiscretePID::weighted_error() const {
+  return get_error() - dconfig.p_on_measurement * target_moved;
+}
@@ -1,4 +1,5 @@
 #include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/feedforward_estimator.h"
 
 
 /**
@@ -28,18 +29,22 @@ FeedForward::ff_config_t tune_feedforward(vex::motor_group &motor, double pct, d
 
 
     // ========== kV / kA Tuning =========
+    // kS is known now, so what's left of the output goes to kV*v + kA*a.
+    // Every sample goes straight into the estimator instead of being saved
+    // for a regression at the end
+    FeedForwardEstimator::estimator_config_t est_cfg = FeedForwardEstimator::default_config;
+    est_cfg.forgetting = 1.0; // one short run, remember all of it
+    FeedForwardEstimator est(FeedForwardEstimator::kV | FeedForwardEstimator::kA, est_cfg);
 
-    std::vector<std::pair<double, double>> vel_data_points; // time, velocity
-    std::vector<std::pair<double, double>> accel_data_points; // time, accel
-
-    double max_speed = 0;
     vex::timer tmr;
     double time = 0;
+    double last_speed = 0;
 
     MovingAverage vel_ma(3);
     MovingAverage accel_ma(3);
 
     // Move the robot forward at a fixed percentage for X seconds while taking velocity and accel measurements
+    motor.spin(vex::directionType::fwd, pct * 100, vex::percentUnits::pct);
     do
     {
         double last_time = time;
@@ -47,23 +52,15 @@ FeedForward::ff_config_t tune_feedforward(vex::motor_group &motor, double pct, d
         double dt = time - last_time;
 
         vel_ma.add_entry(motor.velocity(vex::velocityUnits::rpm));
-        accel_ma.add_entry(motor.velocity(vex::velocityUnits::rpm)/dt);
-
         double speed = vel_ma.get_value();
+        if(dt > 0)
+            accel_ma.add_entry((speed - last_speed) / dt);
+        last_speed = speed;
         double accel = accel_ma.get_value();
 
-        // For kV:
-        if(speed > max_speed) {
-            max_speed = speed;
-}
-
-        // For kA:
         // Filter out the acceleration dampening due to motor inductance
         if(time > 0.25)
-        {
-            vel_data_points.push_back(std::pair<double, double>(time, speed));
-            accel_data_points.push_back(std::pair<double, double>(time, accel));
-        }
+            est.add_sample(pct - out.kS, speed, accel);
 
         // Theoretical polling rate = 100hz (it won't be that much, cause, y'know, vex.)
         vexDelay(10); 
@@ -71,22 +68,9 @@ FeedForward::ff_config_t tune_feedforward(vex::motor_group &motor, double pct, d
 
     motor.stop();
 
-    // Calculate kV (volts/12 per unit per second)
-    out.kV = (pct - out.kS) / max_speed;
-
-    // Calculate kA (volts/12 per unit per second^2)
-    std::vector<std::pair<double, double>> accel_per_pct;
-    for (int i = 0; i < vel_data_points.size(); i++)
-    {
-        accel_per_pct.push_back(std::pair<double, double>(
-            pct - out.kS - (vel_data_points[i].second * out.kV),   // Acceleration-causing percent (X variable)
-            accel_data_points[i].second                            // Measured acceleration (Y variable)
-        ));
-    }
-    
-    // kA is the reciprocal of the slope of the linear regression
-    double regres_slope = calculate_linear_regression(accel_per_pct).first;
-    out.kA = 1.0 / regres_slope; 
+    FeedForward::ff_config_t fit = est.estimate();
+    out.kV = fit.kV;
+    out.kA = fit.kA;
 
     return out;
-}
\ No newline at end of file
+}
@@ -0,0 +1,186 @@
+#include "../core/include/utils/controls/feedforward_estimator.h"
+#include <cmath>
+#include <stdio.h>
+
+const FeedForwardEstimator::estimator_config_t
+    FeedForwardEstimator::default_config = {
+        0.998,  // forgetting
+        0.01,   // min_speed
+        0.1,    // rel_tolerance
+        0.001,  // abs_tolerance
+        100,    // min_samples
+        1000.0, // max_covariance
+};
+
+FeedForwardEstimator::FeedForwardEstimator(
+    int terms, const estimator_config_t &cfg,
+    const FeedForward::ff_config_t &initial)
+    : terms(terms), cfg(cfg) {
+    reset(initial);
+}
+
+void FeedForwardEstimator::reset(const FeedForward::ff_config_t &initial) {
+    mut.lock();
+    double guess[N] = {initial.kS, initial.kV, initial.kA, initial.kG};
+    for (int i = 0; i < N; i++) {
+        bool used = terms & (1 << i);
+        theta[i] = used ? guess[i] : 0;
+        for (int j = 0; j < N; j++) {
+            // Start out very unsure about everything we're estimating
+            P[i][j] = (i == j && used) ? cfg.max_covariance : 0;
+        }
+    }
+    noise_var = 0;
+    noise_weight = 0;
+    num_samples = 0;
+    mut.unlock();
+}
+
+void FeedForwardEstimator::regressor(double vel, double accel,
+                                     double phi[N]) const {
+    double sgn = (vel > 0) ? 1.0 : ((vel < 0) ? -1.0 : 0.0);
+    phi[0] = (terms & kS) ? sgn : 0;
+    phi[1] = (terms & kV) ? vel : 0;
+    phi[2] = (terms & kA) ? accel : 0;
+    phi[3] = (terms & kG) ? 1.0 : 0;
+}
+
+bool FeedForwardEstimator::add_sample(double output, double vel,
+                                      double accel) {
+    if (fabs(vel) < cfg.min_speed) {
+        return false;
+    }
+
+    double phi[N];
+    regressor(vel, accel, phi);
+    double lambda = cfg.forgetting;
+
+    mut.lock();
+
+    // P * phi and phi' * P * phi
+    double Pphi[N];
+    double denom = lambda;
+    for (int i = 0; i < N; i++) {
+        Pphi[i] = 0;
+        for (int j = 0; j < N; j++) {
+            Pphi[i] += P[i][j] * phi[j];
+        }
+        denom += phi[i] * Pphi[i];
+    }
+
+    // How far off the prediction was before learning from this sample
+    double err = output;
+    for (int i = 0; i < N; i++) {
+        err -= phi[i] * theta[i];
+    }
+
+    // theta += K * err, with the gain K = P*phi / (lambda + phi'*P*phi)
+    double K[N];
+    for (int i = 0; i < N; i++) {
+        K[i] = Pphi[i] / denom;
+        theta[i] += K[i] * err;
+    }
+
+    // P = (P - K * phi' * P) / lambda. P is symmetric so phi'*P = (P*phi)'.
+    // Computing only the upper half and mirroring keeps it symmetric despite
+    // rounding
+    double trace = 0;
+    for (int i = 0; i < N; i++) {
+        for (int j = i; j < N; j++) {
+            double v = (P[i][j] - K[i] * Pphi[j]) / lambda;
+            P[i][j] = v;
+            P[j][i] = v;
+        }
+        trace += P[i][i];
+    }
+
+    // While the robot does the same thing for a long time (driving straight
+    // at full speed) forgetting keeps growing P. Cap it so the first
+    // interesting sample afterward doesn't swing the estimate wildly
+    double max_trace = cfg.max_covariance * N;
+    if (trace > max_trace) {
+        double scale = max_trace / trace;
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                P[i][j] *= scale;
+            }
+        }
+    }
+
+    // Average of err^2 that forgets at the same rate as the estimate
+    noise_weight = lambda * noise_weight + 1.0;
+    noise_var += (err * err - noise_var) / noise_weight;
+    num_samples++;
+
+    mut.unlock();
+    return true;
+}
+
+FeedForward::ff_config_t FeedForwardEstimator::estimate() const {
+    mut.lock();
+    FeedForward::ff_config_t out = {theta[0], theta[1], theta[2], theta[3]};
+    mut.unlock();
+    return out;
+}
+
+FeedForward::ff_config_t FeedForwardEstimator::bounds() const {
+    mut.lock();
+    // The estimate's covariance is about noise variance * P. Two standard
+    // deviations of that
+    double b[N];
+    for (int i = 0; i < N; i++) {
+        b[i] = (terms & (1 << i)) ? 2.0 * sqrt(noise_var * P[i][i]) : 0;
+    }
+    mut.unlock();
+    return {b[0], b[1], b[2], b[3]};
+}
+
+bool FeedForwardEstimator::converged() const {
+    if (num_samples < cfg.min_samples) {
+        return false;
+    }
+    FeedForward::ff_config_t est = estimate();
+    FeedForward::ff_config_t bnd = bounds();
+    double e[N] = {est.kS, est.kV, est.kA, est.kG};
+    double b[N] = {bnd.kS, bnd.kV, bnd.kA, bnd.kG};
+    for (int i = 0; i < N; i++) {
+        if (!(terms & (1 << i))) {
+            continue;
+        }
+        if (b[i] > cfg.abs_tolerance && b[i] > cfg.rel_tolerance * fabs(e[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FeedForwardEstimator::apply(FeedForward::ff_config_t &cfg) const {
+    if (!converged()) {
+        return false;
+    }
+    FeedForward::ff_config_t est = estimate();
+    if (terms & kS) {
+        cfg.kS = est.kS;
+    }
+    if (terms & kV) {
+        cfg.kV = est.kV;
+    }
+    if (terms & kA) {
+        cfg.kA = est.kA;
+    }
+    if (terms & kG) {
+        cfg.kG = est.kG;
+    }
+    return true;
+}
+
+void FeedForwardEstimator::print() const {
+    FeedForward::ff_config_t est = estimate();
+    FeedForward::ff_config_t bnd = bounds();
+    printf("ff estimate (%d samples%s)\n", num_samples,
+           converged() ? ", converged" : "");
+    printf("kS: %.5f +/- %.5f\n", est.kS, bnd.kS);
+    printf("kV: %.5f +/- %.5f\n", est.kV, bnd.kV);
+    printf("kA: %.5f +/- %.5f\n", est.kA, bnd.kA);
+    printf("kG: %.5f +/- %.5f\n", est.kG, bnd.kG);
+}
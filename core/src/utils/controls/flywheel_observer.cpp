@@ -0,0 +1,57 @@
+#include "../core/include/utils/controls/flywheel_observer.h"
+#include <cmath>
+
+FlywheelObserver::FlywheelObserver(observer_config_t &cfg) : cfg(cfg) {
+    reset(0);
+}
+
+void FlywheelObserver::reset(double rpm) {
+    this->rpm = rpm;
+    P = cfg.measurement_noise;
+    residual = 0;
+    boost_left = 0;
+    in_shot = false;
+}
+
+double FlywheelObserver::update(double measured_rpm, double output,
+                                double dt) {
+    if (dt <= 0) {
+        return rpm;
+    }
+
+    // Predict: the wheel heads toward output / kV with time constant tau.
+    // The motor can't give more than 12V however much it's asked for, and
+    // predicting more would look like a shot while spinning up
+    output = fmax(-1.0, fmin(1.0, output));
+    double target = cfg.kV != 0 ? output / cfg.kV : 0;
+    double a = cfg.tau > 0 ? fmin(dt / cfg.tau, 1.0) : 1.0;
+    double predicted = rpm + a * (target - rpm);
+    double P_pred = (1 - a) * (1 - a) * P + cfg.process_noise * dt;
+
+    residual = measured_rpm - predicted;
+    boost_left -= dt;
+
+    // Once a shot is detected, wait for the readings to line up with the
+    // model again before looking for the next one so one shot that lasts a
+    // few updates isn't counted several times
+    if (in_shot && residual > -cfg.shot_threshold_rpm / 2) {
+        in_shot = false;
+    }
+
+    // A drop far bigger than the wheel could do on its own is a shot. Skip
+    // the filtering and believe the reading, then start the boost
+    if (residual < -cfg.shot_threshold_rpm && !in_shot) {
+        in_shot = true;
+        shot_count++;
+        boost_left = cfg.boost_time;
+        rpm = measured_rpm;
+        P = cfg.measurement_noise;
+        return rpm;
+    }
+
+    // Correct toward the reading
+    double K = P_pred / (P_pred + cfg.measurement_noise);
+    rpm = predicted + K * residual;
+    P = (1 - K) * P_pred;
+    return rpm;
+}
@@ -0,0 +1,263 @@
+#include "../core/include/utils/controls/gain_schedule.h"
+#include "../core/include/subsystems/screen.h"
+#include <algorithm>
+#include <cmath>
+
+static bool before(const GainSchedule::breakpoint_t &a,
+                   const GainSchedule::breakpoint_t &b) {
+    return a.at < b.at;
+}
+
+GainSchedule::GainSchedule(const std::vector<breakpoint_t> &breakpoints,
+                           ScheduleBy by, std::function<double()> custom)
+    : points(breakpoints), by(by), custom(custom), cur_pid(), cur_ff(),
+      pidff(cur_pid, cur_ff) {
+    if (points.empty()) {
+        printf("GainSchedule: no breakpoints, every gain will be 0\n");
+        points.push_back(breakpoint_t{0, PID::pid_config_t{}, {0, 0, 0, 0}});
+    }
+    std::stable_sort(points.begin(), points.end(), before);
+    schedule(points[0].at);
+}
+
+void GainSchedule::add_breakpoint(const breakpoint_t &bp) {
+    points.insert(std::upper_bound(points.begin(), points.end(), bp, before),
+                  bp);
+}
+
+double GainSchedule::schedule_value(double val) const {
+    switch (by) {
+    case ScheduleBy::Measurement:
+        return val;
+    case ScheduleBy::Setpoint:
+        return pidff.get_target();
+    case ScheduleBy::DistanceRemaining:
+        return fabs(pidff.get_target() - val);
+    case ScheduleBy::Custom:
+        return custom ? custom() : 0;
+    }
+    return val;
+}
+
+void GainSchedule::schedule(double x) {
+    sched_val = x;
+
+    // Find the breakpoints on either side of x. Past the ends, use the end
+    size_t hi = 0;
+    while (hi < points.size() && points[hi].at < x) {
+        hi++;
+    }
+    const breakpoint_t &a = points[hi == 0 ? 0 : hi - 1];
+    const breakpoint_t &b = points[hi == points.size() ? hi - 1 : hi];
+
+    double span = b.at - a.at;
+    double t = span > 0 ? (x - a.at) / span : 0;
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+
+    auto lerp = [t](double from, double to) { return from + t * (to - from); };
+    cur_pid.p = lerp(a.pid.p, b.pid.p);
+    cur_pid.i = lerp(a.pid.i, b.pid.i);
+    cur_pid.d = lerp(a.pid.d, b.pid.d);
+    cur_pid.deadband = points[0].pid.deadband;
+    cur_pid.on_target_time = points[0].pid.on_target_time;
+    cur_pid.error_method = points[0].pid.error_method;
+
+    cur_ff.kS = lerp(a.ff.kS, b.ff.kS);
+    cur_ff.kV = lerp(a.ff.kV, b.ff.kV);
+    cur_ff.kA = lerp(a.ff.kA, b.ff.kA);
+    cur_ff.kG = lerp(a.ff.kG, b.ff.kG);
+}
+
+void GainSchedule::init(double start_pt, double set_pt, double start_vel,
+                        double end_vel) {
+    pidff.init(start_pt, set_pt, start_vel, end_vel);
+    schedule(schedule_value(start_pt));
+}
+
+double GainSchedule::update(double val) {
+    schedule(schedule_value(val));
+    return pidff.update(val);
+}
+
+double GainSchedule::update(double val, double vel_setpt, double a_setpt) {
+    schedule(schedule_value(val));
+    return pidff.update(val, vel_setpt, a_setpt);
+}
+
+double GainSchedule::get() { return pidff.get(); }
+
+void GainSchedule::set_limits(double lower, double upper) {
+    pidff.set_limits(lower, upper);
+}
+
+bool GainSchedule::is_on_target() { return pidff.is_on_target(); }
+
+void GainSchedule::set_target(double set_pt) { pidff.set_target(set_pt); }
+
+void GainSchedule::save(Serializer &s, const std::string &name) const {
+    s.set_int(name + "_count", (int)points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        const breakpoint_t &bp = points[i];
+        std::string pre = name + "_" + std::to_string(i);
+        s.set_double(pre + "_at", bp.at);
+        s.set_double(pre + "_p", bp.pid.p);
+        s.set_double(pre + "_i", bp.pid.i);
+        s.set_double(pre + "_d", bp.pid.d);
+        s.set_double(pre + "_kS", bp.ff.kS);
+        s.set_double(pre + "_kV", bp.ff.kV);
+        s.set_double(pre + "_kA", bp.ff.kA);
+        s.set_double(pre + "_kG", bp.ff.kG);
+    }
+}
+
+void GainSchedule::load(Serializer &s, const std::string &name) {
+    int count = s.int_or(name + "_count", (int)points.size());
+    if (count < 1) {
+        return;
+    }
+    // New breakpoints start as copies of the last one
+    points.resize(count, points.back());
+    for (size_t i = 0; i < points.size(); i++) {
+        breakpoint_t &bp = points[i];
+        std::string pre = name + "_" + std::to_string(i);
+        bp.at = s.double_or(pre + "_at", bp.at);
+        bp.pid.p = s.double_or(pre + "_p", bp.pid.p);
+        bp.pid.i = s.double_or(pre + "_i", bp.pid.i);
+        bp.pid.d = s.double_or(pre + "_d", bp.pid.d);
+        bp.ff.kS = s.double_or(pre + "_kS", bp.ff.kS);
+        bp.ff.kV = s.double_or(pre + "_kV", bp.ff.kV);
+        bp.ff.kA = s.double_or(pre + "_kA", bp.ff.kA);
+        bp.ff.kG = s.double_or(pre + "_kG", bp.ff.kG);
+    }
+    std::stable_sort(points.begin(), points.end(), before);
+}
+
+/**
+ * Pick a breakpoint with < and >, a gain with Gain, then nudge it with - and
+ * + (10% at a time, or up to 0.01 if it's 0)
+ */
+class GainSchedulePage : public screen::Page {
+  public:
+    GainSchedulePage(GainSchedule &sched, Serializer *s,
+                     const std::string &name)
+        : sched(sched), s(s), name(name),
+          prev_button([this]() { move(-1); }, Rect{{20, 190}, {70, 230}}, "<"),
+          next_button([this]() { move(1); }, Rect{{75, 190}, {125, 230}}, ">"),
+          field_button([this]() { field = (field + 1) % num_fields; },
+                       Rect{{130, 190}, {200, 230}}, "Gain"),
+          minus_button([this]() { nudge(false); }, Rect{{205, 190}, {255, 230}},
+                       "-"),
+          plus_button([this]() { nudge(true); }, Rect{{260, 190}, {310, 230}},
+                      "+"),
+          save_button([this]() { save(); }, Rect{{315, 190}, {385, 230}},
+                      "Save") {}
+
+    void update(bool was_pressed, int x, int y) override {
+        prev_button.update(was_pressed, x, y);
+        next_button.update(was_pressed, x, y);
+        field_button.update(was_pressed, x, y);
+        minus_button.update(was_pressed, x, y);
+        plus_button.update(was_pressed, x, y);
+        save_button.update(was_pressed, x, y);
+    }
+
+    bool updates_in_background() const override { return false; }
+
+    void draw(screen::Canvas &scr, bool first_draw,
+              unsigned int frame) override {
+        std::vector<GainSchedule::breakpoint_t> &pts = sched.get_breakpoints();
+        if (selected >= pts.size()) {
+            selected = pts.size() - 1;
+        }
+        GainSchedule::breakpoint_t &bp = pts[selected];
+
+        scr.setPenColor(vex::white);
+        scr.printAt(20, 20, true, "%s  %d/%d  at %.2f   now %.2f", name.c_str(),
+                    (int)selected + 1, (int)pts.size(), bp.at,
+                    sched.get_schedule_value());
+
+        const double vals[num_fields] = {bp.pid.p, bp.pid.i, bp.pid.d,
+                                         bp.ff.kS, bp.ff.kV, bp.ff.kA,
+                                         bp.ff.kG};
+        const double live[num_fields] = {
+            sched.current_pid().p, sched.current_pid().i,
+            sched.current_pid().d, sched.current_ff().kS,
+            sched.current_ff().kV, sched.current_ff().kA,
+            sched.current_ff().kG};
+        for (int i = 0; i < num_fields; i++) {
+            scr.setPenColor(i == field ? vex::yellow : vex::white);
+            scr.printAt(20, 45 + i * 20, true, "%s%-3s %9.4f   (now %9.4f)",
+                        i == field ? ">" : " ", field_names[i], vals[i],
+                        live[i]);
+        }
+
+        prev_button.draw(scr, first_draw, frame);
+        next_button.draw(scr, first_draw, frame);
+        field_button.draw(scr, first_draw, frame);
+        minus_button.draw(scr, first_draw, frame);
+        plus_button.draw(scr, first_draw, frame);
+        save_button.draw(scr, first_draw, frame);
+    }
+
+  private:
+    static const int num_fields = 7;
+    static constexpr const char *field_names[num_fields] = {
+        "P", "I", "D", "kS", "kV", "kA", "kG"};
+
+    void move(int by) {
+        int n = (int)sched.get_breakpoints().size();
+        selected = (size_t)(((int)selected + by + n) % n);
+    }
+
+    double &field_ref(GainSchedule::breakpoint_t &bp) {
+        switch (field) {
+        case 0:
+            return bp.pid.p;
+        case 1:
+            return bp.pid.i;
+        case 2:
+            return bp.pid.d;
+        case 3:
+            return bp.ff.kS;
+        case 4:
+            return bp.ff.kV;
+        case 5:
+            return bp.ff.kA;
+        default:
+            return bp.ff.kG;
+        }
+    }
+
+    void nudge(bool up) {
+        double &v = field_ref(sched.get_breakpoints()[selected]);
+        if (v == 0) {
+            v = up ? 0.01 : 0;
+        } else {
+            v *= up ? 1.1 : 1.0 / 1.1;
+        }
+    }
+
+    void save() {
+        if (s != nullptr) {
+            sched.save(*s, name);
+        }
+    }
+
+    GainSchedule &sched;
+    Serializer *s;
+    std::string name;
+    size_t selected = 0;
+    int field = 0;
+
+    screen::ButtonWidget prev_button;
+    screen::ButtonWidget next_button;
+    screen::ButtonWidget field_button;
+    screen::ButtonWidget minus_button;
+    screen::ButtonWidget plus_button;
+    screen::ButtonWidget save_button;
+};
+constexpr const char *GainSchedulePage::field_names[];
+
+screen::Page *GainSchedule::Page(Serializer *s, const std::string &name) {
+    return new GainSchedulePage(*this, s, name);
+}
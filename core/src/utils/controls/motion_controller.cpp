@@ -1,4 +1,5 @@
 #include "../core/include/utils/controls/motion_controller.h"
+#include "../core/include/utils/controls/feedforward_estimator.h"
 #include "../core/include/subsystems/screen.h"
 #include "../core/include/utils/math_util.h"
 #include <vector>
@@ -93,13 +94,10 @@ motion_t MotionController::get_motion() const { return cur_motion; }
  * tune the feedforward. It does this by first calculating the kS (voltage to
  * overcome static friction) by slowly increasing the voltage until it moves.
  *
- * Next is kV (voltage to sustain a certain velocity), where the robot will
- * record it's steady-state velocity at 'pct' speed.
- *
- * Finally, kA (voltage needed to accelerate by a certain rate), where the robot
- * will record the entire movement's velocity and acceleration, record a plot of
- * [X=(pct-kV*V-kS), Y=(Acceleration)] along the movement, and since kA*Accel =
- * pct-kV*V-kS, the reciprocal of the linear regression is the kA value.
+ * Next are kV (voltage to sustain a certain velocity) and kA (voltage needed
+ * to accelerate by a certain rate). The robot drives at 'pct' and every
+ * velocity and acceleration measurement along the way is fed to a
+ * FeedForwardEstimator, which fits pct-kS = kV*V + kA*Accel as it goes.
  *
  * @param drive The tankdrive to operate on
  * @param odometry The robot's odometry subsystem
@@ -126,9 +124,14 @@ MotionController::tune_feedforward(TankDrive &drive, OdometryTank &odometry,
     drive.stop();
 
     // ========== kV / kA Tuning =========
-
-    std::vector<std::pair<double, double>> vel_data_points;   // time, velocity
-    std::vector<std::pair<double, double>> accel_data_points; // time, accel
+    // kS is known now, so what's left of the output goes to kV*v + kA*a.
+    // Every sample goes straight into the estimator instead of being saved
+    // for a regression at the end
+    FeedForwardEstimator::estimator_config_t est_cfg =
+        FeedForwardEstimator::default_config;
+    est_cfg.forgetting = 1.0; // one short run, remember all of it
+    FeedForwardEstimator est(
+        FeedForwardEstimator::kV | FeedForwardEstimator::kA, est_cfg);
 
     double max_speed = 0;
     double max_accel = 0;
@@ -150,7 +153,6 @@ MotionController::tune_feedforward(TankDrive &drive, OdometryTank &odometry,
 
         double speed = vel_ma.get_value();
         double accel = accel_ma.get_value();
-        // For kV:
         if (speed > max_speed) {
             max_speed = speed;
         }
@@ -158,11 +160,9 @@ MotionController::tune_feedforward(TankDrive &drive, OdometryTank &odometry,
             max_accel = accel;
         }
 
-        // For kA:
         // Filter out the acceleration dampening due to motor inductance
         if (time > 0.25) {
-            vel_data_points.push_back(std::pair<double, double>(time, speed));
-            accel_data_points.push_back(std::pair<double, double>(time, accel));
+            est.add_sample(pct - out.kS, speed, accel);
         }
 
         // Theoretical polling rate = 100hz (it won't be that much, cause,
@@ -172,26 +172,13 @@ MotionController::tune_feedforward(TankDrive &drive, OdometryTank &odometry,
 
     drive.stop();
 
-    // Calculate kV (volts/12 per unit per second)
-    out.kV = (pct - out.kS) / max_speed;
-
     printf("Max speed achieved: %.4f\n", max_speed);
     printf("Max accel achieved: %.4f\n", max_accel);
+    est.print();
 
-    // Calculate kA (volts/12 per unit per second^2)
-    std::vector<std::pair<double, double>> accel_per_pct;
-    for (int i = 0; i < vel_data_points.size(); i++) {
-        accel_per_pct.push_back(std::pair<double, double>(
-            pct - out.kS -
-                (vel_data_points[i].second *
-                 out.kV), // Acceleration-causing percent (X variable)
-            accel_data_points[i].second // Measured acceleration (Y variable)
-            ));
-    }
-
-    // kA is the reciprocal of the slope of the linear regression
-    double regres_slope = calculate_linear_regression(accel_per_pct).first;
-    out.kA = 1.0 / regres_slope;
+    FeedForward::ff_config_t fit = est.estimate();
+    out.kV = fit.kV;
+    out.kA = fit.kA;
 
     return out;
 }
@@ -201,7 +188,8 @@ class MotionControllerPage : public screen::Page {
     MotionControllerPage(const MotionController &mc) : mc(mc) {}
 
     void update(bool was_pressed, int x, int y) override {}
-    void draw(vex::brain::lcd &screen, bool first_draw,
+    bool updates_in_background() const override { return false; }
+    void draw(screen::Canvas &screen, bool first_draw,
               unsigned int frame_number) {
         const motion_t mot = mc.get_motion();
 
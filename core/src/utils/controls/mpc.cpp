@@ -0,0 +1,261 @@
+#include "../core/include/utils/controls/mpc.h"
+#include <cmath>
+#include <stdio.h>
+
+MPC::MPC(const mpc_config_t &config)
+    : profile(config.max_v, config.accel) {
+    reconfigure(config);
+}
+
+/**
+ * Discretize the model and build everything about the optimization that
+ * doesn't depend on where the mechanism is or where it's going
+ */
+void MPC::reconfigure(const mpc_config_t &config) {
+    cfg = config;
+    if (cfg.horizon > max_horizon) {
+        printf("MPC: horizon %d is more than max_horizon, using %d\n",
+               cfg.horizon, max_horizon);
+        cfg.horizon = max_horizon;
+    }
+    if (cfg.horizon < 1) {
+        cfg.horizon = 1;
+    }
+    if (cfg.model.kA <= 0) {
+        printf("MPC: kA must be more than 0, the model can't predict "
+               "anything without it\n");
+        cfg.model.kA = 1e-3;
+    }
+
+    use_profile = cfg.max_v > 0 && cfg.accel > 0;
+    if (use_profile) {
+        profile.set_max_v(cfg.max_v);
+        profile.set_accel(cfg.accel);
+    }
+
+    // a = (u - d - kV*v) / kA. Exact over one dt assuming u is held
+    double dt = cfg.dt;
+    double beta = 1.0 / cfg.model.kA;
+    double alpha = cfg.model.kV / cfg.model.kA;
+    if (alpha > 1e-9) {
+        double e = exp(-alpha * dt);
+        a22 = e;
+        a12 = (1 - e) / alpha;
+        b2 = beta * (1 - e) / alpha;
+        b1 = beta * (dt / alpha - (1 - e) / (alpha * alpha));
+    } else {
+        a22 = 1;
+        a12 = dt;
+        b2 = beta * dt;
+        b1 = 0.5 * beta * dt * dt;
+    }
+
+    // A^m = [1, a12*(1 + a22 + ... + a22^(m-1)); 0, a22^m]
+    int n = cfg.horizon;
+    double geo[N + 1]; // 1 + a22 + ... + a22^(m-1) for m = 0..N
+    double pow22[N + 1];
+    geo[0] = 0;
+    pow22[0] = 1;
+    for (int m = 1; m <= n; m++) {
+        geo[m] = geo[m - 1] + pow22[m - 1];
+        pow22[m] = pow22[m - 1] * a22;
+    }
+
+    for (int k = 0; k < n; k++) {
+        // starting state to step k+1
+        Ap12[k] = a12 * geo[k + 1];
+        Av22[k] = pow22[k + 1];
+        // input j to step k+1 is A^(k-j) B
+        for (int j = 0; j < n; j++) {
+            if (j <= k) {
+                int m = k - j;
+                Gp[k][j] = b1 + a12 * geo[m] * b2;
+                Gv[k][j] = pow22[m] * b2;
+            } else {
+                Gp[k][j] = 0;
+                Gv[k][j] = 0;
+            }
+        }
+    }
+
+    // H = G' Q G + r I
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double h = (i == j) ? cfg.r : 0;
+            int first = i > j ? i : j;
+            for (int k = first; k < n; k++) {
+                h += cfg.q_pos * Gp[k][i] * Gp[k][j] +
+                     cfg.q_vel * Gv[k][i] * Gv[k][j];
+            }
+            H[i][j] = h;
+        }
+    }
+
+    // Gradient descent is stable with a step of 1/(largest eigenvalue of H).
+    // The biggest row sum is never smaller than that
+    double L = 0;
+    for (int i = 0; i < n; i++) {
+        double row = 0;
+        for (int j = 0; j < n; j++) {
+            row += fabs(H[i][j]);
+        }
+        L = row > L ? row : L;
+    }
+    step = L > 0 ? 1.0 / L : 0;
+
+    for (int i = 0; i < N; i++) {
+        U[i] = 0;
+    }
+}
+
+void MPC::init(double start_pt, double set_pt, double start_vel,
+               double end_vel) {
+    target = set_pt;
+    this->end_vel = end_vel;
+    if (use_profile) {
+        profile.set_endpts(start_pt, set_pt);
+        profile.set_vel_endpts(start_vel, end_vel);
+    }
+
+    last_pos = start_pt;
+    cur_pos = start_pt;
+    est_vel = start_vel;
+    in_deadband = false;
+    for (int i = 0; i < N; i++) {
+        U[i] = 0;
+    }
+
+    tmr.reset();
+    last_time = 0;
+    on_target_since = 0;
+}
+
+void MPC::build_reference() {
+    double t = tmr.time(vex::sec);
+    for (int k = 0; k <= cfg.horizon; k++) {
+        if (use_profile) {
+            ref[k] = profile.calculate_time_based(t + k * cfg.dt);
+        } else {
+            ref[k] = {target, 0, 0};
+        }
+    }
+}
+
+void MPC::solve(double pos, double vel) {
+    int n = cfg.horizon;
+    const FeedForward::ff_config_t &m = cfg.model;
+
+    // The part of the output that goes to kS and kG, assumed from the
+    // direction of the reference
+    for (int j = 0; j < n; j++) {
+        double v = ref[j].vel;
+        double sgn = (v > 0) ? 1.0 : ((v < 0) ? -1.0 : 0.0);
+        d[j] = m.kS * sgn + m.kG;
+    }
+
+    // g = G' Q (free response - reference) - r * feedforward. The free
+    // response is where we'd be with u = 0 the whole way: coasting from the
+    // current state with kS and kG (d) still acting, hence the -G*d
+    for (int i = 0; i < n; i++) {
+        double ff = d[i] + m.kV * ref[i].vel + m.kA * ref[i].accel;
+        g[i] = -cfg.r * ff;
+    }
+    for (int k = 0; k < n; k++) {
+        double fp = pos + Ap12[k] * vel;
+        double fv = Av22[k] * vel;
+        for (int j = 0; j <= k; j++) {
+            fp -= Gp[k][j] * d[j];
+            fv -= Gv[k][j] * d[j];
+        }
+        double ep = cfg.q_pos * (fp - ref[k + 1].pos);
+        double ev = cfg.q_vel * (fv - ref[k + 1].vel);
+        for (int i = 0; i <= k; i++) {
+            g[i] += Gp[k][i] * ep + Gv[k][i] * ev;
+        }
+    }
+
+    bool limited = lower != upper;
+
+    // Warm start from last time's answer, moved forward a step
+    for (int i = 0; i < n - 1; i++) {
+        U[i] = U[i + 1];
+    }
+    for (int i = 0; i < n; i++) {
+        Y[i] = U[i];
+    }
+
+    // Accelerated projected gradient descent (FISTA), minimizing
+    // 1/2 U'HU + g'U with lower <= U <= upper
+    double t = 1;
+    for (int it = 0; it < cfg.iterations; it++) {
+        for (int i = 0; i < n; i++) {
+            double gr = g[i];
+            for (int j = 0; j < n; j++) {
+                gr += H[i][j] * Y[j];
+            }
+            grad[i] = gr;
+        }
+
+        double t_next = (1 + sqrt(1 + 4 * t * t)) / 2;
+        double momentum = (t - 1) / t_next;
+        for (int i = 0; i < n; i++) {
+            U_last[i] = U[i];
+            double u = Y[i] - step * grad[i];
+            if (limited) {
+                u = u < lower ? lower : (u > upper ? upper : u);
+            }
+            U[i] = u;
+            Y[i] = u + momentum * (u - U_last[i]);
+        }
+        t = t_next;
+    }
+}
+
+double MPC::update(double val) {
+    double now = tmr.time(vex::sec);
+    double dt = now - last_time;
+    if (dt > 0) {
+        // light filtering, differentiating position is noisy
+        est_vel = 0.5 * est_vel + 0.5 * (val - last_pos) / dt;
+    }
+    last_pos = val;
+    last_time = now;
+    return update(val, est_vel);
+}
+
+double MPC::update(double pos, double vel) {
+    uint64_t start_us = vex::timer::systemHighResolution();
+
+    cur_pos = pos;
+    build_reference();
+    solve(pos, vel);
+    out = U[0];
+
+    double now = tmr.time(vex::sec);
+    bool within = fabs(target - pos) < cfg.deadband;
+    if (within && !in_deadband) {
+        on_target_since = now;
+    }
+    in_deadband = within;
+
+    solve_us = (uint32_t)(vex::timer::systemHighResolution() - start_us);
+    return out;
+}
+
+double MPC::get() { return out; }
+
+void MPC::set_limits(double lower, double upper) {
+    this->lower = lower;
+    this->upper = upper;
+}
+
+bool MPC::is_on_target() {
+    double now = tmr.time(vex::sec);
+    if (use_profile && now < profile.get_movement_time()) {
+        return false;
+    }
+    if (!in_deadband) {
+        return false;
+    }
+    return end_vel != 0 || now - on_target_since > cfg.on_target_time;
+}
@@ -0,0 +1,335 @@
+#include "../core/include/utils/controls/relay_autotuner.h"
+#include "../core/include/subsystems/screen.h"
+#include <cmath>
+
+RelayAutotuner::RelayAutotuner(std::function<double()> sensor,
+                               std::function<void(double)> actuator,
+                               double setpoint, double amplitude, double bias,
+                               int cycles)
+    : sensor(sensor), actuator(actuator), setpoint(setpoint),
+      amplitude(amplitude), start_bias(bias), cycles_wanted(cycles),
+      relay(0, bias - amplitude, bias + amplitude),
+      task("autotune", period_ms, 0, [this]() {
+          double out = update(this->sensor(), tmr.value());
+          if (done()) {
+              this->actuator(0);
+              task.stop();
+              return;
+          }
+          this->actuator(out);
+      }) {}
+
+void RelayAutotuner::begin(double sensor_val, double now) {
+    bias = start_bias;
+    relay.set_limits(bias - amplitude, bias + amplitude);
+    relay.init(sensor_val, setpoint);
+
+    above = sensor_val > setpoint;
+    last_switch = now;
+    time_high = 0;
+    time_low = 0;
+    last_rise = -1;
+    cycle_max = sensor_val;
+    cycle_min = sensor_val;
+    cycles = 0;
+    sum_period = 0;
+    sum_amplitude = 0;
+    sum_bias = 0;
+    measured = 0;
+}
+
+double RelayAutotuner::update(double sensor_val, double now) {
+    if (done()) {
+        return 0;
+    }
+
+    cycle_max = fmax(cycle_max, sensor_val);
+    cycle_min = fmin(cycle_min, sensor_val);
+
+    bool now_above = sensor_val > setpoint;
+    if (now_above != above) {
+        // the relay was low while we were above, high while below
+        if (above) {
+            time_low += now - last_switch;
+        } else {
+            time_high += now - last_switch;
+        }
+        last_switch = now;
+        above = now_above;
+
+        // a full cycle goes from one upward crossing to the next
+        if (now_above) {
+            if (last_rise >= 0) {
+                cycles++;
+                // The first cycle still has the mechanism getting up to the
+                // setpoint in it, don't count it
+                if (cycles > 1) {
+                    sum_period += now - last_rise;
+                    sum_amplitude += (cycle_max - cycle_min) / 2.0;
+                    sum_bias += bias;
+                    measured++;
+                }
+
+                // Spending more time pushing up than down means it takes
+                // more than bias to hold the setpoint. Nudge the bias
+                double total = time_high + time_low;
+                if (total > 0) {
+                    bias += 0.5 * amplitude * (time_high - time_low) / total;
+                    relay.set_limits(bias - amplitude, bias + amplitude);
+                }
+            }
+            last_rise = now;
+            time_high = 0;
+            time_low = 0;
+            cycle_max = sensor_val;
+            cycle_min = sensor_val;
+        }
+    }
+
+    return relay.update(sensor_val);
+}
+
+bool RelayAutotuner::done() const { return measured >= cycles_wanted; }
+
+int RelayAutotuner::cycles_seen() const { return cycles; }
+
+RelayAutotuner::result_t RelayAutotuner::result() const {
+    result_t r = {0, 0, 0, 0, false};
+    if (measured == 0) {
+        return r;
+    }
+    r.amplitude = sum_amplitude / measured;
+    r.tu = sum_period / measured;
+    r.mean_output = sum_bias / measured;
+    if (r.amplitude > 0) {
+        r.ku = 4.0 * amplitude / (M_PI * r.amplitude);
+    }
+    r.valid = done() && r.amplitude > 0;
+    return r;
+}
+
+PID::pid_config_t RelayAutotuner::pid_gains(Rule rule,
+                                            const PID::pid_config_t &base)
+    const {
+    PID::pid_config_t cfg = base;
+    result_t r = result();
+    if (!r.valid) {
+        return cfg;
+    }
+
+    // kp as a fraction of Ku, Ti and Td as fractions of Tu
+    double kp = 0, ti = 0, td = 0;
+    switch (rule) {
+    case Rule::ZieglerNichols:
+        kp = 0.6 * r.ku;
+        ti = 0.5 * r.tu;
+        td = 0.125 * r.tu;
+        break;
+    case Rule::TyreusLuyben:
+        kp = r.ku / 2.2;
+        ti = 2.2 * r.tu;
+        td = r.tu / 6.3;
+        break;
+    case Rule::PessenIntegral:
+        kp = 0.7 * r.ku;
+        ti = 0.4 * r.tu;
+        td = 0.15 * r.tu;
+        break;
+    case Rule::SomeOvershoot:
+        kp = 0.33 * r.ku;
+        ti = 0.5 * r.tu;
+        td = 0.33 * r.tu;
+        break;
+    case Rule::NoOvershoot:
+        kp = 0.2 * r.ku;
+        ti = 0.5 * r.tu;
+        td = 0.33 * r.tu;
+        break;
+    case Rule::ZieglerNicholsPI:
+        kp = 0.45 * r.ku;
+        ti = r.tu / 1.2;
+        td = 0;
+        break;
+    }
+
+    cfg.p = kp;
+    cfg.i = (ti > 0) ? kp / ti : 0;
+    cfg.d = kp * td;
+    return cfg;
+}
+
+FeedForward::ff_config_t
+RelayAutotuner::ff_gains(bool velocity_loop,
+                         const FeedForward::ff_config_t &base) const {
+    FeedForward::ff_config_t cfg = base;
+    result_t r = result();
+    if (!r.valid) {
+        return cfg;
+    }
+    if (velocity_loop) {
+        if (setpoint != 0) {
+            cfg.kV = r.mean_output / setpoint;
+        }
+    } else {
+        cfg.kG = r.mean_output;
+    }
+    return cfg;
+}
+
+void RelayAutotuner::save(Serializer &s, const std::string &name,
+                          const PID::pid_config_t &cfg) {
+    s.set_double(name + "_p", cfg.p);
+    s.set_double(name + "_i", cfg.i);
+    s.set_double(name + "_d", cfg.d);
+}
+
+void RelayAutotuner::load(Serializer &s, const std::string &name,
+                          PID::pid_config_t &cfg) {
+    cfg.p = s.double_or(name + "_p", cfg.p);
+    cfg.i = s.double_or(name + "_i", cfg.i);
+    cfg.d = s.double_or(name + "_d", cfg.d);
+}
+
+void RelayAutotuner::start() {
+    if (task.running()) {
+        return;
+    }
+    begin(sensor(), tmr.value());
+    task.start();
+}
+
+void RelayAutotuner::stop() {
+    task.stop();
+    actuator(0);
+}
+
+bool RelayAutotuner::running() const { return task.running(); }
+
+const char *RelayAutotuner::rule_name(Rule rule) {
+    switch (rule) {
+    case Rule::ZieglerNichols:
+        return "Ziegler-Nichols";
+    case Rule::TyreusLuyben:
+        return "Tyreus-Luyben";
+    case Rule::PessenIntegral:
+        return "Pessen";
+    case Rule::SomeOvershoot:
+        return "Some overshoot";
+    case Rule::NoOvershoot:
+        return "No overshoot";
+    case Rule::ZieglerNicholsPI:
+        return "ZN PI";
+    }
+    return "Unknown rule";
+}
+
+AutoCommand *RelayAutotuner::TuneCmd(Rule rule, PID::pid_config_t &cfg,
+                                     Serializer *s, const std::string &name) {
+    return new FunctionCommand([this, rule, &cfg, s, name]() {
+        if (!running() && !done()) {
+            start();
+            return false;
+        }
+        if (!done()) {
+            return false;
+        }
+        cfg = pid_gains(rule, cfg);
+        if (s != nullptr) {
+            save(*s, name, cfg);
+        }
+        return true;
+    });
+}
+
+class RelayAutotunerPage : public screen::Page {
+  public:
+    RelayAutotunerPage(RelayAutotuner &tuner, PID::pid_config_t &cfg,
+                       Serializer *s, const std::string &name)
+        : tuner(tuner), cfg(cfg), s(s), name(name),
+          start_button([this]() { toggle(); }, Rect{{50, 190}, {130, 230}},
+                       "Start"),
+          rule_button([this]() { next_rule(); }, Rect{{140, 190}, {220, 230}},
+                      "Rule"),
+          apply_button([this]() { apply(); }, Rect{{230, 190}, {310, 230}},
+                       "Apply"),
+          save_button([this]() { save(); }, Rect{{320, 190}, {400, 230}},
+                      "Save"),
+          graph(40, 0, 0, {vex::red, vex::green}, 2) {}
+
+    void update(bool was_pressed, int x, int y) override {
+        start_button.update(was_pressed, x, y);
+        rule_button.update(was_pressed, x, y);
+        apply_button.update(was_pressed, x, y);
+        save_button.update(was_pressed, x, y);
+    }
+
+    bool updates_in_background() const override { return false; }
+
+    void draw(screen::Canvas &scr, bool first_draw,
+              unsigned int frame) override {
+        RelayAutotuner::result_t r = tuner.result();
+        PID::pid_config_t proposed = tuner.pid_gains(rule, cfg);
+
+        scr.printAt(50, 20, true, "%s", name.c_str());
+        scr.printAt(50, 45, true, "%s",
+                    tuner.running() ? "running"
+                    : tuner.done()  ? "done"
+                                    : "stopped");
+        scr.printAt(50, 65, true, "cycles: %d", tuner.cycles_seen());
+        scr.printAt(50, 85, true, "Ku: %.3f", r.ku);
+        scr.printAt(50, 105, true, "Tu: %.3fs", r.tu);
+        scr.printAt(50, 125, true, "%s", RelayAutotuner::rule_name(rule));
+        scr.printAt(50, 145, true, "P %.3f I %.3f D %.3f", proposed.p,
+                    proposed.i, proposed.d);
+        scr.printAt(50, 165, true, "now P %.3f I %.3f D %.3f", cfg.p, cfg.i,
+                    cfg.d);
+
+        if (tuner.running()) {
+            graph.add_samples({tuner.setpoint, tuner.sensor()});
+        }
+        graph.draw(scr, 280, 20, 150, 120);
+
+        start_button.draw(scr, first_draw, frame);
+        rule_button.draw(scr, first_draw, frame);
+        apply_button.draw(scr, first_draw, frame);
+        save_button.draw(scr, first_draw, frame);
+    }
+
+  private:
+    void toggle() {
+        if (tuner.running()) {
+            tuner.stop();
+        } else {
+            tuner.start();
+        }
+    }
+    void next_rule() {
+        rule = (RelayAutotuner::Rule)(((int)rule + 1) %
+                                      ((int)RelayAutotuner::Rule::
+                                           ZieglerNicholsPI +
+                                       1));
+    }
+    void apply() { cfg = tuner.pid_gains(rule, cfg); }
+    void save() {
+        if (s != nullptr) {
+            RelayAutotuner::save(*s, name, cfg);
+        }
+    }
+
+    RelayAutotuner &tuner;
+    PID::pid_config_t &cfg;
+    Serializer *s;
+    std::string name;
+    RelayAutotuner::Rule rule = RelayAutotuner::Rule::ZieglerNichols;
+
+    screen::ButtonWidget start_button;
+    screen::ButtonWidget rule_button;
+    screen::ButtonWidget apply_button;
+    screen::ButtonWidget save_button;
+    GraphDrawer graph;
+};
+
+screen::Page *RelayAutotuner::Page(PID::pid_config_t &cfg, Serializer *s,
+                                   const std::string &name) {
+    return new RelayAutotunerPage(*this, cfg, s, name);
+}
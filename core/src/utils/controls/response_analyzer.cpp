@@ -0,0 +1,293 @@
+#include "../core/include/utils/controls/response_analyzer.h"
+#include "../core/include/utils/logger.h"
+#include "vex.h"
+#include <cmath>
+#include <stdio.h>
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+double FirstOrderPlant::step(double u, double dt) {
+    // exact for u held over dt
+    double e = tau > 0 ? exp(-dt / tau) : 0;
+    x = gain * u + (x - gain * u) * e;
+    return x;
+}
+
+double InertiaPlant::step(double u, double dt) {
+    double kA = model.kA > 0 ? model.kA : 1e-3;
+    double drive = u - model.kG;
+
+    // Static friction: stuck until the output overcomes kS
+    if (vel == 0 && fabs(drive) <= model.kS) {
+        return pos;
+    }
+    double dir = vel != 0 ? (vel > 0 ? 1.0 : -1.0) : (drive > 0 ? 1.0 : -1.0);
+    double a = (drive - model.kS * dir - model.kV * vel) / kA;
+    double new_vel = vel + a * dt;
+    // friction stops it, it doesn't turn it around
+    if (new_vel * dir < 0) {
+        new_vel = 0;
+    }
+    pos += 0.5 * (vel + new_vel) * dt;
+    vel = new_vel;
+    return pos;
+}
+
+ResponseAnalyzer::ResponseAnalyzer(double dt,
+                                   std::function<void(double)> advance)
+    : dt(dt), advance(advance) {
+    if (!this->advance) {
+        this->advance = wait_realtime;
+    }
+}
+
+void ResponseAnalyzer::wait_realtime(double dt) {
+    vexDelay((uint32_t)(dt * 1000));
+}
+
+ResponseAnalyzer::step_metrics_t
+ResponseAnalyzer::step_response(Feedback &fb, Plant &plant, double start,
+                                double setpoint, double duration, double band) {
+    step_metrics_t m = {0, 0, 0, 0, false};
+    double size = setpoint - start;
+    double dir = size >= 0 ? 1.0 : -1.0;
+    double tol = fabs(size) * band;
+
+    plant.reset(start);
+    fb.init(start, setpoint);
+
+    double meas = start;
+    double peak = 0; // furthest travelled, in the direction of the step
+    double t10 = -1, t90 = -1;
+    double last_outside = 0;
+    int steps = (int)(duration / dt);
+    for (int i = 1; i <= steps; i++) {
+        double u = fb.update(meas);
+        advance(dt);
+        meas = plant.step(u, dt);
+        double t = i * dt;
+
+        double travelled = (meas - start) * dir;
+        peak = travelled > peak ? travelled : peak;
+        if (t10 < 0 && travelled >= 0.1 * fabs(size)) {
+            t10 = t;
+        }
+        if (t90 < 0 && travelled >= 0.9 * fabs(size)) {
+            t90 = t;
+        }
+        if (fabs(setpoint - meas) > tol) {
+            last_outside = t;
+        }
+    }
+
+    m.rise_time = (t10 >= 0 && t90 >= 0) ? t90 - t10 : -1;
+    m.overshoot = size != 0 && peak > fabs(size)
+                      ? (peak - fabs(size)) / fabs(size)
+                      : 0;
+    m.steady_state_error = fabs(setpoint - meas);
+    // Still outside the band at the end means it never settled
+    m.settled = last_outside < steps * dt;
+    m.settling_time = m.settled ? last_outside : -1;
+    return m;
+}
+
+ResponseAnalyzer::freq_point_t
+ResponseAnalyzer::loop_response(Feedback &fb, Plant &plant, double hz,
+                                double amplitude, double operating_pt,
+                                int settle_cycles, int cycles) {
+    // Break the loop at the plant input: the plant gets u = c + d where c is
+    // the controller's output and d the injected sine. Going around the loop,
+    // c = -L * u, so comparing c and u at the injected frequency gives L.
+    // Each is reduced to one phasor by correlating with sin and cos over
+    // whole cycles, which ignores any constant (kG, kS) and other frequencies
+    plant.reset(operating_pt);
+    fb.init(operating_pt, operating_pt);
+
+    double w = 2 * PI * hz;
+    int per_cycle = (int)ceil(1.0 / (hz * dt));
+    // a whole number of cycles, as near as dt allows
+    int measure_steps = (int)round(cycles / (hz * dt));
+    int settle_steps = settle_cycles * per_cycle;
+
+    double meas = operating_pt;
+    double c_re = 0, c_im = 0, u_re = 0, u_im = 0;
+    for (int i = 0; i < settle_steps + measure_steps; i++) {
+        double t = i * dt;
+        double c = fb.update(meas);
+        double u = c + amplitude * sin(w * t);
+        advance(dt);
+        meas = plant.step(u, dt);
+
+        if (i >= settle_steps) {
+            double s = sin(w * t), co = cos(w * t);
+            c_re += c * s;
+            c_im += c * co;
+            u_re += u * s;
+            u_im += u * co;
+        }
+    }
+
+    // L = -c / u
+    double den = u_re * u_re + u_im * u_im;
+    freq_point_t p = {hz, 0, 0};
+    if (den <= 0) {
+        return p;
+    }
+    double l_re = -(c_re * u_re + c_im * u_im) / den;
+    double l_im = -(c_im * u_re - c_re * u_im) / den;
+    p.gain = sqrt(l_re * l_re + l_im * l_im);
+    p.phase = atan2(l_im, l_re) * 180 / PI;
+    return p;
+}
+
+std::vector<ResponseAnalyzer::freq_point_t>
+ResponseAnalyzer::bode(Feedback &fb, Plant &plant, double hz_lo, double hz_hi,
+                       int points, double amplitude, double operating_pt) {
+    std::vector<freq_point_t> resp;
+    if (points < 1 || hz_lo <= 0 || hz_hi < hz_lo) {
+        printf("ResponseAnalyzer: bad sweep %f-%f hz, %d points\n", hz_lo,
+               hz_hi, points);
+        return resp;
+    }
+    resp.reserve(points);
+
+    double ratio = points > 1 ? pow(hz_hi / hz_lo, 1.0 / (points - 1)) : 1;
+    double hz = hz_lo;
+    for (int i = 0; i < points; i++) {
+        freq_point_t p =
+            loop_response(fb, plant, hz, amplitude, operating_pt);
+        // atan2 wraps at +-180. Keep the phase continuous so the -180
+        // crossing can be found
+        if (!resp.empty()) {
+            double prev = resp.back().phase;
+            while (p.phase - prev > 180) {
+                p.phase -= 360;
+            }
+            while (p.phase - prev < -180) {
+                p.phase += 360;
+            }
+        }
+        resp.push_back(p);
+        hz *= ratio;
+    }
+    return resp;
+}
+
+ResponseAnalyzer::margins_t
+ResponseAnalyzer::margins(const std::vector<freq_point_t> &resp) {
+    margins_t m = {0, 0, 0, 0, false, false};
+    for (size_t i = 1; i < resp.size(); i++) {
+        const freq_point_t &a = resp[i - 1];
+        const freq_point_t &b = resp[i];
+        // interpolate on log frequency, the way the sweep is spaced
+        double la = log(a.hz), lb = log(b.hz);
+
+        if (!m.has_phase_margin && a.gain >= 1 && b.gain < 1 && a.gain > 0 &&
+            b.gain > 0) {
+            double ga = log(a.gain), gb = log(b.gain);
+            double t = ga / (ga - gb);
+            m.crossover_hz = exp(la + t * (lb - la));
+            m.phase_margin_deg = 180 + a.phase + t * (b.phase - a.phase);
+            m.has_phase_margin = true;
+        }
+
+        if (!m.has_gain_margin && a.phase > -180 && b.phase <= -180) {
+            double t = (-180 - a.phase) / (b.phase - a.phase);
+            m.phase_crossover_hz = exp(la + t * (lb - la));
+            double ga = log(a.gain > 0 ? a.gain : 1e-12);
+            double gb = log(b.gain > 0 ? b.gain : 1e-12);
+            double gain = exp(ga + t * (gb - ga));
+            m.gain_margin_db = -20 * log10(gain);
+            m.has_gain_margin = true;
+        }
+    }
+    return m;
+}
+
+std::vector<ResponseAnalyzer::grid_result_t> ResponseAnalyzer::pid_grid(
+    const PID::pid_config_t &base, const std::vector<double> &ps,
+    const std::vector<double> &is, const std::vector<double> &ds,
+    feedback_factory_t make, Plant &plant, double start, double setpoint,
+    double duration, double hz_lo, double hz_hi, int points, double amplitude) {
+    std::vector<grid_result_t> results;
+    results.reserve(ps.size() * is.size() * ds.size());
+
+    for (double p : ps) {
+        for (double i : is) {
+            for (double d : ds) {
+                // PID keeps a reference to its config, so it lives here for
+                // the whole run
+                PID::pid_config_t cfg = base;
+                cfg.p = p;
+                cfg.i = i;
+                cfg.d = d;
+
+                std::unique_ptr<Feedback> fb;
+                if (make) {
+                    fb = make(cfg);
+                } else {
+                    fb.reset(new PID(cfg));
+                }
+                if (!fb) {
+                    continue;
+                }
+
+                grid_result_t r;
+                r.cfg = cfg;
+                r.step = step_response(*fb, plant, start, setpoint, duration);
+                r.margins = {0, 0, 0, 0, false, false};
+                if (points > 0) {
+                    r.margins = margins(bode(*fb, plant, hz_lo, hz_hi, points,
+                                             amplitude, start));
+                }
+                results.push_back(r);
+            }
+        }
+    }
+    return results;
+}
+
+static const char *csv_header =
+    "p,i,d,rise_time,overshoot,settling_time,steady_state_error,"
+    "gain_margin_db,phase_margin_deg,crossover_hz\n";
+
+/// @brief one csv row. Values that couldn't be measured are left empty
+static void format_row(char *buf, size_t len,
+                       const ResponseAnalyzer::grid_result_t &r) {
+    char settle[24] = "", gm[24] = "", pm[24] = "", xo[24] = "";
+    if (r.step.settled) {
+        snprintf(settle, sizeof(settle), "%.4f", r.step.settling_time);
+    }
+    if (r.margins.has_gain_margin) {
+        snprintf(gm, sizeof(gm), "%.2f", r.margins.gain_margin_db);
+    }
+    if (r.margins.has_phase_margin) {
+        snprintf(pm, sizeof(pm), "%.2f", r.margins.phase_margin_deg);
+        snprintf(xo, sizeof(xo), "%.3f", r.margins.crossover_hz);
+    }
+    snprintf(buf, len, "%g,%g,%g,%.4f,%.4f,%s,%.5f,%s,%s,%s\n", r.cfg.p,
+             r.cfg.i, r.cfg.d, r.step.rise_time, r.step.overshoot, settle,
+             r.step.steady_state_error, gm, pm, xo);
+}
+
+void ResponseAnalyzer::print_csv(const std::vector<grid_result_t> &results) {
+    printf("%s", csv_header);
+    char buf[256];
+    for (const grid_result_t &r : results) {
+        format_row(buf, sizeof(buf), r);
+        printf("%s", buf);
+    }
+}
+
+void ResponseAnalyzer::log_csv(const std::vector<grid_result_t> &results,
+                               const std::string &filename) {
+    Logger log(filename);
+    log.Log(csv_header);
+    char buf[256];
+    for (const grid_result_t &r : results) {
+        format_row(buf, sizeof(buf), r);
+        log.Log(buf);
+    }
+}
@@ -1,4 +1,6 @@
 #include "../core/include/utils/graph_drawer.h"
+#include <algorithm>
+#include <cmath>
 
 /// @brief Creates a graph drawer with the specified number of series (each series is a separate line)
 /// @param num_samples the number of samples to graph at a time (40 will graph the last 40 data points)
@@ -6,7 +8,7 @@
 /// @param upper_bound the top of the window when displaying (if upper_bound = lower_bound, auto calculate bounds)
 /// @param colors the colors of the series. must be of size num_series
 /// @param num_series the number of series to graph
-GraphDrawer::GraphDrawer(int num_samples, double lower_bound, double upper_bound, std::vector<vex::color> colors, size_t num_series) : cols(colors), auto_fit(lower_bound == upper_bound)
+GraphDrawer::GraphDrawer(int num_samples, double lower_bound, double upper_bound, std::vector<vex::color> colors, size_t num_series) : num_samples(num_samples), cols(colors), auto_fit(lower_bound == upper_bound)
 {
     if (colors.size() != num_series)
     {
@@ -32,42 +34,124 @@ GraphDrawer::GraphDrawer(int num_samples, double lower_bound, double upper_bound
  * add_samples adds a point to the graph, removing one from the back
  * @param sample an x, y coordinate of the next point to graph
  */
-void GraphDrawer::add_samples(std::vector<point_t> new_samples)
+void GraphDrawer::add_samples(const std::vector<point_t> &new_samples)
 {
+    restore();
     if (series.size() != new_samples.size())
     {
         printf("Mismatch between # of samples given and number of series. %s : %d\n", __FILE__, __LINE__);
     }
-    for (size_t i = 0; i < series.size(); i++)
+    for (size_t i = 0; i < series.size() && i < new_samples.size(); i++)
     {
         series[i][sample_index] = new_samples[i];
-        if (auto_fit)
-        {
-            upper = fmax(upper, new_samples[i].y);
-            lower = fmin(lower, new_samples[i].y);
-        }
     }
     sample_index++;
     sample_index %= series[0].size();
+    if (filled < series[0].size())
+    {
+        filled++;
+    }
 }
 
-void GraphDrawer::add_samples(std::vector<double> new_samples)
+void GraphDrawer::add_samples(const std::vector<double> &new_samples)
 {
-    if (series.size() != new_samples.size())
+    add_samples(new_samples.data(), new_samples.size());
+}
+
+void GraphDrawer::add_samples(std::initializer_list<double> new_samples)
+{
+    add_samples(new_samples.begin(), new_samples.size());
+}
+
+void GraphDrawer::add_samples(const double *new_samples, size_t n)
+{
+    restore();
+    if (series.size() != n)
     {
         printf("Mismatch between # of samples given and number of series. %s : %d\n", __FILE__, __LINE__);
     }
-    for (size_t i = 0; i < series.size(); i++)
+    double now = (double)vex::timer::system();
+    for (size_t i = 0; i < series.size() && i < n; i++)
     {
-        series[i][sample_index] = {(double)vex::timer::system(), new_samples[i]};
-        if (auto_fit)
-        {
-            upper = fmax(upper, new_samples[i]);
-            lower = fmin(lower, new_samples[i]);
-        }
+        series[i][sample_index] = {now, new_samples[i]};
     }
     sample_index++;
     sample_index %= series[0].size();
+    if (filled < series[0].size())
+    {
+        filled++;
+    }
+}
+
+size_t GraphDrawer::memory_bytes() const
+{
+    size_t bytes = 0;
+    for (const std::vector<point_t> &samples : series)
+    {
+        bytes += samples.capacity() * sizeof(point_t);
+    }
+    bytes += (col_min.capacity() + col_max.capacity() + col_first.capacity() + col_last.capacity()) * sizeof(double);
+    bytes += col_used.capacity() / 8;
+    return bytes;
+}
+
+void GraphDrawer::release()
+{
+    // swap with empty vectors, clear() would keep the memory
+    for (std::vector<point_t> &samples : series)
+    {
+        std::vector<point_t>().swap(samples);
+    }
+    std::vector<double>().swap(col_min);
+    std::vector<double>().swap(col_max);
+    std::vector<double>().swap(col_first);
+    std::vector<double>().swap(col_last);
+    std::vector<bool>().swap(col_used);
+    sample_index = 0;
+    filled = 0;
+}
+
+void GraphDrawer::restore()
+{
+    if (series.empty() || !series[0].empty())
+    {
+        return;
+    }
+    for (std::vector<point_t> &samples : series)
+    {
+        samples.assign(num_samples, {0.0, 0.0});
+    }
+}
+
+void GraphDrawer::slide_bounds(size_t oldest, size_t count)
+{
+    size_t n = series[0].size();
+    double hi = -INFINITY;
+    double lo = INFINITY;
+    for (const std::vector<point_t> &samples : series)
+    {
+        for (size_t k = 0; k < count; k++)
+        {
+            double v = samples[(oldest + k) % n].y;
+            hi = fmax(hi, v);
+            lo = fmin(lo, v);
+        }
+    }
+    if (hi < lo)
+    {
+        return;
+    }
+
+    // Jump out to fit new extremes, ease back in when they scroll off
+    const double shrink_rate = 0.25;
+    upper = (hi > upper) ? hi : upper + (hi - upper) * shrink_rate;
+    lower = (lo < lower) ? lo : lower + (lo - lower) * shrink_rate;
+    if (upper - lower < 1e-6)
+    {
+        double pad = fmax(fabs(upper) * 0.1, 1e-3);
+        upper += pad;
+        lower -= pad;
+    }
 }
 
 /**
@@ -77,9 +161,10 @@ void GraphDrawer::add_samples(std::vector<double> new_samples)
  * @param width the width of the graphed region
  * @param height the height of the graphed region
  */
-void GraphDrawer::draw(vex::brain::lcd &screen, int x, int y, int width, int height)
+void GraphDrawer::draw(screen::Canvas &screen, int x, int y, int width, int height)
 {
-    if (series[0].size() < 1)
+    size_t n = series[0].size();
+    if (n < 1 || width < 1)
     {
         return;
     }
@@ -88,17 +173,21 @@ void GraphDrawer::draw(vex::brain::lcd &screen, int x, int y, int width, int hei
         printf("The number of colors does not match the number of series in graph drawer\n");
     }
 
-    size_t newest_index = (sample_index-1);
-    if (sample_index<0){
-        sample_index+=series[0].size();
+    // Until the ring has gone around once, the oldest real sample is at 0
+    size_t count = filled;
+    size_t oldest = (count < n) ? 0 : (size_t)sample_index;
+    if (count < 2)
+    {
+        screen.printAt(x + width / 2, y + height / 2, "Not enough Data");
+        return;
     }
+    size_t newest = (oldest + count - 1) % n;
 
-    double earliest_time = series[0][sample_index].x;
-    double latest_time = series[0][newest_index].x;
-    // collect data
+    double earliest_time = series[0][oldest].x;
+    double latest_time = series[0][newest].x;
     if (std::abs(latest_time - earliest_time) < 0.001)
     {
-        screen.printAt(width / 2, height / 2, "Not enough Data");
+        screen.printAt(x + width / 2, y + height / 2, "Not enough Data");
         return;
     }
 
@@ -110,28 +199,66 @@ void GraphDrawer::draw(vex::brain::lcd &screen, int x, int y, int width, int hei
         screen.drawRectangle(x, y, width, height);
     }
 
+    if (auto_fit)
+    {
+        slide_bounds(oldest, count);
+    }
+
+    if ((int)col_min.size() != width)
+    {
+        col_min.assign(width, 0);
+        col_max.assign(width, 0);
+        col_first.assign(width, 0);
+        col_last.assign(width, 0);
+        col_used.assign(width, false);
+    }
+
     double time_range = latest_time - earliest_time;
     double sample_range = upper - lower;
+    auto to_y = [&](double v) {
+        return (int)((double)(y + height) - ((v - lower) / sample_range) * (double)height);
+    };
     screen.setPenWidth(2);
 
-    for (int j = 0; j < series.size(); j++)
+    for (size_t j = 0; j < series.size(); j++)
     {
-        double x_s = (double)x;
-        double y_s = (double)y + (double)height;
         const std::vector<point_t> &samples = series[j];
 
-        screen.setPenColor(cols[j]);
-        for (int i = sample_index; i < samples.size() + sample_index - 1; i++)
+        // Put every sample in the column of pixels it lands in, keeping the
+        // extremes so nothing between two pixels is lost
+        std::fill(col_used.begin(), col_used.end(), false);
+        for (size_t k = 0; k < count; k++)
         {
-            point_t p = samples[i % samples.size()];
-            double x_pos = x_s + ((p.x - earliest_time) / time_range) * (double)width;
-            double y_pos = y_s + ((p.y - lower) / sample_range) * (double)(-height);
-
-            point_t p2 = samples[(i + 1) % samples.size()];
-            double x_pos2 = x_s + ((p2.x - earliest_time) / time_range) * (double)width;
-            double y_pos2 = y_s + ((p2.y - lower) / sample_range) * (double)(-height);
+            point_t p = samples[(oldest + k) % n];
+            int c = (int)((p.x - earliest_time) / time_range * (double)(width - 1));
+            c = c < 0 ? 0 : (c >= width ? width - 1 : c);
+            if (!col_used[c])
+            {
+                col_used[c] = true;
+                col_min[c] = col_max[c] = col_first[c] = p.y;
+            }
+            col_min[c] = fmin(col_min[c], p.y);
+            col_max[c] = fmax(col_max[c], p.y);
+            col_last[c] = p.y;
+        }
 
-            screen.drawLine((int)x_pos, (int)y_pos, (int)x_pos2, (int)y_pos2);
+        screen.setPenColor(cols[j < cols.size() ? j : 0]);
+        int prev_c = -1;
+        for (int c = 0; c < width; c++)
+        {
+            if (!col_used[c])
+            {
+                continue;
+            }
+            if (prev_c >= 0)
+            {
+                screen.drawLine(x + prev_c, to_y(col_last[prev_c]), x + c, to_y(col_first[c]));
+            }
+            if (col_max[c] != col_min[c])
+            {
+                screen.drawLine(x + c, to_y(col_min[c]), x + c, to_y(col_max[c]));
+            }
+            prev_c = c;
         }
     }
 }
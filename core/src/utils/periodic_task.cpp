@@ -0,0 +1,294 @@
+#include "../core/include/utils/periodic_task.h"
+#include "../core/include/subsystems/screen.h"
+#include "../core/include/utils/logger.h"
+#include <algorithm>
+
+// Function statics so that tasks declared in global constructors (in any
+// order) still find the registry built
+static std::vector<PeriodicTask *> &registry() {
+    static std::vector<PeriodicTask *> tasks;
+    return tasks;
+}
+static vex::mutex &registry_mut() {
+    static vex::mutex mut;
+    return mut;
+}
+
+PeriodicTask::PeriodicTask(const char *name, uint32_t period_ms,
+                           uint32_t budget_us, std::function<void()> body,
+                           int32_t priority)
+    : name(name), period_ms(period_ms < 1 ? 1 : period_ms),
+      budget_us(budget_us == 0 ? this->period_ms * 1000 : budget_us),
+      priority(priority), body(body) {
+    registry_mut().lock();
+    registry().push_back(this);
+    registry_mut().unlock();
+}
+
+PeriodicTask::~PeriodicTask() {
+    stop();
+    registry_mut().lock();
+    std::vector<PeriodicTask *> &tasks = registry();
+    tasks.erase(std::remove(tasks.begin(), tasks.end(), this), tasks.end());
+    registry_mut().unlock();
+}
+
+void PeriodicTask::start(uint32_t start_delay_ms) {
+    life_mut.lock();
+    if (!is_running) {
+        is_running = true;
+        // If the old loop hasn't exited yet it will see is_running and go
+        // around again. Otherwise start a new one
+        if (!loop_alive) {
+            this->start_delay_ms = start_delay_ms;
+            loop_alive = true;
+            runner = vex::task(runner_func, (void *)this, priority);
+        }
+    }
+    life_mut.unlock();
+}
+
+void PeriodicTask::stop() {
+    life_mut.lock();
+    is_running = false;
+    life_mut.unlock();
+    if (on_own_task()) {
+        // Stopped from inside body. Let this run finish, the loop won't go
+        // around again
+        return;
+    }
+    while (loop_alive) {
+        vexDelay(1);
+    }
+}
+
+bool PeriodicTask::running() const { return is_running; }
+
+bool PeriodicTask::on_own_task() const {
+    return loop_alive && vex::this_thread::get_id() == runner_id;
+}
+
+void PeriodicTask::sleep_while_running(int32_t ms) {
+    // in short pieces so stop() doesn't wait a whole period for us
+    while (ms > 0 && is_running) {
+        int32_t step = ms < 10 ? ms : 10;
+        vexDelay(step);
+        ms -= step;
+    }
+}
+
+/**
+ * @brief the loop that every PeriodicTask runs on
+ * @param self the PeriodicTask to run
+ * @return return value of thread
+ */
+int PeriodicTask::runner_func(void *self) {
+    PeriodicTask &pt = *static_cast<PeriodicTask *>(self);
+    pt.runner_id = vex::this_thread::get_id();
+    pt.sleep_while_running(pt.start_delay_ms);
+
+    uint32_t next_release = vex::timer::system();
+    while (true) {
+        // Decide whether to go around again while start() and stop() can't
+        // change their minds
+        pt.life_mut.lock();
+        if (!pt.is_running) {
+            pt.loop_alive = false;
+            pt.life_mut.unlock();
+            break;
+        }
+        pt.life_mut.unlock();
+
+        uint64_t start_us = vex::timer::systemHighResolution();
+        pt.body();
+        uint64_t end_us = vex::timer::systemHighResolution();
+        pt.record((uint32_t)(end_us - start_us), end_us);
+
+        next_release += pt.period_ms;
+        uint32_t now = vex::timer::system();
+        int32_t late_ms = (int32_t)(now - next_release);
+        if (late_ms >= (int32_t)pt.period_ms) {
+            // We blew through at least one whole period. Skip ahead rather
+            // than running several times in a row to catch up
+            uint32_t skipped = (uint32_t)late_ms / pt.period_ms;
+            next_release += skipped * pt.period_ms;
+            pt.mut.lock();
+            pt.missed += skipped;
+            pt.mut.unlock();
+        }
+
+        int32_t wait_ms = (int32_t)(next_release - vex::timer::system());
+        // always sleep a little so lower priority tasks get to go
+        vexDelay(1);
+        pt.sleep_while_running(wait_ms - 1);
+    }
+    return 0;
+}
+
+void PeriodicTask::record(uint32_t run_us, uint64_t now_us) {
+    mut.lock();
+    runs++;
+    last_us = run_us;
+    total_us += run_us;
+    if (run_us > max_us) {
+        max_us = run_us;
+    }
+    if (run_us > budget_us) {
+        overruns++;
+    }
+
+    if (window_start_us == 0) {
+        window_start_us = now_us - run_us;
+    }
+    window_busy_us += run_us;
+    if (now_us - window_start_us >= window_us) {
+        cpu_share = (double)window_busy_us / (double)(now_us - window_start_us);
+        window_start_us = now_us;
+        window_busy_us = 0;
+    }
+    mut.unlock();
+}
+
+PeriodicTask::stats_t PeriodicTask::stats() const {
+    stats_t s;
+    s.name = name;
+    s.period_ms = period_ms;
+    s.budget_us = budget_us;
+    s.priority = priority;
+    s.running = is_running;
+
+    mut.lock();
+    s.runs = runs;
+    s.overruns = overruns;
+    s.missed = missed;
+    s.last_us = last_us;
+    s.max_us = max_us;
+    s.avg_us = runs == 0 ? 0.0 : (double)total_us / (double)runs;
+    s.cpu_share = cpu_share;
+    mut.unlock();
+    return s;
+}
+
+std::vector<PeriodicTask::stats_t> PeriodicTask::all_stats() {
+    std::vector<stats_t> out;
+    registry_mut().lock();
+    for (PeriodicTask *pt : registry()) {
+        out.push_back(pt->stats());
+    }
+    registry_mut().unlock();
+    return out;
+}
+
+void PeriodicTask::print_stats() {
+    printf("task,period_ms,budget_us,priority,runs,avg_us,max_us,overruns,"
+           "missed,cpu_pct\n");
+    for (const stats_t &s : all_stats()) {
+        printf("%s,%lu,%lu,%ld,%lu,%.0f,%lu,%lu,%lu,%.1f\n", s.name,
+               (unsigned long)s.period_ms, (unsigned long)s.budget_us,
+               (long)s.priority, (unsigned long)s.runs, s.avg_us,
+               (unsigned long)s.max_us, (unsigned long)s.overruns,
+               (unsigned long)s.missed, s.cpu_share * 100.0);
+    }
+    fflush(stdout);
+}
+
+void PeriodicTask::log_stats(const std::string &filename) {
+    Logger log(filename);
+    log.Logln("task,period_ms,budget_us,priority,runs,avg_us,max_us,overruns,"
+              "missed,cpu_pct");
+    for (const stats_t &s : all_stats()) {
+        log.Logf("%s,%lu,%lu,%ld,%lu,%.0f,%lu,%lu,%lu,%.1f\n", s.name,
+                 (unsigned long)s.period_ms, (unsigned long)s.budget_us,
+                 (long)s.priority, (unsigned long)s.runs, s.avg_us,
+                 (unsigned long)s.max_us, (unsigned long)s.overruns,
+                 (unsigned long)s.missed, s.cpu_share * 100.0);
+    }
+}
+
+class PeriodicTaskPage : public screen::Page {
+  public:
+    PeriodicTaskPage()
+        : save_button([this]() { save(); }, Rect{{340, 205}, {430, 235}},
+                      "Save") {}
+
+    ~PeriodicTaskPage() {
+        // the save task is still using us
+        while (saving) {
+            vexDelay(1);
+        }
+    }
+
+    void update(bool was_pressed, int x, int y) override {
+        save_button.update(was_pressed, x, y);
+    }
+
+    bool updates_in_background() const override { return false; }
+
+    void draw(screen::Canvas &scr, bool, unsigned int frame) override {
+        const int row_height = 16;
+        int y = 20;
+        double total_share = 0.0;
+
+        scr.setFont(vex::fontType::mono15);
+        scr.printAt(45, y, true, "task       per   avg    max ovr miss  cpu");
+        for (const PeriodicTask::stats_t &s : PeriodicTask::all_stats()) {
+            y += row_height;
+            if (y > 200) {
+                break;
+            }
+            // over budget tasks stand out
+            if (s.overruns > 0 || s.missed > 0) {
+                scr.setPenColor(vex::yellow);
+            } else if (!s.running) {
+                scr.setPenColor(vex::color(120, 120, 120));
+            } else {
+                scr.setPenColor(vex::white);
+            }
+            scr.printAt(45, y, true,
+                        "%-10.10s %3lu %5.0f %6lu %3lu %4lu %4.1f%%", s.name,
+                        (unsigned long)s.period_ms, s.avg_us,
+                        (unsigned long)s.max_us,
+                        (unsigned long)std::min<uint32_t>(s.overruns, 999),
+                        (unsigned long)std::min<uint32_t>(s.missed, 9999),
+                        s.cpu_share * 100.0);
+            total_share += s.cpu_share;
+        }
+        scr.setPenColor(vex::white);
+        scr.printAt(45, 225, true, "cpu: %.1f%%  (times in us)",
+                    total_share * 100.0);
+        if (saving) {
+            scr.printAt(280, 225, true, "saving");
+        } else if (saved) {
+            scr.printAt(280, 225, true, "saved ");
+        }
+        scr.setFont(vex::fontType::mono20);
+        save_button.draw(scr, false, frame);
+    }
+
+  private:
+    /// @brief write the stats on a task of their own, the SD card is too
+    /// slow to write to from the screen task
+    void save() {
+        if (saving.exchange(true)) {
+            return;
+        }
+        saved = false;
+        save_task = vex::task(save_thread, (void *)this);
+    }
+
+    static int save_thread(void *self) {
+        PeriodicTaskPage &page = *static_cast<PeriodicTaskPage *>(self);
+        PeriodicTask::log_stats("task_stats.csv");
+        PeriodicTask::print_stats();
+        page.saved = true;
+        page.saving = false;
+        return 0;
+    }
+
+    screen::ButtonWidget save_button;
+    vex::task save_task;
+    std::atomic<bool> saving{false};
+    std::atomic<bool> saved{false};
+};
+
+screen::Page *PeriodicTask::Page() { return new PeriodicTaskPage(); }
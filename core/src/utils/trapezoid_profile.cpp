@@ -15,7 +15,7 @@ inline double calc_vel(double t, double a, double vi) {
 
 TrapezoidProfile::TrapezoidProfile(double max_v, double accel)
     : si(0), sf(0), vi(0), vf(0), max_v(max_v), accel(accel), segments(),
-      num_acceleration_phases(0), precalculated(false) {}
+      num_acceleration_phases(0), num_segments(0), precalculated(false) {}
 
 void TrapezoidProfile::set_max_v(double max_v) {
   this->max_v = max_v;
@@ -46,6 +46,7 @@ void TrapezoidProfile::set_vel_endpts(double start, double end) {
 motion_t TrapezoidProfile::calculate_time_based(double time_s) {
   if (!this->precalculated) {
     precalculate();
+    this->precalculated = true;
 }
 
   int segment_i = 0;
@@ -58,23 +59,25 @@ motion_t TrapezoidProfile::calculate_time_based(double time_s) {
   double segment_t = 0;
 
   // skip phases based on time
-  while (segment_i < MAX_TRAPEZOID_PROFILE_SEGMENTS &&
+  while (segment_i < this->num_segments &&
          time_s > segment_t + this->segments[segment_i].duration) {
     segment_t += this->segments[segment_i].duration;
     segment_s = this->segments[segment_i].pos_after;
     segment_v = this->segments[segment_i].vel_after;
     segment_i++;
-    segment_a = this->segments[segment_i].accel;
+    if (segment_i < this->num_segments) {
+      segment_a = this->segments[segment_i].accel;
+    }
   }
 
   motion_t out;
 
   // if we are beyond the last phase, return the position/velocity at the last
   // phase
-  if (segment_i == MAX_TRAPEZOID_PROFILE_SEGMENTS) {
+  if (segment_i >= this->num_segments) {
     out.accel = 0;
-    out.pos = this->segments[MAX_TRAPEZOID_PROFILE_SEGMENTS - 1].pos_after;
-    out.vel = this->segments[MAX_TRAPEZOID_PROFILE_SEGMENTS - 1].vel_after;
+    out.pos = segment_s;
+    out.vel = segment_v;
     return out;
   }
 
@@ -88,6 +91,7 @@ motion_t TrapezoidProfile::calculate_time_based(double time_s) {
 motion_t TrapezoidProfile::calculate(double time_s, double pos_s) {
   if (!this->precalculated) {
     precalculate();
+    this->precalculated = true;
 }
 
   // printf("%f %f\n", time_s, pos_s);
@@ -102,20 +106,22 @@ motion_t TrapezoidProfile::calculate(double time_s, double pos_s) {
   double segment_t = 0;
 
   // skip acceleration phases based on time
-  while (segment_i < MAX_TRAPEZOID_PROFILE_SEGMENTS &&
+  while (segment_i < this->num_segments &&
          segment_i < this->num_acceleration_phases &&
          time_s > segment_t + this->segments[segment_i].duration) {
     segment_t += this->segments[segment_i].duration;
     segment_s = this->segments[segment_i].pos_after;
     segment_v = this->segments[segment_i].vel_after;
     segment_i++;
-    segment_a = this->segments[segment_i].accel;
+    if (segment_i < this->num_segments) {
+      segment_a = this->segments[segment_i].accel;
+    }
   }
 
   // skip other segments based on distance, if we are past the time segments
   if (segment_i >= this->num_acceleration_phases) {
     while (
-        segment_i < MAX_TRAPEZOID_PROFILE_SEGMENTS &&
+        segment_i < this->num_segments &&
         ((this->si < this->sf && pos_s > this->segments[segment_i].pos_after) ||
          (this->si > this->sf &&
           pos_s < this->segments[segment_i].pos_after))) {
@@ -123,7 +129,9 @@ motion_t TrapezoidProfile::calculate(double time_s, double pos_s) {
       segment_s = this->segments[segment_i].pos_after;
       segment_v = this->segments[segment_i].vel_after;
       segment_i++;
-      segment_a = this->segments[segment_i].accel;
+      if (segment_i < this->num_segments) {
+        segment_a = this->segments[segment_i].accel;
+      }
     }
   }
 
@@ -131,10 +139,10 @@ motion_t TrapezoidProfile::calculate(double time_s, double pos_s) {
 
   // if we are beyond the last phase, return the position/velocity at the last
   // phase
-  if (segment_i == MAX_TRAPEZOID_PROFILE_SEGMENTS) {
+  if (segment_i >= this->num_segments) {
     out.accel = 0;
-    out.pos = this->segments[MAX_TRAPEZOID_PROFILE_SEGMENTS - 1].pos_after;
-    out.vel = this->segments[MAX_TRAPEZOID_PROFILE_SEGMENTS - 1].vel_after;
+    out.pos = segment_s;
+    out.vel = segment_v;
     return out;
   }
 
@@ -172,6 +180,7 @@ bool TrapezoidProfile::precalculate() {
     segment.duration = 0;
   }
   this->num_acceleration_phases = 0;
+  this->num_segments = 0;
 
   if (this->accel < EPSILON) {
     printf("WARNING: trapezoid motion profile acceleration was negative, or "
@@ -211,8 +220,10 @@ bool TrapezoidProfile::precalculate() {
   for (auto &segment : this->segments) {
     segment = calculate_next_segment(s, v);
     total_time += segment.duration;
+    this->num_segments++;
 
     if (fabs(segment.pos_after - this->sf) < EPSILON) {
+      duration = total_time;
       return true;
 }
 
@@ -239,9 +250,11 @@ bool TrapezoidProfile::precalculate() {
         if (t_corrected < 0) {
           t_corrected = fmax(t1, t2);
         }
+        total_time += t_corrected - segment.duration;
         segment.duration = t_corrected;
         segment.vel_after = calc_vel(segment.duration, segment.accel, v);
         segment.pos_after = calc_pos(segment.duration, segment.accel, v, s);
+        duration = total_time;
         return true;
       } else {
         printf("ERROR: No real solution to reach sf.\n");
@@ -1,47 +1,178 @@
+#include "../core/include/utils/battery_compensation.h"
 #include "../core/include/utils/controls/pidff.h"
 #include "cata/common.h"
 #include "vex.h"
 #include <../core/include/utils/state_machine.h>
 #include <functional>
 #include <string>
+#include <vector>
 
-enum class CataOnlyMessage {
+enum class CataMessage {
+    // Cata
     DoneReloading,
     DoneFiring,
     Fire,
     Slipped,
-    StartDrop,
     EnableCata,
     DisableCata,
-
+    // Both (cata waits, intake drops)
+    StartDrop,
+    // Intake
+    Intake,
+    Outtake,
+    IntakeHold,
+    Dropped,
+    StopIntake,
+    // Sent from the cata region to the intake region
+    CataAccepting, ///< the cata is down and empty, intake can feed it
+    CataBusy,      ///< the cata can't take a ball right now
 };
-enum class CataOnlyState {
+
+enum class CataState {
+    // Cata region
+    CataRoot, ///< parent of every cata state, tells the intake when it can feed
     CataOff,
     WaitingForDrop,
-    Firing,
+    CataEnabled, ///< parent of Reloading, ReadyToFire and Firing
     Reloading,
-    ReadyToFire
+    ReadyToFire,
+    Firing,
+
+    // Intake region
+    IntakeWaitForDrop,
+    Dropping,
+    IntakeStopped,
+    IntakeRunning, ///< parent of Intaking, IntakingHold and Outtaking
+    Intaking,      ///< parent of IntakeFeeding and IntakeBlocked
+    IntakeFeeding,
+    IntakeBlocked,
+    IntakingHold,
+    Outtaking,
 };
-std::string to_string(CataOnlyState s);
-std::string to_string(CataOnlyMessage s);
+std::string to_string(CataState s);
+std::string to_string(CataMessage s);
 
-class CataOnlySys : public StateMachine<CataOnlySys, CataOnlyState,
-                                        CataOnlyMessage, 5, false> {
+/**
+ * @brief The catapult and intake as one state machine with two regions. The
+ * cata region and the intake region each have their own current state but
+ * they share one task and see the same messages. The cata tells the intake
+ * when it can accept a ball with CataAccepting/CataBusy rather than the
+ * intake asking every loop
+ */
+class CataIntakeSys : public StateMachine<CataIntakeSys, CataState,
+                                          CataMessage, 5, false, 16> {
   public:
+    // Cata
+    friend struct CataRoot;
+    friend class CataOff;
+    friend class WaitingForDrop;
+    friend struct CataEnabled;
     friend struct Reloading;
-    friend class Firing;
     friend class ReadyToFire;
-    friend class WaitingForDrop;
-    friend class CataOff;
+    friend class Firing;
+    // Intake
+    friend struct IntakeWaitForDrop;
+    friend struct Dropping;
+    friend struct IntakeStopped;
+    friend struct IntakeRunning;
+    friend struct Intaking;
+    friend struct IntakeFeeding;
+    friend struct IntakeBlocked;
+    friend struct IntakingHold;
+    friend struct Outtaking;
 
     friend class CataSysPage;
-    CataOnlySys(vex::pot &cata_pot, vex::optical &cata_watcher,
-                vex::motor_group &cata_motor, PIDFF &cata_pid, DropMode drop);
+
+    static const size_t cata_region = 0;
+    static const size_t intake_region = 1;
+
+    CataIntakeSys(vex::pot &cata_pot, vex::optical &cata_watcher,
+                  vex::motor_group &cata_motor, PIDFF &cata_pid,
+                  vex::distance &intake_watcher, vex::motor &intake_lower,
+                  vex::motor &intake_upper, DropMode drop);
+
     bool intaking_allowed();
+    bool ball_in_intake();
+
+    /**
+     * @brief scale the cata and intake voltages for the battery (see
+     * BatteryCompensation) so reloads and intake speed stay the same all
+     * match
+     */
+    void set_battery_compensation(bool enabled) {
+        compensate_battery = enabled;
+    }
+
+    static constexpr Transition transitions[] = {
+        // Cata region
+        {CataState::CataOff, CataMessage::EnableCata, CataState::CataEnabled},
+        {CataState::CataOff, CataMessage::StartDrop, CataState::WaitingForDrop},
+
+        {CataState::WaitingForDrop, CataMessage::EnableCata,
+         CataState::CataEnabled},
+
+        {CataState::CataEnabled, CataMessage::DisableCata, CataState::CataOff},
+
+        {CataState::Reloading, CataMessage::DoneReloading,
+         CataState::ReadyToFire},
+        {CataState::Reloading, CataMessage::Fire, CataState::Firing},
+
+        {CataState::ReadyToFire, CataMessage::Fire, CataState::Firing},
+        {CataState::ReadyToFire, CataMessage::Slipped, CataState::Reloading},
+
+        {CataState::Firing, CataMessage::DoneFiring, CataState::Reloading},
+
+        // Intake region
+        {CataState::IntakeWaitForDrop, CataMessage::StartDrop,
+         CataState::Dropping},
+        {CataState::IntakeWaitForDrop, CataMessage::Outtake,
+         CataState::Outtaking},
+        {CataState::IntakeWaitForDrop, CataMessage::Intake,
+         CataState::Intaking},
+
+        {CataState::Dropping, CataMessage::Dropped, CataState::IntakeStopped},
+
+        {CataState::IntakeStopped, CataMessage::Intake, CataState::Intaking},
+        {CataState::IntakeStopped, CataMessage::Outtake, CataState::Outtaking},
+        {CataState::IntakeStopped, CataMessage::IntakeHold,
+         CataState::IntakingHold},
+
+        {CataState::IntakeRunning, CataMessage::StopIntake,
+         CataState::IntakeStopped},
+        {CataState::IntakeRunning, CataMessage::Intake, CataState::Intaking},
+        {CataState::IntakeRunning, CataMessage::Outtake, CataState::Outtaking},
+        {CataState::IntakeRunning, CataMessage::IntakeHold,
+         CataState::IntakingHold},
+
+        {CataState::IntakeFeeding, CataMessage::CataBusy,
+         CataState::IntakeBlocked},
+        {CataState::IntakeBlocked, CataMessage::CataAccepting,
+         CataState::IntakeFeeding},
+    };
 
   private:
+    // the states of each region. cata ones live in cata.cpp, intake ones in
+    // intake.cpp
+    static std::vector<State *> cata_states();
+    static std::vector<State *> intake_states();
+    static std::vector<State *> all_states();
+
     vex::pot &pot;
     vex::optical &cata_watcher;
     vex::motor_group &mot;
     PIDFF &pid;
+
+    vex::distance &intake_watcher;
+    vex::motor &intake_lower;
+    vex::motor &intake_upper;
+
+    // last thing the cata region told the intake region. Only touched from
+    // the state machine's task
+    bool cata_accepting = false;
+
+    bool compensate_battery = false;
+    /// @return v, compensated for the battery if that's turned on
+    double volts(double v) const {
+        return compensate_battery ? BatteryCompensation::compensate(v) : v;
+    }
 };
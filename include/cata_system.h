@@ -5,7 +5,6 @@
 #include "../core/include/utils/command_structure/auto_command.h"
 #include "../core/include/utils/state_machine.h"
 #include "cata/cata.h"
-#include "cata/intake.h"
 #include "vex.h"
 
 class CataSys {
@@ -24,7 +23,9 @@ class CataSys {
             vex::optical &cata_watcher, vex::motor_group &cata_motor,
             vex::motor &intake_upper, vex::motor &intake_lower,
             PIDFF &cata_feedback, DropMode drop);
-    void send_command(Command cmd);
+    /// @return false if the state machine's queue was full and the command
+    /// was dropped
+    bool send_command(Command cmd);
     bool can_fire() const;
     // Returns true when the cata system is finished dropping
     bool still_dropping();
@@ -51,7 +52,6 @@ class CataSys {
     vex::motor_group &cata_motor;
     vex::motor &intake_upper;
     vex::motor &intake_lower;
-    CataOnlySys cata_sys;
-    IntakeSys intake_sys;
+    CataIntakeSys sys;
     friend class CataSysPage;
 };
\ No newline at end of file
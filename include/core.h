@@ -25,16 +25,26 @@
 #include "../core/include/utils/graph_drawer.h"
 #include "../core/include/utils/math_util.h"
 #include "../core/include/utils/moving_average.h"
+#include "../core/include/utils/periodic_task.h"
+#include "../core/include/utils/battery_compensation.h"
 
 
 #include "../core/include/utils/controls/feedback_base.h"
 #include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/feedforward_estimator.h"
+#include "../core/include/utils/controls/flywheel_observer.h"
 #include "../core/include/utils/controls/pid.h"
+#include "../core/include/utils/controls/discrete_pid.h"
 #include "../core/include/utils/controls/pidff.h"
+#include "../core/include/utils/controls/gain_schedule.h"
+#include "../core/include/utils/controls/controller_bank.h"
+#include "../core/include/utils/controls/relay_autotuner.h"
 #include "../core/include/utils/controls/bang_bang.h"
 #include "../core/include/utils/controls/take_back_half.h"
 
 #include "../core/include/utils/controls/motion_controller.h"
+#include "../core/include/utils/controls/mpc.h"
+#include "../core/include/utils/controls/response_analyzer.h"
 
 
 
@@ -1,10 +1,12 @@
 #include "cata/cata.h"
 
+constexpr CataIntakeSys::Transition CataIntakeSys::transitions[];
+
 bool intake_can_be_enabled(double cata_pos) {
     return (cata_pos == 0.0) || (cata_pos > inake_enable_lower_threshold &&
                                  cata_pos < intake_enable_upper_threshold);
 }
-bool CataOnlySys::intaking_allowed() {
+bool CataIntakeSys::intaking_allowed() {
     double cata_pos = pot.angle(vex::deg);
 
     return ((cata_pos == 0.0) || (cata_pos > inake_enable_lower_threshold &&
@@ -12,39 +14,68 @@ bool CataOnlySys::intaking_allowed() {
                                      !cata_watcher.isNearObject());
 }
 
-class CataOff : public CataOnlySys::State {
+// Every cata state lives in here so that it can keep the intake region up to
+// date on whether it can feed a ball in
+struct CataRoot : public CataIntakeSys::State {
+    void entry(CataIntakeSys &sys) override {
+        sys.cata_accepting = sys.intaking_allowed();
+    }
+    CataIntakeSys::MaybeMessage work(CataIntakeSys &sys) override {
+        bool accepting = sys.intaking_allowed();
+        if (accepting == sys.cata_accepting) {
+            return {};
+        }
+        sys.cata_accepting = accepting;
+        return accepting ? CataMessage::CataAccepting : CataMessage::CataBusy;
+    }
+    CataState id() const override { return CataState::CataRoot; }
+    CataState initial_child(CataIntakeSys &) override {
+        return CataState::CataEnabled;
+    }
+};
+
+class CataOff : public CataIntakeSys::State {
   public:
-    void entry(CataOnlySys &sys) override {
+    void entry(CataIntakeSys &sys) override {
         sys.mot.stop(vex::brakeType::coast);
     }
-    CataOnlyState id() const override { return CataOnlyState::CataOff; }
-    State *respond(CataOnlySys &sys, CataOnlyMessage m) override;
+    CataState id() const override { return CataState::CataOff; }
+    CataState parent() const override { return CataState::CataRoot; }
 };
 
-class WaitingForDrop : public CataOnlySys::State {
+class WaitingForDrop : public CataIntakeSys::State {
   public:
-    void entry(CataOnlySys &sys) override { drop_timer.reset(); }
-    CataOnlySys::MaybeMessage work(CataOnlySys &sys) override {
+    void entry(CataIntakeSys &sys) override { drop_timer.reset(); }
+    CataIntakeSys::MaybeMessage work(CataIntakeSys &sys) override {
         if (drop_timer.value() > intake_drop_seconds_until_enable) {
-            return CataOnlyMessage::EnableCata;
+            return CataMessage::EnableCata;
         }
         return {};
     }
-    CataOnlyState id() const override { return CataOnlyState::WaitingForDrop; }
-    State *respond(CataOnlySys &sys, CataOnlyMessage m) override;
+    CataState id() const override { return CataState::WaitingForDrop; }
+    CataState parent() const override { return CataState::CataRoot; }
 
   private:
     vex::timer drop_timer;
 };
 
-struct Reloading : public CataOnlySys::State {
-    void entry(CataOnlySys &sys) override {
+// Any time the cata is powered
+struct CataEnabled : public CataIntakeSys::State {
+    CataState id() const override { return CataState::CataEnabled; }
+    CataState parent() const override { return CataState::CataRoot; }
+    CataState initial_child(CataIntakeSys &) override {
+        return CataState::Reloading;
+    }
+};
+
+struct Reloading : public CataIntakeSys::State {
+    void entry(CataIntakeSys &sys) override {
 
         sys.pid.update(sys.pot.angle(vex::deg));
         sys.pid.set_target(cata_target_charge);
     }
 
-    CataOnlySys::MaybeMessage work(CataOnlySys &sys) override {
+    CataIntakeSys::MaybeMessage work(CataIntakeSys &sys) override {
         // work on motor
         double cata_deg = sys.pot.angle(vex::deg);
         if (cata_deg == 0.0) {
@@ -52,152 +83,156 @@ struct Reloading : public CataOnlySys::State {
             return {};
         }
         sys.pid.update(cata_deg);
-        sys.mot.spin(vex::fwd, sys.pid.get(), vex::volt);
+        sys.mot.spin(vex::fwd, sys.volts(sys.pid.get()), vex::volt);
 
         // are we there yettt
         if (sys.pid.is_on_target()) {
-            return CataOnlyMessage::DoneReloading;
+            return CataMessage::DoneReloading;
         }
         // otherwise keep chugging
         return {};
     }
 
-    CataOnlyState id() const override { return CataOnlyState::Reloading; }
-    State *respond(CataOnlySys &sys, CataOnlyMessage m) override;
+    CataState id() const override { return CataState::Reloading; }
+    CataState parent() const override { return CataState::CataEnabled; }
 };
 
-class Firing : public CataOnlySys::State {
+class Firing : public CataIntakeSys::State {
   public:
-    void entry(CataOnlySys &sys) override {
-        sys.mot.spin(vex::reverse, fire_voltage, vex::volt);
+    void entry(CataIntakeSys &sys) override {
+        sys.mot.spin(vex::reverse, sys.volts(fire_voltage), vex::volt);
     }
-    CataOnlySys::MaybeMessage work(CataOnlySys &sys) override {
+    CataIntakeSys::MaybeMessage work(CataIntakeSys &sys) override {
         // started goin up again
         if (sys.pot.angle(vex::deg) > done_firing_angle) {
-            return CataOnlyMessage::DoneFiring;
+            return CataMessage::DoneFiring;
         }
         return {};
     }
-    CataOnlyState id() const override { return CataOnlyState::Firing; }
-    State *respond(CataOnlySys &sys, CataOnlyMessage m) override;
+    CataState id() const override { return CataState::Firing; }
+    CataState parent() const override { return CataState::CataEnabled; }
 };
 
-class ReadyToFire : public CataOnlySys::State {
+class ReadyToFire : public CataIntakeSys::State {
   public:
-    CataOnlySys::MaybeMessage work(CataOnlySys &sys) override {
+    CataIntakeSys::MaybeMessage work(CataIntakeSys &sys) override {
         double cata_deg = sys.pot.angle(vex::degrees);
         sys.pid.update(cata_deg);
-        sys.mot.spin(vex::fwd, sys.pid.get(), vex::volt);
+        sys.mot.spin(vex::fwd, sys.volts(sys.pid.get()), vex::volt);
 
         // If we slipped, send message to go back to reload
         if (!intake_can_be_enabled(cata_deg)) {
             printf("Slipped\n");
             fflush(stdout);
-            return CataOnlyMessage::Slipped;
+            return CataMessage::Slipped;
         }
 
         // hold here until message comes from outside
         return {};
     }
-    State *respond(CataOnlySys &sys, CataOnlyMessage m) override;
-    CataOnlyState id() const override { return CataOnlyState::ReadyToFire; }
+    CataState id() const override { return CataState::ReadyToFire; }
+    CataState parent() const override { return CataState::CataEnabled; }
 };
 
-CataOnlySys::State *CataOff::respond(CataOnlySys &sys, CataOnlyMessage m) {
-    if (m == CataOnlyMessage::EnableCata) {
-        return new Reloading();
-    } else if (m == CataOnlyMessage::StartDrop) {
-        return new WaitingForDrop();
-    }
-    // Ignore other messages
-    return this;
-}
-
-CataOnlySys::State *WaitingForDrop::respond(CataOnlySys &sys,
-                                            CataOnlyMessage m) {
-    if (m == CataOnlyMessage::EnableCata) {
-        return new Reloading();
-    }
-    // Ignore other messages
-    return this;
-}
-
-CataOnlySys::State *Reloading::respond(CataOnlySys &sys, CataOnlyMessage m) {
-    if (m == CataOnlyMessage::DoneReloading) {
-        return new ReadyToFire();
-    } else if (m == CataOnlyMessage::DisableCata) {
-        return new CataOff();
-    } else if (m == CataOnlyMessage::Fire) {
-        return new Firing();
-    }
-    // Ignore other messages
-    return this;
-}
-CataOnlySys::State *ReadyToFire::respond(CataOnlySys &sys, CataOnlyMessage m) {
-    if (m == CataOnlyMessage::Fire) {
-        return new Firing();
-    } else if (m == CataOnlyMessage::Slipped) {
-        return new Reloading();
-    } else if (m == CataOnlyMessage::DisableCata) {
-        return new CataOff();
-    }
-
-    // Ignore other messages
-    return this;
-}
 
-CataOnlySys::State *Firing::respond(CataOnlySys &sys, CataOnlyMessage m) {
-    if (m == CataOnlyMessage::DoneFiring) {
-        return new Reloading();
-    } else if (m == CataOnlyMessage::DisableCata) {
-        return new CataOff();
-    }
-    // Ignore other messages
-    return this;
-}
-std::string to_string(CataOnlyState s) {
+std::string to_string(CataState s) {
     switch (s) {
-    case CataOnlyState::Firing:
-        return "Firing";
-    case CataOnlyState::Reloading:
-        return "Reloading";
-    case CataOnlyState::ReadyToFire:
-        return "ReadyToFire";
-    case CataOnlyState::CataOff:
+    case CataState::CataRoot:
+        return "CataRoot";
+    case CataState::CataOff:
         return "CataOff";
-    case CataOnlyState::WaitingForDrop:
+    case CataState::WaitingForDrop:
         return "WaitingForDrop";
+    case CataState::CataEnabled:
+        return "CataEnabled";
+    case CataState::Reloading:
+        return "Reloading";
+    case CataState::ReadyToFire:
+        return "ReadyToFire";
+    case CataState::Firing:
+        return "Firing";
+    case CataState::IntakeWaitForDrop:
+        return "IntakeWaitForDrop";
+    case CataState::Dropping:
+        return "Dropping";
+    case CataState::IntakeStopped:
+        return "Stopped";
+    case CataState::IntakeRunning:
+        return "IntakeRunning";
+    case CataState::Intaking:
+        return "Intaking";
+    case CataState::IntakeFeeding:
+        return "Intaking (feeding)";
+    case CataState::IntakeBlocked:
+        return "Intaking (blocked)";
+    case CataState::IntakingHold:
+        return "Intaking to hold";
+    case CataState::Outtaking:
+        return "Outtaking";
     default:
         return "UNKNOWN CATA STATE";
     }
     return "UNHANDLED CATA STATE";
 }
 
-std::string to_string(CataOnlyMessage m) {
+std::string to_string(CataMessage m) {
     switch (m) {
-    case CataOnlyMessage::Slipped:
-        return "Slipped";
-    case CataOnlyMessage::DoneReloading:
+    case CataMessage::DoneReloading:
         return "Done Reloading";
-    case CataOnlyMessage::DoneFiring:
+    case CataMessage::DoneFiring:
         return "Done Firing";
-    case CataOnlyMessage::Fire:
+    case CataMessage::Fire:
         return "Fire";
-    case CataOnlyMessage::EnableCata:
+    case CataMessage::Slipped:
+        return "Slipped";
+    case CataMessage::EnableCata:
         return "EnableCata";
-    case CataOnlyMessage::DisableCata:
+    case CataMessage::DisableCata:
         return "DisableCata";
-    case CataOnlyMessage::StartDrop:
+    case CataMessage::StartDrop:
         return "StartDrop";
+    case CataMessage::Intake:
+        return "Intake";
+    case CataMessage::Outtake:
+        return "Outtake";
+    case CataMessage::IntakeHold:
+        return "IntakeToHold";
+    case CataMessage::Dropped:
+        return "Dropped";
+    case CataMessage::StopIntake:
+        return "Stop";
+    case CataMessage::CataAccepting:
+        return "CataAccepting";
+    case CataMessage::CataBusy:
+        return "CataBusy";
     }
     return "UNHANDLED CATA MESSAGE";
 }
 
-CataOnlySys::CataOnlySys(vex::pot &cata_pot, vex::optical &cata_watcher,
-                         vex::motor_group &cata_motor, PIDFF &cata_pid,
-                         DropMode drop)
-    : StateMachine((drop == DropMode::Required)
-                       ? (CataOnlySys::State *)(new CataOff())
-                       : (CataOnlySys::State *)(new Reloading())),
+std::vector<CataIntakeSys::State *> CataIntakeSys::cata_states() {
+    return {new CataRoot(),    new CataOff(),     new WaitingForDrop(),
+            new CataEnabled(), new Reloading(),   new ReadyToFire(),
+            new Firing()};
+}
+
+std::vector<CataIntakeSys::State *> CataIntakeSys::all_states() {
+    std::vector<State *> all = cata_states();
+    std::vector<State *> intake = intake_states();
+    all.insert(all.end(), intake.begin(), intake.end());
+    return all;
+}
+
+CataIntakeSys::CataIntakeSys(vex::pot &cata_pot, vex::optical &cata_watcher,
+                             vex::motor_group &cata_motor, PIDFF &cata_pid,
+                             vex::distance &intake_watcher,
+                             vex::motor &intake_lower,
+                             vex::motor &intake_upper, DropMode drop)
+    : StateMachine(all_states(),
+                   {(drop == DropMode::Required) ? CataState::CataOff
+                                                 : CataState::Reloading,
+                    (drop == DropMode::Required) ? CataState::IntakeWaitForDrop
+                                                 : CataState::IntakeStopped},
+                   nullptr, 0, "cata"),
       pot(cata_pot), cata_watcher(cata_watcher), mot(cata_motor),
-      pid(cata_pid) {}
+      pid(cata_pid), intake_watcher(intake_watcher),
+      intake_lower(intake_lower), intake_upper(intake_upper) {}
@@ -1,4 +1,5 @@
 #include "cata_system.h"
+#include <atomic>
 #include <string>
 
 CataSys::CataSys(vex::distance &intake_watcher, vex::pot &cata_pot,
@@ -8,87 +9,93 @@ CataSys::CataSys(vex::distance &intake_watcher, vex::pot &cata_pot,
     : intake_watcher(intake_watcher), cata_pot(cata_pot),
       cata_watcher(cata_watcher), cata_motor(cata_motor),
       intake_upper(intake_upper), intake_lower(intake_lower),
-      cata_sys(cata_pot, cata_watcher, cata_motor, cata_feedback, drop),
-      intake_sys(
-          intake_watcher, intake_lower, intake_upper,
-          [&]() { return cata_sys.intaking_allowed(); },
-          [&]() { return cata_watcher.isNearObject(); }, drop) {}
+      sys(cata_pot, cata_watcher, cata_motor, cata_feedback, intake_watcher,
+          intake_lower, intake_upper, drop) {}
 
-void CataSys::send_command(Command next_cmd) {
+bool CataSys::send_command(Command next_cmd) {
     switch (next_cmd) {
     case CataSys::Command::StartFiring:
-        cata_sys.send_message(CataOnlyMessage::Fire);
-        break;
+        return sys.send_message(CataMessage::Fire);
     case CataSys::Command::IntakeIn:
-        if (cata_sys.current_state() == CataOnlyState::CataOff) {
-            intake_sys.send_message(IntakeMessage::IntakeHold);
+        if (sys.in_state(CataState::CataOff)) {
+            return sys.send_message(CataMessage::IntakeHold);
         } else {
-            intake_sys.send_message(IntakeMessage::Intake);
+            return sys.send_message(CataMessage::Intake);
         }
-        break;
     case CataSys::Command::IntakeOut:
-        intake_sys.send_message(IntakeMessage::Outtake);
-        break;
+        return sys.send_message(CataMessage::Outtake);
     case CataSys::Command::IntakeHold:
-        if (cata_sys.current_state() == CataOnlyState::CataOff) {
-            intake_sys.send_message(IntakeMessage::IntakeHold);
-        } else if (cata_sys.intaking_allowed()) {
-            intake_sys.send_message(IntakeMessage::IntakeHold);
+        if (sys.in_state(CataState::CataOff)) {
+            return sys.send_message(CataMessage::IntakeHold);
+        } else if (sys.intaking_allowed()) {
+            return sys.send_message(CataMessage::IntakeHold);
         }
         break;
     case CataSys::Command::StopIntake:
-        intake_sys.send_message(IntakeMessage::StopIntake);
-        break;
+        return sys.send_message(CataMessage::StopIntake);
     case CataSys::Command::StartDropping:
-        intake_sys.send_message(IntakeMessage::Drop);
-        cata_sys.send_message(CataOnlyMessage::StartDrop);
-        break;
+        // both regions respond to this one
+        return sys.send_message(CataMessage::StartDrop);
     case CataSys::Command::ToggleCata:
-        if (cata_sys.current_state() == CataOnlyState::CataOff) {
-            cata_sys.send_message(CataOnlyMessage::EnableCata);
+        if (sys.in_state(CataState::CataOff)) {
+            return sys.send_message(CataMessage::EnableCata);
         } else {
-            cata_sys.send_message(CataOnlyMessage::DisableCata);
+            return sys.send_message(CataMessage::DisableCata);
         }
-        break;
     default:
         break;
     }
+    return true;
 }
 
 bool CataSys::intake_running() {
-    return !(intake_sys.current_state() == IntakeState::Stopped);
+    return !sys.in_state(CataState::IntakeStopped);
 }
 
 bool CataSys::still_dropping() {
-    bool still_dropping =
-        cata_sys.current_state() == CataOnlyState::WaitingForDrop ||
-        (intake_sys.current_state() == IntakeState::Dropping ||
-         intake_sys.current_state() == IntakeState::IntakeWaitForDrop);
+    bool still_dropping = sys.in_state(CataState::WaitingForDrop) ||
+                          sys.in_state(CataState::Dropping) ||
+                          sys.in_state(CataState::IntakeWaitForDrop);
     return !still_dropping;
 }
-bool CataSys::ball_in_intake() { return intake_sys.ball_in_intake(); }
+bool CataSys::ball_in_intake() { return sys.ball_in_intake(); }
 
 bool CataSys::can_fire() const {
-    return cata_sys.current_state() == CataOnlyState::ReadyToFire;
+    return sys.in_state(CataState::ReadyToFire);
 }
 
 class CataSysPage : public screen::Page {
   public:
     CataSysPage(const CataSys &cs)
-        : gd(30, 130.0, 270.0, {vex::green, vex::red}, 2), cs(cs) {}
-    void update(bool, int, int) override {}
+        : gd(30, 130.0, 270.0, {vex::green, vex::red}, 2), cs(cs),
+          save_button([this]() { save_traces(); },
+                      Rect{{250, 205}, {330, 235}}, "Save") {}
+
+    ~CataSysPage() {
+        // the save task is still using us
+        while (saving) {
+            vexDelay(1);
+        }
+    }
+    void update(bool was_pressed, int x, int y) override {
+        save_button.update(was_pressed, x, y);
+    }
+
+    bool updates_in_background() const override { return false; }
 
-    void draw(vex::brain::lcd &scr, bool, unsigned int) override {
+    void draw(screen::Canvas &scr, bool, unsigned int) override {
 
         // Collect all the data
-        CataOnlyState cata_state = cs.cata_sys.current_state();
+        CataState cata_state =
+            cs.sys.current_state(CataIntakeSys::cata_region);
         std::string cata_str = to_string(cata_state);
 
-        IntakeState intake_state = cs.intake_sys.current_state();
+        CataState intake_state =
+            cs.sys.current_state(CataIntakeSys::intake_region);
         std::string intake_str = to_string(intake_state);
 
         gd.add_samples(
-            {cs.cata_pot.angle(vex::deg), cs.cata_sys.pid.get_target()});
+            {cs.cata_pot.angle(vex::deg), cs.sys.pid.get_target()});
         const bool ball_in_intake =
             cs.intake_watcher.objectDistance(distanceUnits::mm) <
             intake_sensor_dist_mm;
@@ -108,12 +115,67 @@ class CataSysPage : public screen::Page {
         scr.printAt(40, 160, true, "Ball in Intake: %s",
                     ball_in_intake ? "yes" : "no");
 
+        // Timing from the state machine traces
+        CataIntakeSys::DwellHistogram reload =
+            cs.sys.get_dwell(CataState::Reloading);
+        scr.printAt(40, 180, true, "Reload: %.0fms (max %lums)",
+                    reload.mean_ms(), (unsigned long)reload.max_ms);
+        scr.printAt(40, 200, true, "Shot cycle: %lums", last_shot_cycle_ms());
+        if (saving) {
+            scr.printAt(340, 225, true, "saving");
+        } else if (saved) {
+            scr.printAt(340, 225, true, "saved ");
+        }
+
         gd.draw(scr, 240, 0, 200, 200);
+        save_button.draw(scr, false, 0);
     }
 
   private:
+    /// @return time between the two most recent shots, 0 if there aren't two
+    unsigned long last_shot_cycle_ms() const {
+        CataIntakeSys::TraceEvent events[CataIntakeSys::trace_len];
+        size_t n = cs.sys.get_trace(events, CataIntakeSys::trace_len);
+        uint32_t newest = 0;
+        bool found_one = false;
+        for (size_t i = n; i > 0; i--) {
+            if (events[i - 1].to != CataState::Firing) {
+                continue;
+            }
+            if (!found_one) {
+                newest = events[i - 1].time_ms;
+                found_one = true;
+            } else {
+                return newest - events[i - 1].time_ms;
+            }
+        }
+        return 0;
+    }
+
+    /// @brief write the traces on a task of their own, the SD card is too
+    /// slow to write to from the screen task
+    void save_traces() {
+        if (saving.exchange(true)) {
+            return;
+        }
+        saved = false;
+        save_task = vex::task(save_thread, (void *)this);
+    }
+
+    static int save_thread(void *self) {
+        CataSysPage &page = *static_cast<CataSysPage *>(self);
+        page.cs.sys.dump_trace("cata_trace.csv");
+        page.saved = true;
+        page.saving = false;
+        return 0;
+    }
+
     GraphDrawer gd;
     const CataSys &cs;
+    screen::ButtonWidget save_button;
+    vex::task save_task;
+    std::atomic<bool> saving{false};
+    std::atomic<bool> saved{false};
 };
 
 screen::Page *CataSys::Page() { return new CataSysPage(*this); }
@@ -152,7 +214,7 @@ AutoCommand *CataSys::WaitForIntake() {
 
 AutoCommand *CataSys::WaitForHold() {
     return new FunctionCommand(
-        [&]() { return intake_sys.current_state() == IntakeState::Stopped; });
+        [&]() { return sys.in_state(CataState::IntakeStopped); });
 }
 
 AutoCommand *CataSys::Unintake() {
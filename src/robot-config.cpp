@@ -195,6 +195,7 @@ std::vector<screen::Page *> pages;
  * are started.
  */
 void robot_init() {
+    BatteryCompensation::start();
     set_video("joe.mpeg");
     pages = {
         new screen::StatsPage(motor_names),
@@ -203,6 +204,7 @@ void robot_init() {
 #ifdef COMP_BOT
         cata_sys.Page(),
 #endif
+        PeriodicTask::Page(),
     };
 
     screen::start_screen(Brain.Screen, pages, 3);
@@ -0,0 +1,78 @@
+/**
+ * File: bench_controller_bank.cpp
+ * Desc:
+ *    Times ControllerBank::update_all() against updating the same number of
+ *    PIDFF objects one at a time, and checks that both give the same outputs
+ *    (to float precision, the bank works in floats).
+ *    Run with `make -C tools/host bench_controller_bank`.
+ */
+#include "../core/include/utils/controls/controller_bank.h"
+#include "../core/include/utils/controls/pidff.h"
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+static const size_t num_loops = 500;
+static const int num_steps = 2000;
+
+static double us_since(std::chrono::steady_clock::time_point start) {
+    auto d = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+/// @brief a made up sensor reading for loop i at step s
+static double measurement(size_t i, int s) {
+    return 10.0 * std::sin(0.01 * s + 0.1 * i);
+}
+
+int main() {
+    std::vector<PID::pid_config_t> pid_cfgs(num_loops);
+    std::vector<FeedForward::ff_config_t> ff_cfgs(num_loops);
+    for (size_t i = 0; i < num_loops; i++) {
+        pid_cfgs[i] = {0.5 + 0.001 * i, 0.01, 0.02, 0.1, 0, PID::LINEAR};
+        ff_cfgs[i] = {0.05, 0.1, 0.01, 0.02};
+    }
+
+    ControllerBank bank(num_loops);
+    std::vector<std::unique_ptr<PIDFF>> singles;
+    for (size_t i = 0; i < num_loops; i++) {
+        bank.add_pidff(pid_cfgs[i], ff_cfgs[i]).init(0, 5);
+        singles.emplace_back(new PIDFF(pid_cfgs[i], ff_cfgs[i]));
+        singles.back()->init(0, 5, 0, 0);
+    }
+
+    double bank_us = 0, single_us = 0, max_diff = 0, max_out = 0;
+    std::vector<double> meas(num_loops);
+    for (int s = 0; s < num_steps; s++) {
+        // both see the same simulated 10ms step
+        vexDelay(10);
+        for (size_t i = 0; i < num_loops; i++) {
+            meas[i] = measurement(i, s);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bank.update_all(meas.data());
+        bank_us += us_since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < num_loops; i++) {
+            singles[i]->update(meas[i]);
+        }
+        single_us += us_since(start);
+
+        for (size_t i = 0; i < num_loops; i++) {
+            max_diff = std::fmax(
+                max_diff, std::fabs(bank.output(i) - singles[i]->get()));
+            max_out = std::fmax(max_out, std::fabs(singles[i]->get()));
+        }
+    }
+
+    printf("%zu loops, %d steps\n", num_loops, num_steps);
+    printf("ControllerBank::update_all  %8.2f us/step\n", bank_us / num_steps);
+    printf("PIDFF::update one at a time %8.2f us/step\n",
+           single_us / num_steps);
+    printf("largest output difference   %g (largest output %g)\n", max_diff,
+           max_out);
+    return max_diff < 1e-5 * max_out ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+/**
+ * File: bench_mpc.cpp
+ * Desc:
+ *    Runs MPC and MotionController through the same profiled move on a
+ *    simulated mechanism whose real constants are 10% off from the model
+ *    both controllers are given. Prints the tracking error and how long an
+ *    update takes for a few MPC horizons.
+ *    Run with `make -C tools/host bench_mpc`.
+ */
+#include "../core/include/utils/controls/motion_controller.h"
+#include "../core/include/utils/controls/mpc.h"
+#include <chrono>
+#include <cmath>
+
+static const double dt = 0.01;
+static const double move = 48;
+static const double max_v = 40;
+static const double accel = 80;
+static const double max_volts = 12;
+
+// What the controllers think the mechanism is
+static const FeedForward::ff_config_t model = {0.5, 0.2, 0.05, 0};
+
+/**
+ * A mechanism that follows output = kS*sgn(v) + kV*v + kA*a + kG with its
+ * real constants 10% bigger than the model's
+ */
+struct Mechanism {
+    double pos = 0, vel = 0;
+
+    void step(double volts) {
+        const double off = 1.1;
+        // smaller steps than the controller's for a smooth simulation
+        const int substeps = 10;
+        for (int i = 0; i < substeps; i++) {
+            double sgn = (vel > 0) ? 1.0 : ((vel < 0) ? -1.0 : 0.0);
+            double a = (volts - off * (model.kS * sgn + model.kV * vel +
+                                       model.kG)) /
+                       (off * model.kA);
+            vel += a * dt / substeps;
+            pos += vel * dt / substeps;
+        }
+    }
+};
+
+struct Result {
+    double rms_err;
+    double final_err;
+    double us_per_update;
+};
+
+/**
+ * @brief run one move with fb
+ * @param update what to call each step with the mechanism, returns volts
+ * @param ref the profile to measure tracking against
+ */
+template <typename Update>
+static Result run(Feedback &fb, Update update, TrapezoidProfile &ref) {
+    Mechanism m;
+    fb.set_limits(-max_volts, max_volts);
+    fb.init(0, move);
+
+    double sq_err = 0, busy_us = 0;
+    int steps = (int)((ref.get_movement_time() + 0.5) / dt);
+    for (int s = 0; s < steps; s++) {
+        // both controllers read the simulated clock
+        vexDelay((uint32_t)(dt * 1000));
+        auto start = std::chrono::steady_clock::now();
+        double volts = update(m);
+        busy_us += std::chrono::duration<double, std::micro>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+        m.step(volts);
+
+        double want = ref.calculate_time_based((s + 1) * dt).pos;
+        sq_err += (m.pos - want) * (m.pos - want);
+    }
+    return {std::sqrt(sq_err / steps), m.pos - move, busy_us / steps};
+}
+
+int main() {
+    TrapezoidProfile ref(max_v, accel);
+    ref.set_endpts(0, move);
+    // get_movement_time() is only right once the profile has been calculated
+    ref.calculate_time_based(0);
+
+    printf("%d unit move, mechanism 10%% off from the model\n", (int)move);
+    printf("%-22s %10s %10s %12s\n", "controller", "rms err", "final err",
+           "us/update");
+
+    MotionController::m_profile_cfg_t mc_cfg = {
+        max_v, accel, {1.5, 0, 0.05, 0.5, 0.1, PID::LINEAR}, model};
+    MotionController mc(mc_cfg);
+    Result r = run(mc, [&](Mechanism &m) { return mc.update(m.pos); }, ref);
+    printf("%-22s %10.3f %10.3f %12.2f\n", "MotionController", r.rms_err,
+           r.final_err, r.us_per_update);
+
+    const int horizons[] = {5, 10, 20};
+    for (int h : horizons) {
+        MPC::mpc_config_t cfg = {model, dt,    h,     10.0, 1.0, 0.1,
+                                 30,    max_v, accel, 0.5,  0.1};
+        MPC mpc(cfg);
+        r = run(mpc, [&](Mechanism &m) { return mpc.update(m.pos, m.vel); },
+                ref);
+        char name[32];
+        snprintf(name, sizeof(name), "MPC horizon %d", h);
+        printf("%-22s %10.3f %10.3f %12.2f\n", name, r.rms_err, r.final_err,
+               r.us_per_update);
+    }
+    return 0;
+}
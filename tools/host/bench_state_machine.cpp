@@ -0,0 +1,94 @@
+/**
+ * File: bench_state_machine.cpp
+ * Desc:
+ *    Drives a small table-driven StateMachine (with a parent state, so
+ *    transitions exit and enter more than one level) through a long cycle of
+ *    messages and reports how many transitions it handles a second. Each
+ *    transition is a send_message() and a step(), what the executor does for
+ *    a message.
+ *    Run with `make -C tools/host bench_state_machine`.
+ */
+#include "../core/include/utils/state_machine.h"
+#include <chrono>
+#include <string>
+
+enum class BenchState { Idle, Running, Slow, Fast, Stopping };
+enum class BenchMessage { Go, Faster, Slower, Stop, Done };
+// the machine's logging wants these, like cata.h's
+std::string to_string(BenchState s) { return std::to_string((int)s); }
+std::string to_string(BenchMessage m) { return std::to_string((int)m); }
+
+class BenchMachine
+    : public StateMachine<BenchMachine, BenchState, BenchMessage, 5> {
+  public:
+    static constexpr Transition transitions[] = {
+        {BenchState::Idle, BenchMessage::Go, BenchState::Running},
+        {BenchState::Slow, BenchMessage::Faster, BenchState::Fast},
+        {BenchState::Fast, BenchMessage::Slower, BenchState::Slow},
+        // Slow and Fast share this one through their parent
+        {BenchState::Running, BenchMessage::Stop, BenchState::Stopping},
+        {BenchState::Stopping, BenchMessage::Done, BenchState::Idle},
+    };
+
+    explicit BenchMachine(StateMachineExecutor *exec)
+        : StateMachine(all_states(), {BenchState::Idle}, exec) {}
+
+    uint32_t entries = 0;
+
+  private:
+    template <BenchState ID, BenchState Parent = ID>
+    struct Counted : State {
+        void entry(BenchMachine &m) override { m.entries++; }
+        BenchState id() const override { return ID; }
+        BenchState parent() const override { return Parent; }
+    };
+    struct RunningState : Counted<BenchState::Running> {
+        BenchState initial_child(BenchMachine &) override {
+            return BenchState::Slow;
+        }
+    };
+
+    // the base looks at the states before our members would be constructed
+    static std::vector<State *> all_states() {
+        return {new Counted<BenchState::Idle>(), new RunningState(),
+                new Counted<BenchState::Slow, BenchState::Running>(),
+                new Counted<BenchState::Fast, BenchState::Running>(),
+                new Counted<BenchState::Stopping>()};
+    }
+};
+constexpr BenchMachine::Transition BenchMachine::transitions[];
+
+int main() {
+    // never started: the benchmark steps the machine itself
+    StateMachineExecutor exec;
+    BenchMachine m(&exec);
+    uint32_t now = vex::timer::system();
+    m.step(now); // enter the initial state
+
+    const BenchMessage cycle[] = {BenchMessage::Go,     BenchMessage::Faster,
+                                  BenchMessage::Slower, BenchMessage::Faster,
+                                  BenchMessage::Stop,   BenchMessage::Done};
+    const int per_cycle = sizeof(cycle) / sizeof(cycle[0]);
+    const int cycles = 200000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < cycles; c++) {
+        for (int i = 0; i < per_cycle; i++) {
+            m.send_message(cycle[i]);
+            m.step(now);
+        }
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start)
+                   .count();
+
+    long transitions = (long)cycles * per_cycle;
+    printf("%ld transitions (%lu state entries) in %.3f s\n", transitions,
+           (unsigned long)m.entries, s);
+    printf("%.0f transitions/s, %.0f ns each\n", transitions / s,
+           s * 1e9 / transitions);
+    // every message should have moved it, and it ends where it started
+    bool ok = m.current_state() == BenchState::Idle &&
+              m.get_dwell(BenchState::Idle).count == (uint32_t)cycles;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+/**
+ * File: bench_video.cpp
+ * Desc:
+ *    Benchmarks the video player's frame conversion and checks its pacing.
+ *    The clip is made here: a few seconds of 320x176 MPEG-1 at 30fps, every
+ *    picture an I frame of moving gradients with some detail in each block
+ *    so the decoder has real work to do. It's small enough to build in
+ *    memory, so there is no file to keep around.
+ *
+ *    Conversion: decodes every frame, then times pl_mpeg's plm_frame_to_bgra
+ *    against frame_to_bgra_fast on it and checks they give the same pixels.
+ *
+ *    Pacing: plays the clip through a FramePacer on the simulated clock,
+ *    with decoding and converting taking a set time per frame like they do
+ *    on the brain, and reports how many frames a second are shown.
+ *    Run with `make -C tools/host bench_video`.
+ */
+#include "../core/include/subsystems/fun/video_frames.h"
+#include "vex.h"
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+// after video_frames.h has included the declarations, like video.cpp does
+#define PL_MPEG_IMPLEMENTATION
+#include "../core/include/subsystems/fun/pl_mpeg.h"
+
+static const int clip_w = 320, clip_h = 176;
+static const int clip_frames = 90;
+static const int rate_code = 5; // 30fps in the sequence header
+
+/// @brief writes bits most significant first, like MPEG wants them
+struct BitWriter {
+    std::vector<uint8_t> bytes;
+    int used = 8; ///< bits used in the last byte
+
+    void put(uint32_t value, int bits) {
+        for (int i = bits - 1; i >= 0; i--) {
+            if (used == 8) {
+                bytes.push_back(0);
+                used = 0;
+            }
+            bytes.back() |= ((value >> i) & 1) << (7 - used);
+            used++;
+        }
+    }
+    /// @brief pad to a whole byte, then write a start code
+    void start_code(uint8_t code) {
+        used = 8;
+        for (uint8_t b : {0, 0, 1}) {
+            bytes.push_back(b);
+        }
+        bytes.push_back(code);
+    }
+};
+
+/// @brief an intra DC difference: its size from the table, then the bits
+static void put_dc(BitWriter &bw, int diff, bool luma) {
+    static const char *luma_size[] = {"100",    "00",      "01",
+                                      "101",    "110",     "1110",
+                                      "11110",  "111110",  "1111110"};
+    static const char *chroma_size[] = {"00",      "01",     "10",
+                                        "110",     "1110",   "11110",
+                                        "111110",  "1111110", "11111110"};
+    int mag = diff < 0 ? -diff : diff;
+    int size = 0;
+    while ((1 << size) <= mag) {
+        size++;
+    }
+    for (const char *c = (luma ? luma_size : chroma_size)[size]; *c; c++) {
+        bw.put(*c == '1', 1);
+    }
+    if (size > 0) {
+        // negative differences are sent as diff + 2^size - 1
+        bw.put(diff > 0 ? diff : diff + (1 << size) - 1, size);
+    }
+}
+
+/// @brief one 8x8 block: its DC, a few AC coefficients, end of block
+static void put_block(BitWriter &bw, int &predictor, int dc, bool luma,
+                      uint32_t &seed) {
+    put_dc(bw, dc - predictor, luma);
+    predictor = dc;
+    int n = 0;
+    for (int k = 0; k < 4; k++) {
+        seed = seed * 1103515245 + 12345;
+        int run = (seed >> 16) % 4;
+        int level = (int)((seed >> 20) % 7) - 3;
+        if (level == 0 || n + run >= 20) {
+            continue;
+        }
+        n += run + 1;
+        // escape: run in 6 bits, level in 8
+        bw.put(1, 6);
+        bw.put(run, 6);
+        bw.put(level & 0xFF, 8);
+    }
+    bw.put(2, 2); // end of block
+}
+
+/// @return an MPEG-1 video stream of only I frames
+static std::vector<uint8_t> make_clip() {
+    BitWriter bw;
+    bw.start_code(0xB3);
+    bw.put(clip_w, 12);
+    bw.put(clip_h, 12);
+    bw.put(1, 4);          // square pixels
+    bw.put(rate_code, 4);
+    bw.put(0x3FFFF, 18);   // variable bit rate
+    bw.put(1, 1);          // marker
+    bw.put(32, 10);        // vbv buffer size
+    bw.put(0, 3);          // not constrained, default quant matrices
+
+    uint32_t seed = 1;
+    int mb_w = (clip_w + 15) / 16, mb_h = (clip_h + 15) / 16;
+    for (int f = 0; f < clip_frames; f++) {
+        bw.start_code(0x00);
+        bw.put(f % 1024, 10); // temporal reference
+        bw.put(1, 3);         // I frame
+        bw.put(0xFFFF, 16);   // vbv delay
+        bw.put(0, 1);
+
+        for (int row = 0; row < mb_h; row++) {
+            bw.start_code(row + 1);
+            bw.put(8, 5); // quantizer scale
+            bw.put(0, 1);
+            int pred[3] = {128, 128, 128};
+            for (int col = 0; col < mb_w; col++) {
+                bw.put(1, 1); // next macroblock
+                bw.put(1, 1); // intra
+                for (int b = 0; b < 4; b++) {
+                    int x = col * 2 + (b & 1), y = row * 2 + (b >> 1);
+                    int dc = 40 + (x * 4 + y * 3 + f * 2) % 180;
+                    put_block(bw, pred[0], dc, true, seed);
+                }
+                put_block(bw, pred[1], 128 + (col * 6 + f) % 60 - 30, false,
+                          seed);
+                put_block(bw, pred[2], 128 - (row * 8 + f) % 60 + 30, false,
+                          seed);
+            }
+        }
+    }
+    bw.start_code(0xB7);
+    return bw.bytes;
+}
+
+/// @brief where load_clip is in the clip
+struct ClipSource {
+    const std::vector<uint8_t> *clip;
+    size_t at;
+};
+
+/**
+ * @brief pl_mpeg's load callback, handing it the clip a piece at a time the
+ * way video.cpp hands it the file
+ */
+static void load_clip(plm_buffer_t *self, void *user) {
+    ClipSource *src = (ClipSource *)user;
+    if (self->discard_read_bytes) {
+        plm_buffer_discard_read_bytes(self);
+    }
+    size_t n = src->clip->size() - src->at;
+    n = n < self->capacity - self->length ? n : self->capacity - self->length;
+    if (n == 0) {
+        self->has_ended = TRUE;
+        return;
+    }
+    memcpy(self->bytes + self->length, src->clip->data() + src->at, n);
+    self->length += n;
+    src->at += n;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+struct Pacing {
+    int shown, skipped;
+    double seconds; ///< simulated time to get through the clip
+};
+
+/**
+ * @brief play clip_frames frames through a FramePacer, checking every 5ms
+ * like the video task does
+ * @param decode_ms how long decoding a frame takes
+ * @param convert_ms how long converting one takes, skipped frames skip it
+ */
+static Pacing play(uint32_t decode_ms, uint32_t convert_ms) {
+    const uint32_t tick_ms = 5;
+    FramePacer pacer(1000000 / 30, 4, 500000);
+    uint64_t start = vex::timer::systemHighResolution();
+    pacer.restart(start);
+
+    Pacing p = {0, 0, 0};
+    bool worked = false;
+    for (int decoded = 0; decoded < clip_frames;) {
+        // PeriodicTask releases the task on a fixed timeline: the next
+        // multiple of tick_ms, right away if a run ended on one
+        uint32_t into_tick = (uint32_t)((vex::timer::systemHighResolution() -
+                                         start) / 1000) % tick_ms;
+        if (worked) {
+            vexDelay((tick_ms - into_tick) % tick_ms);
+        } else {
+            vexDelay(tick_ms - into_tick);
+        }
+        worked = pacer.due(vex::timer::systemHighResolution());
+        if (!worked) {
+            continue;
+        }
+        vexDelay(decode_ms);
+        decoded++;
+        if (pacer.decoded(vex::timer::systemHighResolution())) {
+            vexDelay(convert_ms);
+            p.shown++;
+        } else {
+            p.skipped++;
+        }
+    }
+    p.seconds = (vex::timer::systemHighResolution() - start) / 1e6;
+    return p;
+}
+
+int main() {
+    std::vector<uint8_t> clip = make_clip();
+    ClipSource source = {&clip, 0};
+    plm_buffer_t *buf = plm_buffer_create_with_capacity(64 * 1024);
+    plm_buffer_set_load_callback(buf, load_clip, &source);
+    plm_video_t *video = plm_video_create_with_buffer(buf, TRUE);
+    init_convert_tables();
+
+    const int reps = 20;
+    size_t bytes = (size_t)clip_w * clip_h * 4;
+    std::vector<uint8_t> theirs(bytes), ours(bytes);
+    double decode_s = 0, theirs_s = 0, ours_s = 0;
+    int frames = 0, mismatched = 0;
+    for (;;) {
+        auto t = std::chrono::steady_clock::now();
+        plm_frame_t *frame = plm_video_decode(video);
+        decode_s += seconds_since(t);
+        if (frame == NULL) {
+            break;
+        }
+        frames++;
+
+        t = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            plm_frame_to_bgra(frame, theirs.data(), clip_w * 4);
+        }
+        theirs_s += seconds_since(t);
+
+        t = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            frame_to_bgra_fast(frame, ours.data(), clip_w * 4);
+        }
+        ours_s += seconds_since(t);
+
+        // pl_mpeg leaves alpha alone, and it started out 0
+        mismatched += memcmp(theirs.data(), ours.data(), bytes) != 0;
+    }
+    plm_video_destroy(video);
+
+    printf("%d frames of %dx%d, %lu bytes of MPEG-1\n", frames, clip_w, clip_h,
+           (unsigned long)clip.size());
+    printf("%-20s %10s %12s\n", "", "ms/frame", "frames/s");
+    printf("%-20s %10.3f %12.0f\n", "decode", 1000 * decode_s / frames,
+           frames / decode_s);
+    double n = (double)frames * reps;
+    printf("%-20s %10.3f %12.0f\n", "plm_frame_to_bgra", 1000 * theirs_s / n,
+           n / theirs_s);
+    printf("%-20s %10.3f %12.0f\n", "frame_to_bgra_fast", 1000 * ours_s / n,
+           n / ours_s);
+    printf("%d frames converted differently\n", mismatched);
+
+    // Decode and convert times like the brain's: keeping up easily, just
+    // barely not, and well behind
+    const uint32_t costs[][2] = {{12, 8}, {20, 15}, {30, 20}};
+    printf("\npacing a %.1f s clip at 30fps\n", clip_frames / 30.0);
+    printf("%-18s %6s %8s %10s %10s\n", "decode+convert ms", "shown",
+           "skipped", "shown/s", "took s");
+    bool pacing_ok = true;
+    for (const uint32_t *c : costs) {
+        Pacing p = play(c[0], c[1]);
+        char label[32];
+        snprintf(label, sizeof(label), "%lu+%lu", (unsigned long)c[0],
+                 (unsigned long)c[1]);
+        printf("%-18s %6d %8d %10.1f %10.2f\n", label, p.shown, p.skipped,
+               p.shown / p.seconds, p.seconds);
+        // fast enough: every frame shown, and on time
+        if (c[0] + c[1] < 1000 / 30) {
+            pacing_ok &= p.skipped == 0 &&
+                         p.seconds < clip_frames / 30.0 + 2 * 1.0 / 30;
+        }
+    }
+
+    bool ok = frames == clip_frames && mismatched == 0 && pacing_ok;
+    return ok ? 0 : 1;
+}
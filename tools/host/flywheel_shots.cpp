@@ -0,0 +1,149 @@
+/**
+ * File: flywheel_shots.cpp
+ * Desc:
+ *    Runs a flywheel the way Flywheel's rpm task does (feedforward plus PID
+ *    on the measured rpm every 5ms) through a string of shots, once measuring
+ *    with a MovingAverage and once with a FlywheelObserver, with and without
+ *    its recovery boost. The simulated wheel is 5% off from the model the
+ *    observer is given, its readings are noisy and each shot takes 400 rpm
+ *    off it at once. Prints how long the wheel takes to get back within
+ *    50 rpm of the target after a shot, how far it overshoots on the way,
+ *    how far the rpm the PID sees is from the wheel's real speed while
+ *    holding (noise, and for the observer the bias from the model being
+ *    off), and how many of the shots the observer noticed. The PID is
+ *    proportional only, with the feedforward doing most of the holding, so
+ *    the wheel has settled a little under the target by the first shot.
+ *    Run with `make -C tools/host flywheel_shots`.
+ */
+#include "../core/include/utils/controls/feedforward.h"
+#include "../core/include/utils/controls/flywheel_observer.h"
+#include "../core/include/utils/controls/pid.h"
+#include "../core/include/utils/moving_average.h"
+#include <cmath>
+#include <random>
+
+static const double dt = 0.005;
+static const double target = 3000;
+static const double shot_drop = 400;
+static const int num_shots = 10;
+static const double first_shot = 2.0;
+static const double shot_spacing = 1.0;
+static const double recovered_within = 50;
+
+// what the controller and observer think the wheel is
+static const double model_kV = 1.0 / 4000, model_tau = 0.4;
+
+/// @brief the real wheel: 5% slower to respond and 5% less rpm per output
+struct Wheel {
+    double rpm = 0;
+    void step(double output) {
+        double u = fmax(-1.0, fmin(1.0, output)); // the motor can only do 12V
+        double a = dt / (1.05 * model_tau);
+        rpm += a * (u / (1.05 * model_kV) - rpm);
+    }
+};
+
+struct Result {
+    double recover_ms;   ///< average over the shots
+    double overshoot;    ///< most rpm over the target after a shot
+    double err_rms;      ///< rpm the PID saw minus the real rpm, before
+                         ///< the first shot
+    int detected;        ///< shots the observer counted
+};
+
+/**
+ * @brief run the wheel through its shots
+ * @param obs the observer to measure with, or null for the moving average
+ * @param use_boost add the observer's boost to the output like Flywheel does
+ */
+static Result run(FlywheelObserver *obs, bool use_boost) {
+    std::mt19937 gen(1234);
+    std::normal_distribution<double> noise(0, 30);
+
+    PID::pid_config_t pid_cfg = {0.002, 0, 0, 0, 0, PID::LINEAR};
+    PID pid(pid_cfg);
+    FeedForward::ff_config_t ff_cfg = {0, model_kV, 0, 0};
+    FeedForward ff(ff_cfg);
+    MovingAverage avg(10);
+    Wheel wheel;
+
+    pid.init(0, target);
+    if (obs != nullptr) {
+        obs->reset(0);
+    }
+
+    double last_output = 0, err_sq = 0, shot_time = -1;
+    double sum_recover = 0, overshoot = 0;
+    int err_samples = 0, shots = 0, recovered = 0;
+    double end = first_shot + num_shots * shot_spacing;
+    for (int s = 0; s * dt < end; s++) {
+        double t = s * dt;
+        vexDelay(5); // the PID reads the simulated clock
+
+        if (shots < num_shots && t >= first_shot + shots * shot_spacing) {
+            wheel.rpm -= shot_drop;
+            shot_time = t;
+            shots++;
+        }
+
+        double reading = wheel.rpm + noise(gen);
+        double rpm;
+        if (obs != nullptr) {
+            rpm = obs->update(reading, last_output, dt);
+        } else {
+            avg.add_entry(reading);
+            rpm = avg.get_value();
+        }
+
+        // holding speed: how far off is what the PID sees
+        if (t > first_shot - 0.5 && t < first_shot) {
+            err_sq += (rpm - wheel.rpm) * (rpm - wheel.rpm);
+            err_samples++;
+        }
+
+        pid.update(rpm);
+        double output = ff.calculate(target, 0, 0) + pid.get();
+        if (obs != nullptr && use_boost) {
+            output += obs->get_boost();
+        }
+        last_output = output;
+        wheel.step(output);
+
+        if (shot_time >= 0) {
+            if (recovered < shots &&
+                fabs(wheel.rpm - target) < recovered_within) {
+                sum_recover += t + dt - shot_time;
+                recovered++;
+            }
+            overshoot = fmax(overshoot, wheel.rpm - target);
+        }
+    }
+    return {1000 * sum_recover / (recovered > 0 ? recovered : 1), overshoot,
+            sqrt(err_sq / err_samples), obs != nullptr ? obs->shots() : 0};
+}
+
+int main() {
+    FlywheelObserver::observer_config_t cfg = {
+        model_kV, model_tau, 20000, 900, 200, 0.3, 0.1};
+
+    printf("%d shots of %.0f rpm at %.0f rpm, readings +/-30 rpm, wheel 5%% "
+           "off the model\n",
+           num_shots, shot_drop, target);
+    printf("%-24s %10s %10s %10s %6s\n", "measured with", "recover ms",
+           "overshoot", "rms error", "shots");
+
+    Result r = run(nullptr, false);
+    printf("%-24s %10.0f %10.0f %10.1f %6s\n", "MovingAverage(10)",
+           r.recover_ms, r.overshoot, r.err_rms, "-");
+
+    FlywheelObserver plain(cfg);
+    r = run(&plain, false);
+    printf("%-24s %10.0f %10.0f %10.1f %6d\n", "observer, no boost",
+           r.recover_ms, r.overshoot, r.err_rms, r.detected);
+
+    FlywheelObserver boosted(cfg);
+    r = run(&boosted, true);
+    printf("%-24s %10.0f %10.0f %10.1f %6d\n", "observer with boost",
+           r.recover_ms, r.overshoot, r.err_rms, r.detected);
+    return r.detected == num_shots ? 0 : 1;
+}
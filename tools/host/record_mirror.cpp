@@ -0,0 +1,109 @@
+/**
+ * File: record_mirror.cpp
+ * Desc:
+ *    Draws a few seconds of an odometry-like page through Canvas and
+ *    MirrorStream the way the screen task does, and saves what would have
+ *    gone out the serial port. Some printf output lands between packets and
+ *    once in the middle of one, like it does on the brain.
+ *    tools/mirror/fixtures/odometry.bin was made with
+ *    `tools/host/build/record_mirror tools/mirror/fixtures/odometry.bin`.
+ */
+#include "../core/include/subsystems/screen_mirror.h"
+#include <string.h>
+#include <vector>
+
+static std::vector<uint8_t> serial_out;
+static int writes = 0;
+/// write number that gets printf output spliced into its middle
+static const int corrupt_write = 40;
+
+extern "C" {
+int32_t vexSerialWriteFree(uint32_t) { return 1024; }
+int32_t vexSerialWriteBuffer(uint32_t, uint8_t *data, int32_t len) {
+    writes++;
+    if (writes == corrupt_write && len > 2) {
+        const char *noise = "printf in the middle\n";
+        serial_out.insert(serial_out.end(), data, data + len / 2);
+        serial_out.insert(serial_out.end(), noise, noise + strlen(noise));
+        serial_out.insert(serial_out.end(), data + len / 2, data + len);
+        return len;
+    }
+    serial_out.insert(serial_out.end(), data, data + len);
+    return len;
+}
+}
+
+static void print_noise(const char *s) {
+    serial_out.insert(serial_out.end(), s, s + strlen(s));
+}
+
+static const int field_size = 240;
+static const int field_x = 240;
+
+int main(int argc, char **argv) {
+    const char *out_name = argc > 1 ? argv[1] : "mirror_stream.bin";
+
+    // a field with a differently colored quarter in each corner
+    std::vector<uint32_t> field(field_size * field_size);
+    for (int y = 0; y < field_size; y++) {
+        for (int x = 0; x < field_size; x++) {
+            bool right = x >= field_size / 2, bottom = y >= field_size / 2;
+            field[y * field_size + x] = bottom ? (right ? 0xFFFFFF : 0x0000FF)
+                                               : (right ? 0x00FF00 : 0xFF0000);
+        }
+    }
+
+    vex::brain brain;
+    screen::MirrorStream mirror(20000, 10);
+    bool full = true;
+    double rx = 60, ry = 120;
+    for (int frame = 0; frame < 90; frame++) {
+        vexDelay(33);
+        if (mirror.wants_full_frame()) {
+            full = true;
+        }
+        screen::Canvas scr(brain.Screen, &mirror);
+        int old_x = (int)rx, old_y = (int)ry;
+        rx += 1.2;
+        ry += 0.4 * ((frame / 20) % 2 == 0 ? 1 : -1);
+
+        if (full) {
+            mirror.restart();
+            scr.clearScreen(vex::color::black);
+            scr.setPenColor(vex::color(80, 80, 80));
+            scr.drawRectangle(0, 0, 40, 240);
+            scr.setPenColor(vex::color::white);
+            scr.drawImageFromBuffer(field.data(), field_x, 0, field_size,
+                                    field_size, field_size);
+            full = false;
+        } else {
+            // the robot moved: draw the field back over where it was
+            int x1 = field_x + old_x - 6, y1 = old_y - 6;
+            scr.setClipRegion(x1, y1, 12, 12);
+            scr.drawImageFromBuffer(
+                field.data() + y1 * field_size + (x1 - field_x), x1, y1, 12,
+                12, field_size);
+            scr.setClipRegion(0, 0, 480, 240);
+        }
+        scr.printAt(45, 30, true, "(%.2f, %.2f)", rx, ry);
+        scr.printAt(45, 50, true, "frame %d", frame);
+        scr.drawCircle(field_x + (int)rx, (int)ry, 3, vex::color::white);
+        mirror.flush();
+
+        if (frame % 25 == 10) {
+            print_noise("odom: some printf output\n");
+        }
+    }
+
+    FILE *f = fopen(out_name, "wb");
+    if (f == nullptr) {
+        printf("couldn't open %s\n", out_name);
+        return 1;
+    }
+    fwrite(serial_out.data(), 1, serial_out.size(), f);
+    fclose(f);
+    printf("%lu bytes in %d writes to %s, %lu resyncs\n",
+           (unsigned long)serial_out.size(), writes, out_name,
+           (unsigned long)mirror.resyncs());
+    return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * File: relay_autotune.cpp
+ * Desc:
+ *    Runs RelayAutotuner against a simulated flywheel-like mechanism (a
+ *    FirstOrderPlant with gain K and time constant tau behind L seconds of
+ *    dead time, which is what gives it a real ultimate gain) and checks what
+ *    it measures against the values worked out from the model.
+ *
+ *    A relay of +/-d around the holding output makes this model oscillate
+ *    with half height a = K*d*(1 - e^(-L/tau)) and period
+ *    2*(L + tau*ln(2 - e^(-L/tau))), so the tuner should find
+ *    Ku = 4*d/(pi*a) and that period almost exactly. The true ultimate point
+ *    (phase -180 where w*L + atan(w*tau) = pi, Ku = sqrt(1 + (w*tau)^2)/K,
+ *    Tu = 2*pi/w) is only approximated by a relay test: it sees the first
+ *    harmonic of a square wave, and underestimates Ku by more the more the
+ *    dead time dominates. That comparison gets a looser tolerance.
+ *    Run with `make -C tools/host relay_autotune`.
+ */
+#include "../core/include/utils/controls/relay_autotuner.h"
+#include "../core/include/utils/controls/response_analyzer.h"
+#include <cmath>
+#include <deque>
+
+/// @brief delays the input to another plant by a whole number of samples
+class DeadTimePlant : public Plant {
+  public:
+    DeadTimePlant(Plant &inner, int samples) : inner(inner), samples(samples) {}
+    void reset(double x0) override {
+        inner.reset(x0);
+        queue.assign(samples, 0.0);
+    }
+    double step(double u, double dt) override {
+        queue.push_back(u);
+        double late = queue.front();
+        queue.pop_front();
+        return inner.step(late, dt);
+    }
+
+  private:
+    Plant &inner;
+    int samples;
+    std::deque<double> queue;
+};
+
+/// @brief the frequency where the model's phase is -180 degrees
+static double phase_crossover(double tau, double dead_time) {
+    double lo = 0, hi = M_PI / dead_time;
+    for (int k = 0; k < 100; k++) {
+        double w = (lo + hi) / 2;
+        if (w * dead_time + atan(w * tau) < M_PI) {
+            lo = w;
+        } else {
+            hi = w;
+        }
+    }
+    return (lo + hi) / 2;
+}
+
+static bool near(const char *what, double got, double want, double tol) {
+    double err = fabs(got - want) / fabs(want);
+    bool ok = err <= tol;
+    printf("%-12s %9.4f  model %9.4f  %5.1f%% off  %s\n", what, got, want,
+           100 * err, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main() {
+    const double gain = 10, tau = 0.5; // units per volt, seconds
+    const double dt = RelayAutotuner::period_ms / 1000.0;
+    const int delay_samples = 10;
+    const double setpoint = 50, amplitude = 2;
+
+    FirstOrderPlant lag(gain, tau);
+    DeadTimePlant plant(lag, delay_samples);
+    plant.reset(0);
+
+    // started well off the holding output, so the bias has to find it
+    RelayAutotuner tuner([]() { return 0.0; }, [](double) {}, setpoint,
+                         amplitude, 4.0, 10);
+    double t = 0, y = 0;
+    tuner.begin(y, t);
+    while (!tuner.done() && t < 60) {
+        double u = tuner.update(y, t);
+        y = plant.step(u, dt);
+        t += dt;
+    }
+    RelayAutotuner::result_t r = tuner.result();
+    printf("%d cycles in %.1f s of simulated time\n", tuner.cycles_seen(), t);
+    if (!r.valid) {
+        printf("the test never finished\n");
+        return 1;
+    }
+
+    // The output holds for a whole sample, which lags it by half of one
+    const double dead_time = delay_samples * dt + dt / 2;
+    const double swing = gain * amplitude; // K*d
+    double relay_a = swing * (1 - exp(-dead_time / tau));
+    double relay_ku = 4 * amplitude / (M_PI * relay_a);
+    double relay_tu = 2 * (dead_time + tau * log(2 - exp(-dead_time / tau)));
+
+    double w = phase_crossover(tau, dead_time);
+    double ultimate_ku = sqrt(1 + w * tau * w * tau) / gain;
+    double ultimate_tu = 2 * M_PI / w;
+
+    bool ok = true;
+    printf("against the relay oscillation the model makes:\n");
+    ok &= near("Ku", r.ku, relay_ku, 0.05);
+    ok &= near("Tu (s)", r.tu, relay_tu, 0.05);
+    ok &= near("hold output", r.mean_output, setpoint / gain, 0.03);
+
+    PID::pid_config_t base = {0, 0, 0, 1, 0.1, PID::LINEAR};
+    PID::pid_config_t zn =
+        tuner.pid_gains(RelayAutotuner::Rule::ZieglerNichols, base);
+    ok &= near("ZN p", zn.p, 0.6 * relay_ku, 0.05);
+    ok &= near("ZN i", zn.i, 0.6 * relay_ku / (0.5 * relay_tu), 0.05);
+    ok &= near("ZN d", zn.d, 0.6 * relay_ku * 0.125 * relay_tu, 0.05);
+
+    FeedForward::ff_config_t ff =
+        tuner.ff_gains(true, FeedForward::ff_config_t{0, 0, 0, 0});
+    ok &= near("kV", ff.kV, 1 / gain, 0.03);
+
+    printf("against the model's true ultimate point:\n");
+    ok &= near("Ku", r.ku, ultimate_ku, 0.20);
+    ok &= near("Tu (s)", r.tu, ultimate_tu, 0.05);
+    return ok ? 0 : 1;
+}
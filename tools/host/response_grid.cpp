@@ -0,0 +1,84 @@
+/**
+ * File: response_grid.cpp
+ * Desc:
+ *    Runs ResponseAnalyzer::pid_grid over a few hundred PID gain combinations
+ *    on an InertiaPlant, the kind of sweep that would take hours of waiting
+ *    on the brain. The simulated clock lets the analyzer's default advance
+ *    (a vexDelay) pass time instantly.
+ *    Run with `make -C tools/host response_grid`, or run
+ *    `tools/host/build/response_grid --csv` for every result as csv.
+ */
+#include "../core/include/utils/controls/response_analyzer.h"
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+int main(int argc, char **argv) {
+    bool csv = argc > 1 && strcmp(argv[1], "--csv") == 0;
+
+    // a lift-ish mechanism, in inches and volts
+    FeedForward::ff_config_t model = {0.05, 0.15, 0.02, 0.4};
+    InertiaPlant plant(model);
+
+    std::vector<double> ps, is, ds;
+    for (int k = 1; k <= 12; k++) {
+        ps.push_back(0.5 * k);
+    }
+    for (int k = 0; k < 4; k++) {
+        is.push_back(0.5 * k);
+    }
+    for (int k = 0; k < 5; k++) {
+        ds.push_back(0.05 * k);
+    }
+    PID::pid_config_t base = {0, 0, 0, 0.25, 0.1, PID::LINEAR};
+
+    const double dt = 0.01;
+    const double duration = 3;
+    const int points = 10;
+    ResponseAnalyzer analyzer(dt);
+
+    uint32_t sim_start = vex::timer::system();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ResponseAnalyzer::grid_result_t> results =
+        analyzer.pid_grid(base, ps, is, ds, nullptr, plant, 0, 20, duration,
+                          0.1, 20, points, 1.0);
+    double host_s = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    double sim_s = (vex::timer::system() - sim_start) / 1000.0;
+
+    if (csv) {
+        ResponseAnalyzer::print_csv(results);
+        return 0;
+    }
+
+    printf("%zu combinations, %.0f s of simulated time in %.2f s\n",
+           results.size(), sim_s, host_s);
+
+    // best settling times among the runs that settled without much overshoot
+    std::vector<ResponseAnalyzer::grid_result_t> good;
+    for (const ResponseAnalyzer::grid_result_t &r : results) {
+        if (r.step.settled && r.step.overshoot < 0.05) {
+            good.push_back(r);
+        }
+    }
+    std::sort(good.begin(), good.end(),
+              [](const ResponseAnalyzer::grid_result_t &a,
+                 const ResponseAnalyzer::grid_result_t &b) {
+                  return a.step.settling_time < b.step.settling_time;
+              });
+    printf("%zu settled with under 5%% overshoot, fastest:\n", good.size());
+    printf("%6s %6s %6s %8s %8s %8s %8s\n", "p", "i", "d", "rise", "settle",
+           "over", "pm_deg");
+    for (size_t k = 0; k < good.size() && k < 5; k++) {
+        const ResponseAnalyzer::grid_result_t &r = good[k];
+        char pm[16] = "-";
+        if (r.margins.has_phase_margin) {
+            snprintf(pm, sizeof(pm), "%.1f", r.margins.phase_margin_deg);
+        }
+        printf("%6.2f %6.2f %6.2f %8.2f %8.2f %8.3f %8s\n", r.cfg.p, r.cfg.i,
+               r.cfg.d, r.step.rise_time, r.step.settling_time,
+               r.step.overshoot, pm);
+    }
+    return results.empty() ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * File: sim_vex.cpp
+ * Desc:
+ *    Just enough of the vex SDK to run the controls code on a computer.
+ *    Time is simulated: nothing moves the clock except vexDelay() (and
+ *    vex::wait / task::sleep, which call it), so a loop that waits 10ms per
+ *    step runs as fast as the computer can go and still sees 10ms pass.
+ *    Tasks never run, there is only the one thread.
+ */
+#include "vex.h"
+#include <stdarg.h>
+
+static uint64_t sim_us = 0;
+
+extern "C" {
+void vexDelay(uint32_t ms) { sim_us += (uint64_t)ms * 1000; }
+uint32_t vexSystemTimeGet() { return (uint32_t)(sim_us / 1000); }
+uint64_t vexSystemHighResTimeGet() { return sim_us; }
+double vexBatteryVoltageGet() { return 12800.0; }
+// there's no SD card, nothing is ever opened. pl_mpeg closes what it opened
+void vexFileClose(FIL *) {}
+int vex_printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vprintf(fmt, args);
+    va_end(args);
+    return n;
+}
+int vex_vsnprintf(char *buf, size_t n, const char *fmt, va_list args) {
+    return vsnprintf(buf, n, fmt, args);
+}
+}
+
+namespace vex {
+
+const color color::black(0, 0, 0);
+const color color::white(255, 255, 255);
+const color color::red(255, 0, 0);
+const color color::green(0, 255, 0);
+const color color::blue(0, 0, 255);
+const color color::yellow(255, 255, 0);
+const color color::orange(255, 165, 0);
+const color color::purple(255, 0, 255);
+const color color::cyan(0, 255, 255);
+const color color::transparent;
+
+timer::timer() { reset(); }
+void timer::reset() { start_us = sim_us; }
+void timer::clear() { reset(); }
+double timer::value() const { return time(timeUnits::sec); }
+double timer::time(timeUnits u) const {
+    double s = (double)(sim_us - start_us) / 1e6;
+    return u == timeUnits::sec ? s : s * 1000.0;
+}
+uint32_t timer::time() { return (uint32_t)time(timeUnits::msec); }
+uint32_t timer::system() { return vexSystemTimeGet(); }
+uint64_t timer::systemHighResolution() { return vexSystemHighResTimeGet(); }
+
+void mutex::lock() {}
+bool mutex::try_lock() { return true; }
+void mutex::unlock() {}
+
+task::task() {}
+task::task(int (*)(void *), void *) {}
+task::task(int (*)(void *), void *, int32_t) {}
+bool task::stop() { return true; }
+void task::sleep(uint32_t ms) { vexDelay(ms); }
+void task::yield() {}
+
+namespace this_thread {
+void sleep_for(uint32_t ms) { vexDelay(ms); }
+int32_t get_id() { return 0; }
+void yield() {}
+} // namespace this_thread
+
+void wait(double t, timeUnits u) {
+    vexDelay((uint32_t)(u == timeUnits::sec ? t * 1000.0 : t));
+}
+} // namespace vex
@@ -0,0 +1,32 @@
+#pragma once
+/**
+ * A stand-in for the parts of the vex SDK the robot code uses, so it can be
+ * compiled on a computer. Device functions do nothing and return 0. Time is
+ * simulated, see sim_vex.cpp.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+typedef uint32_t FIL;
+#include <stdarg.h>
+extern "C" {
+FIL *vexFileOpen(const char *, const char *);
+FIL *vexFileOpenWrite(const char *);
+FIL *vexFileOpenCreate(const char *);
+void vexFileClose(FIL *);
+int32_t vexFileRead(char *, uint32_t, uint32_t, FIL *);
+int32_t vexFileWrite(char *, uint32_t, uint32_t, FIL *);
+int32_t vexFileSeek(FIL *, uint32_t, int32_t);
+int32_t vexFileTell(FIL *);
+int32_t vexFileSize(FIL *);
+int vex_vsnprintf(char *, size_t, const char *, va_list);
+int vex_printf(const char *, ...);
+double vexBatteryVoltageGet();
+void vexDelay(uint32_t ms);
+uint32_t vexSystemTimeGet();
+uint64_t vexSystemHighResTimeGet();
+int32_t vexSerialWriteBuffer(uint32_t channel, uint8_t *data, int32_t len);
+int32_t vexSerialWriteFree(uint32_t channel);
+typedef struct __attribute((packed)) _v5_image { uint16_t width; uint16_t height; uint32_t *data; uint32_t *p; } v5_image;
+uint32_t vexImagePngRead(const uint8_t *ibuf, v5_image *oBuf, uint32_t maxw, uint32_t maxh, uint32_t ibuflen);
+}
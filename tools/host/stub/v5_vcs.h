@@ -0,0 +1,390 @@
+#pragma once
+/**
+ * A stand-in for the parts of the vex SDK the robot code uses, so it can be
+ * compiled on a computer. Device functions do nothing and return 0. Time is
+ * simulated, see sim_vex.cpp.
+ */
+#include <stdint.h>
+#include <functional>
+#include <initializer_list>
+namespace vex {
+enum PORT_ { PORT1, PORT2, PORT3, PORT4, PORT5, PORT6, PORT7, PORT8, PORT9, PORT10, PORT11, PORT12, PORT13, PORT14, PORT15, PORT16, PORT17, PORT18, PORT19, PORT20, PORT21 };
+const int32_t PORT22 = 21;
+enum class directionType { fwd, rev, undefined };
+const directionType fwd = directionType::fwd, forward = directionType::fwd, reverse = directionType::rev;
+enum class brakeType { coast, brake, hold, undefined };
+enum class voltageUnits { volt, mV };
+const voltageUnits volt = voltageUnits::volt;
+enum class rotationUnits { deg, rev, raw };
+const rotationUnits deg = rotationUnits::deg, degrees = rotationUnits::deg, rev = rotationUnits::rev;
+enum class velocityUnits { pct, rpm, dps };
+const velocityUnits rpm = velocityUnits::rpm;
+enum class percentUnits { pct };
+const percentUnits percent = percentUnits::pct, pct = percentUnits::pct;
+enum class timeUnits { sec, msec };
+const timeUnits sec = timeUnits::sec, seconds = timeUnits::sec, msec = timeUnits::msec;
+enum class temperatureUnits { celsius, fahrenheit };
+const temperatureUnits celsius = temperatureUnits::celsius;
+enum class currentUnits { amp };
+enum class distanceUnits { mm, in, cm };
+const distanceUnits mm = distanceUnits::mm, inches = distanceUnits::in;
+enum class gearSetting { ratio36_1, ratio18_1, ratio6_1 };
+enum class turnType { left, right };
+enum class fontType { mono12, mono15, mono20, mono30, mono40, mono60, prop20, prop30, prop40, prop60, mono };
+enum class axisType { xaxis, yaxis, zaxis };
+class color {
+  public:
+    color() : v(0), transparent_(false) {}
+    color(int value) : v(value), transparent_(false) {}
+    color(int r, int g, int b) : v((r << 16) | (g << 8) | b), transparent_(false) {}
+    color(const char *) : v(0), transparent_(false) {}
+    uint32_t rgb() const { return v; }
+    bool isTransparent() const { return transparent_; }
+    static const color black, white, red, green, blue, yellow, orange, purple, cyan, transparent;
+    operator uint32_t() const { return v; }
+    color &operator=(uint32_t value) { v = value; return *this; }
+  private:
+    uint32_t v;
+    bool transparent_;
+};
+extern const color &black, &white, &red, &green, &blue, &yellow, &orange, &purple, &cyan, &transparent;
+// timer, mutex and task are in sim_vex.cpp, on the simulated clock
+class timer {
+  public:
+    timer();
+    double value() const;
+    double time(timeUnits u) const;
+    uint32_t time();
+    void reset();
+    void clear();
+    static uint32_t system();
+    static uint64_t systemHighResolution();
+    void event(void (*cb)(void), uint32_t) {}
+  private:
+    uint64_t start_us;
+};
+class mutex {
+  public:
+    void lock();
+    bool try_lock();
+    void unlock();
+};
+class task {
+  public:
+    task();
+    task(int (*callback)(void *), void *arg);
+    task(int (*callback)(void *), void *arg, int32_t priority);
+    bool stop();
+    void suspend() {}
+    void resume() {}
+    static void sleep(uint32_t);
+    static void yield();
+    static const int32_t taskPriorityNormal = 7;
+};
+class thread {
+  public:
+    thread() {}
+    thread(int (*callback)(void)) {}
+    thread(void (*callback)(void)) {}
+    thread(int (*callback)(void *), void *arg) {}
+    thread(void (*callback)(void *), void *arg) {}
+    void join() {}
+    void detach() {}
+    void interrupt() {}
+    static const int32_t threadPriorityNormal = 7;
+};
+namespace this_thread {
+void sleep_for(uint32_t);
+int32_t get_id();
+void yield();
+} // namespace this_thread
+class device {
+  public:
+    bool installed() { return {}; }
+    int32_t index() { return {}; }
+};
+class motor : public device {
+  public:
+    motor(int32_t index) {}
+    motor(int32_t index, bool reverse) {}
+    motor(int32_t index, gearSetting g) {}
+    motor(int32_t index, gearSetting g, bool reverse) {}
+    void spin(directionType dir) {}
+    void spin(directionType dir, double velocity, velocityUnits units) {}
+    void spin(directionType dir, double velocity, percentUnits units) {}
+    void spin(directionType dir, double voltage, voltageUnits units) {}
+    void stop() {}
+    void stop(brakeType) {}
+    void setBrake(brakeType) {}
+    void setStopping(brakeType) {}
+    void setVelocity(double, velocityUnits) {}
+    void setVelocity(double, percentUnits) {}
+    void setMaxTorque(double, percentUnits) {}
+    void resetPosition() {}
+    void setPosition(double, rotationUnits) {}
+    void resetRotation() {}
+    double position(rotationUnits) { return {}; }
+    double rotation(rotationUnits) { return {}; }
+    double velocity(velocityUnits) { return {}; }
+    double velocity(percentUnits) { return {}; }
+    double current(currentUnits u = currentUnits::amp) { return {}; }
+    double voltage(voltageUnits u = voltageUnits::volt) { return {}; }
+    double temperature(temperatureUnits) { return {}; }
+    double temperature(percentUnits) { return {}; }
+    double torque() { return {}; }
+    double power() { return {}; }
+    double efficiency() { return {}; }
+    bool spinFor(directionType, double, rotationUnits, double, velocityUnits, bool = true) { return {}; }
+    bool spinFor(double, rotationUnits, bool = true) { return {}; }
+    bool spinToPosition(double, rotationUnits, bool = true) { return {}; }
+    bool isDone() { return {}; }
+};
+class motor_group {
+  public:
+    motor_group() {}
+    template <typename... Args> motor_group(motor &m1, Args &...m2);
+    motor_group(std::initializer_list<motor>) {}
+    void spin(directionType dir) {}
+    void spin(directionType dir, double velocity, velocityUnits units) {}
+    void spin(directionType dir, double velocity, percentUnits units) {}
+    void spin(directionType dir, double voltage, voltageUnits units) {}
+    void stop() {}
+    void stop(brakeType) {}
+    void setStopping(brakeType) {}
+    void setVelocity(double, percentUnits) {}
+    void setMaxTorque(double, percentUnits) {}
+    void resetPosition() {}
+    void resetRotation() {}
+    void setPosition(double, rotationUnits) {}
+    double position(rotationUnits) { return {}; }
+    double rotation(rotationUnits) { return {}; }
+    double velocity(velocityUnits) { return {}; }
+    double velocity(percentUnits) { return {}; }
+    double current(currentUnits u = currentUnits::amp) { return {}; }
+    double voltage(voltageUnits u = voltageUnits::volt) { return {}; }
+    double temperature(temperatureUnits) { return {}; }
+    double temperature(percentUnits) { return {}; }
+    int32_t count() { return {}; }
+    bool spinFor(directionType, double, rotationUnits, double, velocityUnits, bool = true) { return {}; }
+    bool spinFor(double, rotationUnits, bool = true) { return {}; }
+    bool spinToPosition(double, rotationUnits, bool = true) { return {}; }
+    bool isDone() { return {}; }
+};
+template <typename... Args> motor_group::motor_group(motor &, Args &...) {}
+class triport {
+  public:
+    class port {
+      public:
+        int32_t index() { return {}; }
+    };
+    triport(int32_t) {}
+    port A, B, C, D, E, F, G, H;
+};
+class pot : public device {
+  public:
+    pot(triport::port &) {}
+    double angle(rotationUnits) { return {}; }
+    double angle(percentUnits) { return {}; }
+    double value(rotationUnits) { return {}; }
+};
+class limit : public device {
+  public:
+    limit(triport::port &) {}
+    int32_t pressing() { return {}; }
+    int32_t value() { return {}; }
+    void pressed(void (*)(void)) {}
+};
+class encoder : public device {
+  public:
+    encoder(triport::port &) {}
+    double position(rotationUnits) { return {}; }
+    double rotation(rotationUnits) { return {}; }
+    double velocity(velocityUnits) { return {}; }
+    void resetRotation() {}
+    void setPosition(double, rotationUnits) {}
+    void setRotation(double, rotationUnits) {}
+};
+class digital_out : public device {
+  public:
+    digital_out(triport::port &) {}
+    void set(bool) {}
+    int32_t value() { return {}; }
+};
+class pneumatics : public device {
+  public:
+    pneumatics(triport::port &) {}
+    void set(bool) {}
+    void open() {}
+    void close() {}
+    int32_t value() { return {}; }
+};
+class rotation : public device {
+  public:
+    rotation(int32_t, bool = false) {}
+    double position(rotationUnits) { return {}; }
+    double angle(rotationUnits) { return {}; }
+    double velocity(velocityUnits) { return {}; }
+    void resetPosition() {}
+    void setPosition(double, rotationUnits) {}
+};
+class distance : public device {
+  public:
+    distance(int32_t) {}
+    double objectDistance(distanceUnits) { return {}; }
+    bool isObjectDetected() { return {}; }
+};
+class optical : public device {
+  public:
+    optical(int32_t) {}
+    bool isNearObject() { return {}; }
+    double hue() { return {}; }
+    double brightness() { return {}; }
+    void setLight(bool) {}
+};
+class inertial : public device {
+  public:
+    inertial(int32_t) {}
+    void calibrate() {}
+    bool isCalibrating() { return {}; }
+    double heading(rotationUnits u = rotationUnits::deg) { return {}; }
+    double rotation(rotationUnits u = rotationUnits::deg) { return {}; }
+    double acceleration(axisType) { return {}; }
+    double roll(rotationUnits u = rotationUnits::deg) { return {}; }
+    double pitch(rotationUnits u = rotationUnits::deg) { return {}; }
+    double yaw(rotationUnits u = rotationUnits::deg) { return {}; }
+    void setHeading(double, rotationUnits) {}
+    void setRotation(double, rotationUnits) {}
+    void resetHeading() {}
+    void resetRotation() {}
+};
+class gps : public device {
+  public:
+    gps(int32_t, double, double, distanceUnits, double, turnType) {}
+    void calibrate() {}
+    double xPosition(distanceUnits) { return {}; }
+    double yPosition(distanceUnits) { return {}; }
+    double heading(rotationUnits u = rotationUnits::deg) { return {}; }
+    double quality() { return {}; }
+    bool isCalibrating() { return {}; }
+};
+class vision : public device {
+  public:
+    class signature {
+      public:
+        signature(int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, float, int32_t) {}
+    };
+    class object {
+      public:
+        int centerX, centerY, width, height, originX, originY;
+        bool exists;
+    };
+    template <typename... Args> vision(int32_t, uint8_t, Args &...) {}
+    int32_t takeSnapshot(signature &) { return {}; }
+    int32_t objectCount;
+    object largestObject;
+    object objects[16];
+};
+class brain {
+  public:
+    class lcd {
+      public:
+        void setCursor(int32_t, int32_t) {}
+        void setFont(fontType) {}
+        void setPenWidth(uint32_t) {}
+        void setOrigin(int32_t, int32_t) {}
+        int32_t column() { return {}; }
+        int32_t row() { return {}; }
+        template <class T> void setPenColor(T) {}
+        template <class T> void setFillColor(T) {}
+        void print(const char *, ...) {}
+        void printAt(int32_t, int32_t, const char *, ...) {}
+        void printAt(int32_t, int32_t, bool, const char *, ...) {}
+        void clearScreen() {}
+        void clearScreen(const color &) {}
+        void clearLine() {}
+        void newLine() {}
+        void drawPixel(int32_t, int32_t) {}
+        void drawLine(int32_t, int32_t, int32_t, int32_t) {}
+        void drawRectangle(int32_t, int32_t, int32_t, int32_t) {}
+        void drawRectangle(int32_t, int32_t, int32_t, int32_t, const color &) {}
+        void drawCircle(int32_t, int32_t, int32_t) {}
+        void drawCircle(int32_t, int32_t, int32_t, const color &) {}
+        bool drawImageFromFile(const char *, int32_t, int32_t) { return {}; }
+        bool drawImageFromBuffer(uint8_t *, int32_t, int32_t, int32_t) { return {}; }
+        bool drawImageFromBuffer(uint32_t *, int32_t, int32_t, int32_t, int32_t) { return {}; }
+        int32_t xPosition() { return {}; }
+        int32_t yPosition() { return {}; }
+        bool pressing() { return {}; }
+        int32_t getStringWidth(const char *) { return {}; }
+        int32_t getStringHeight(const char *) { return {}; }
+        bool render() { return {}; }
+        bool render(bool, bool) { return {}; }
+        void setClipRegion(int32_t, int32_t, int32_t, int32_t) {}
+        void pressed(void (*)(void)) {}
+        void released(void (*)(void)) {}
+    };
+    class sdcard {
+      public:
+        bool isInserted() { return {}; }
+        int32_t size(const char *) { return {}; }
+        int32_t loadfile(const char *, uint8_t *, int32_t) { return {}; }
+        int32_t savefile(const char *, uint8_t *, int32_t) { return {}; }
+        int32_t appendfile(const char *, uint8_t *, int32_t) { return {}; }
+        bool exists(const char *) { return {}; }
+    };
+    class battery {
+      public:
+        double voltage(voltageUnits u = voltageUnits::volt) { return {}; }
+        double current(currentUnits u = currentUnits::amp) { return {}; }
+        double temperature(temperatureUnits) { return {}; }
+        double temperature(percentUnits) { return {}; }
+        uint32_t capacity(percentUnits u = percentUnits::pct) { return {}; }
+    };
+    brain() {}
+    lcd Screen;
+    sdcard SDcard;
+    battery Battery;
+    triport ThreeWirePort{0};
+    timer Timer;
+};
+class controller {
+  public:
+    class button {
+      public:
+        void pressed(void (*)(void)) {}
+        void released(void (*)(void)) {}
+        bool pressing() { return {}; }
+    };
+    class axis {
+      public:
+        int32_t position(percentUnits u = percentUnits::pct) { return {}; }
+        int32_t value() { return {}; }
+    };
+    class lcd {
+      public:
+        void print(const char *, ...) {}
+        void setCursor(int32_t, int32_t) {}
+        void clearScreen() {}
+        void clearLine(int32_t) {}
+        void clearLine() {}
+        void newLine() {}
+    };
+    controller() {}
+    button ButtonL1, ButtonL2, ButtonR1, ButtonR2, ButtonUp, ButtonDown, ButtonLeft, ButtonRight, ButtonX, ButtonB, ButtonY, ButtonA;
+    axis Axis1, Axis2, Axis3, Axis4;
+    lcd Screen;
+    void rumble(const char *) {}
+};
+class competition {
+  public:
+    void autonomous(void (*)(void)) {}
+    void drivercontrol(void (*)(void)) {}
+    bool isEnabled() { return {}; }
+    bool isAutonomous() { return {}; }
+    bool isDriverControl() { return {}; }
+    bool isCompetitionSwitch() { return {}; }
+    bool isFieldControl() { return {}; }
+};
+void wait(double, timeUnits);
+} // namespace vex
+using namespace vex;
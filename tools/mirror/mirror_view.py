@@ -0,0 +1,367 @@
+#!/usr/bin/env python3
+"""
+Viewer for the brain screen mirror (see screen::MirrorStream in
+core/include/subsystems/screen_mirror.h for the packet format).
+
+Reads the stream from the brain's USB serial port (needs pyserial) or from a
+file saved earlier, and replays the drawing onto a 480x240 picture. Anything
+between packets is the robot's own printf output, it is passed through to
+stdout.
+
+    python3 tools/mirror/mirror_view.py /dev/ttyACM1             live window
+    python3 tools/mirror/mirror_view.py /dev/ttyACM1 --save s.bin  and record
+    python3 tools/mirror/mirror_view.py s.bin --ppm screen.ppm    last frame
+
+Text is drawn by the window (tkinter) in its own font. A .ppm only gets the
+background of opaque text.
+
+Tests: python3 -m unittest discover tools/mirror
+"""
+import argparse
+import os
+import struct
+import sys
+
+WIDTH = 480
+HEIGHT = 240
+SYNC = b"\xa5\x5a"
+TRANSPARENT = 1 << 24
+# longest length the brain will send, see MirrorStream's constructor
+MAX_LENGTH = 60000 + 4
+
+(CLEAR, PEN_COLOR, FILL_COLOR, PEN_WIDTH, FONT, CLIP, PIXEL, LINE, RECT,
+ CIRCLE, TEXT, IMAGE) = range(1, 13)
+
+# vex::fontType in order, as (family, pixel height)
+FONTS = [("Courier", 20), ("Courier", 30), ("Courier", 40), ("Courier", 60),
+         ("Helvetica", 20), ("Helvetica", 30), ("Helvetica", 40),
+         ("Helvetica", 60), ("Courier", 15), ("Courier", 12),
+         ("Courier", 16)]
+
+
+def fletcher16(data):
+    a = b = 0
+    for byte in data:
+        a = (a + byte) % 255
+        b = (b + a) % 255
+    return a, b
+
+
+class PacketReader:
+    """Splits a byte stream into packets. Feed it bytes as they arrive."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.good = 0
+        self.bad = 0
+        self.noise = bytearray()  # everything that wasn't a packet
+        # after a bad packet, the rest of it isn't printf output
+        self.skipping = False
+
+    def feed(self, data):
+        """@return [(frame number, commands)] for every whole packet so far"""
+        self.buf += data
+        packets = []
+        while True:
+            at = self.buf.find(SYNC)
+            if at < 0:
+                # keep a last 0xA5, it may be the start of a sync
+                keep = 1 if self.buf[-1:] == SYNC[:1] else 0
+                self._skip(len(self.buf) - keep)
+                return packets
+            self._skip(at)
+            self.skipping = False
+            if len(self.buf) < 4:
+                return packets
+            length = self.buf[2] | (self.buf[3] << 8)
+            if length < 4 or length > MAX_LENGTH:
+                self._bad()
+                continue
+            total = 4 + length + 2
+            if len(self.buf) < total:
+                return packets
+            body = bytes(self.buf[2:4 + length])
+            if fletcher16(body) != tuple(self.buf[4 + length:total]):
+                # printf landed in it. Look for the next packet just after
+                # this sync, this one's length can't be trusted
+                self._bad()
+                continue
+            frame = struct.unpack_from("<I", body, 2)[0]
+            packets.append((frame, body[6:]))
+            self.good += 1
+            del self.buf[:total]
+
+    def _skip(self, n):
+        if not self.skipping:
+            self.noise += self.buf[:n]
+        del self.buf[:n]
+
+    def _bad(self):
+        self.bad += 1
+        self.skipping = True
+        del self.buf[:2]
+
+
+def commands(data):
+    """@return [(op, args)] for every command in a packet"""
+    out = []
+    i = 0
+
+    def take(fmt):
+        nonlocal i
+        vals = struct.unpack_from("<" + fmt, data, i)
+        i += struct.calcsize("<" + fmt)
+        return vals
+
+    while i < len(data):
+        op = data[i]
+        i += 1
+        if op in (CLEAR, PEN_COLOR, FILL_COLOR):
+            args = take("I")
+        elif op in (PEN_WIDTH, FONT):
+            args = take("B")
+        elif op in (CLIP, LINE, RECT):
+            args = take("4h")
+        elif op == PIXEL:
+            args = take("2h")
+        elif op == CIRCLE:
+            args = take("3h")
+        elif op == TEXT:
+            x, y, opaque, n = take("2hBB")
+            args = (x, y, opaque, data[i:i + n].decode("ascii", "replace"))
+            i += n
+        elif op == IMAGE:
+            x, y, w, h, step = take("4hB")
+            count = ((w + step - 1) // step) * ((h + step - 1) // step)
+            args = (x, y, w, h, step, take("%dH" % count))
+        else:
+            raise ValueError("unknown command %d at byte %d" % (op, i - 1))
+        out.append((op, args))
+    return out
+
+
+def rgb565(c):
+    r, g, b = (c >> 11) & 0x1F, (c >> 5) & 0x3F, c & 0x1F
+    return ((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2))
+
+
+def rgb(c):
+    return ((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF)
+
+
+class Screen:
+    """What the brain screen looks like, rebuilt from the draw commands."""
+
+    def __init__(self):
+        self.pixels = bytearray(WIDTH * HEIGHT * 3)
+        self.pen = 0xFFFFFF
+        self.fill = 0
+        self.pen_width = 1
+        self.font = 0
+        self.clip = (0, 0, WIDTH, HEIGHT)
+        # (x, y, color, font, string) drawn over the pixels
+        self.texts = []
+
+    def apply(self, packet):
+        for op, args in commands(packet):
+            getattr(self, "_op%d" % op)(*args)
+
+    def pixel(self, x, y):
+        return tuple(self.pixels[(y * WIDTH + x) * 3:(y * WIDTH + x) * 3 + 3])
+
+    def ppm(self):
+        return b"P6 %d %d 255\n" % (WIDTH, HEIGHT) + bytes(self.pixels)
+
+    def _fill_rect(self, x, y, w, h, color):
+        cx, cy, cw, ch = self.clip
+        x1, y1 = max(x, cx, 0), max(y, cy, 0)
+        x2, y2 = min(x + w, cx + cw, WIDTH), min(y + h, cy + ch, HEIGHT)
+        if x2 <= x1 or y2 <= y1:
+            return
+        row = bytes(color) * (x2 - x1)
+        for yy in range(y1, y2):
+            at = (yy * WIDTH + x1) * 3
+            self.pixels[at:at + len(row)] = row
+        # whatever text was under it is gone
+        self.texts = [t for t in self.texts
+                      if not (x1 <= t[0] < x2 and y1 <= t[1] - 1 < y2)]
+
+    def _dot(self, x, y, color):
+        half = self.pen_width // 2
+        self._fill_rect(x - half, y - half, max(self.pen_width, 1),
+                        max(self.pen_width, 1), color)
+
+    def _op1(self, c):  # Clear
+        clip, self.clip = self.clip, (0, 0, WIDTH, HEIGHT)
+        self._fill_rect(0, 0, WIDTH, HEIGHT, rgb(c))
+        self.clip = clip
+        self.texts = []
+
+    def _op2(self, c):
+        self.pen = c
+
+    def _op3(self, c):
+        self.fill = c
+
+    def _op4(self, w):
+        self.pen_width = w
+
+    def _op5(self, f):
+        self.font = f
+
+    def _op6(self, x, y, w, h):  # Clip
+        self.clip = (x, y, w, h)
+
+    def _op7(self, x, y):  # Pixel
+        if not self.pen & TRANSPARENT:
+            self._dot(x, y, rgb(self.pen))
+
+    def _op8(self, x1, y1, x2, y2):  # Line
+        if self.pen & TRANSPARENT:
+            return
+        dx, dy = abs(x2 - x1), -abs(y2 - y1)
+        sx, sy = (1 if x1 < x2 else -1), (1 if y1 < y2 else -1)
+        err = dx + dy
+        while True:
+            self._dot(x1, y1, rgb(self.pen))
+            if x1 == x2 and y1 == y2:
+                return
+            e2 = 2 * err
+            if e2 >= dy:
+                err += dy
+                x1 += sx
+            if e2 <= dx:
+                err += dx
+                y1 += sy
+
+    def _op9(self, x, y, w, h):  # Rect, filled then outlined
+        if not self.fill & TRANSPARENT:
+            self._fill_rect(x, y, w, h, rgb(self.fill))
+        if not self.pen & TRANSPARENT:
+            pen = rgb(self.pen)
+            for x1, y1, ww, hh in ((x, y, w, 1), (x, y + h - 1, w, 1),
+                                   (x, y, 1, h), (x + w - 1, y, 1, h)):
+                self._fill_rect(x1, y1, ww, hh, pen)
+
+    def _op10(self, x, y, r):  # Circle, filled then outlined
+        for dy in range(-r, r + 1):
+            for dx in range(-r, r + 1):
+                d = dx * dx + dy * dy
+                if d <= r * r:
+                    edge = d > (r - 1) * (r - 1)
+                    c = self.pen if edge else self.fill
+                    if not c & TRANSPARENT:
+                        self._fill_rect(x + dx, y + dy, 1, 1, rgb(c))
+
+    def _op11(self, x, y, opaque, s):  # Text, y is the baseline
+        family, size = FONTS[self.font] if self.font < len(FONTS) else \
+            FONTS[0]
+        w = len(s) * size * 3 // 5
+        if opaque and not self.fill & TRANSPARENT:
+            self._fill_rect(x, y - size * 4 // 5, w, size, rgb(self.fill))
+        else:
+            self.texts = [t for t in self.texts if t[:2] != (x, y)]
+        if not self.pen & TRANSPARENT:
+            self.texts.append((x, y, rgb(self.pen), (family, size), s))
+
+    def _op12(self, x, y, w, h, step, px):  # Image
+        per_row = (w + step - 1) // step
+        for i, c in enumerate(px):
+            row, col = divmod(i, per_row)
+            bw = min(step, w - col * step)
+            bh = min(step, h - row * step)
+            self._fill_rect(x + col * step, y + row * step, bw, bh,
+                            rgb565(c))
+
+
+def run_window(read, screen, reader):
+    """Show the screen in a window, calling read() for more bytes"""
+    import tkinter
+
+    root = tkinter.Tk()
+    root.title("brain screen")
+    canvas = tkinter.Canvas(root, width=WIDTH, height=HEIGHT,
+                            highlightthickness=0)
+    canvas.pack()
+    photo = tkinter.PhotoImage(width=WIDTH, height=HEIGHT)
+    canvas.create_image(0, 0, image=photo, anchor="nw")
+
+    def poll():
+        data = read()
+        if data is None:
+            return
+        changed = handle(data, screen, reader)
+        if changed:
+            photo.configure(data=screen.ppm(), format="PPM")
+            canvas.delete("text")
+            for x, y, color, (family, size), s in screen.texts:
+                canvas.create_text(x, y, text=s, anchor="sw", tags="text",
+                                   fill="#%02x%02x%02x" % color,
+                                   font=(family, -size))
+        root.after(20, poll)
+
+    poll()
+    root.mainloop()
+
+
+def handle(data, screen, reader):
+    """@return true if the screen changed"""
+    packets = reader.feed(data)
+    if reader.noise:
+        sys.stdout.write(reader.noise.decode("ascii", "replace"))
+        sys.stdout.flush()
+        del reader.noise[:]
+    for _, body in packets:
+        try:
+            screen.apply(body)
+        except (ValueError, struct.error) as e:
+            print("mirror: bad packet, %s" % e, file=sys.stderr)
+    return bool(packets)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("source", help="serial port, or a file saved with --save")
+    ap.add_argument("--save", help="also write everything read to this file")
+    ap.add_argument("--ppm", help="read the whole file, save the last frame "
+                    "here instead of opening a window")
+    args = ap.parse_args()
+
+    screen, reader = Screen(), PacketReader()
+    save = open(args.save, "wb") if args.save else None
+
+    if os.path.isfile(args.source):
+        f = open(args.source, "rb")
+
+        def read():
+            return f.read(2048) or None
+    else:
+        import serial
+
+        port = serial.Serial(args.source, 115200, timeout=0)
+
+        def read():
+            return port.read(port.in_waiting or 1)
+
+    def read_and_save():
+        data = read()
+        if save and data:
+            save.write(data)
+        return data
+
+    if args.ppm:
+        while True:
+            data = read_and_save()
+            if data is None:
+                break
+            handle(data, screen, reader)
+        with open(args.ppm, "wb") as out:
+            out.write(screen.ppm())
+        print("%d packets, %d bad" % (reader.good, reader.bad),
+              file=sys.stderr)
+        return
+    run_window(read_and_save, screen, reader)
+
+
+if __name__ == "__main__":
+    main()